@@ -0,0 +1,6 @@
+#version 450 core
+
+// Depth is written by fixed function
+void main()
+{
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#version 450 core
+
+// Depth only, reads the same geometry arena and draw data as the standard shader
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 5) in uint instanceSlot;
+
+struct DrawData
+{
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+	vec4 ambientShininess;
+	vec4 specularOpacity;
+};
+
+layout(std430, binding = 1) readonly buffer DrawBuffer
+{
+	DrawData draws[];
+};
+
+uniform mat4 viewProjection;
+
+// Computed exactly like the standard shader, the depth pre-pass relies on equal depths
+invariant gl_Position;
+
+void main()
+{
+	vec4 worldPosition = draws[instanceSlot].modelMatrix * vec4(vertexPosition, 1.0);
+	gl_Position = viewProjection * worldPosition;
+}
\ No newline at end of file
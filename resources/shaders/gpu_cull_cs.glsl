@@ -0,0 +1,230 @@
+#version 450 core
+
+// GPU driven culling of every opaque draw slot, run in two stages per phase. The
+// cull stage tests each slot's bounds against the view frustum and, with occlusion
+// culling, the Hi-Z pyramid, and appends the visible ones to their draw group's
+// instances. The compact stage turns each group with visible instances into an
+// indirect command, packed per texture batch behind an atomic draw count that
+// glMultiDrawElementsIndirectCount reads. Phase 1 re-tests what phase 0 found
+// occluded against the pyramid of what phase 0 drew.
+layout(local_size_x = 64) in;
+
+const uint NO_DRAW_GROUP = 0xFFFFFFFFu;
+
+struct DrawData
+{
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+	vec4 ambientShininess;
+	vec4 specularOpacity;
+};
+
+struct CullData
+{
+	vec4 sphere; // Mesh space center and radius
+	uint group;
+	uint padding0;
+	uint padding1;
+	uint padding2;
+};
+
+struct DrawGroup
+{
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint firstInstance;
+	uint batch;
+	uint firstCommand; // The batch's
+	uint padding0;
+	uint padding1;
+};
+
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+// Per frame in flight, X = visible in phase 0, Y = visible in phase 1, Z = outside
+// the frustum, W = commands written
+layout(std430, binding = 0) buffer OcclusionCounters
+{
+	uvec4 counters[];
+};
+
+layout(std430, binding = 1) readonly buffer DrawBuffer
+{
+	DrawData draws[];
+};
+
+layout(std430, binding = 2) readonly buffer CullBuffer
+{
+	CullData objects[];
+};
+
+layout(std430, binding = 3) readonly buffer DrawGroups
+{
+	DrawGroup groups[];
+};
+
+// One run of groupCount commands per phase
+layout(std430, binding = 4) writeonly buffer Commands
+{
+	DrawCommand commands[];
+};
+
+// One run of instanceCount draw slots per phase
+layout(std430, binding = 5) writeonly buffer Instances
+{
+	uint instances[];
+};
+
+// Draw counts per phase and batch, then instance counts per phase and group, all
+// cleared at the start of the frame
+layout(std430, binding = 6) buffer Counts
+{
+	uint counts[];
+};
+
+// Per draw slot, 1 = visible in phase 0, 2 = outside the frustum
+layout(std430, binding = 7) buffer Visibility
+{
+	uint visibility[];
+};
+
+uniform int stage; // 0 = cull draw slots, 1 = compact draw groups
+uniform int phase;
+uniform int objectCount;
+uniform int groupCount;
+uniform int batchCount;
+uniform int instanceCount;
+uniform int testOcclusion;
+uniform int counterSlot;
+uniform mat4 viewProjection;
+uniform mat4 hiZViewProjection;
+uniform vec2 depthSize;
+uniform sampler2D hiZ;
+
+bool inFrustum(vec4 sphere)
+{
+	// Planes from the rows of the view projection, clip space z in [-w, w]
+	mat4 rows = transpose(viewProjection);
+	for (int i = 0; i < 6; i++)
+	{
+		vec4 plane = rows[3] + ((i & 1) != 0 ? -rows[i >> 1] : rows[i >> 1]);
+		if (dot(plane.xyz, sphere.xyz) + plane.w < -sphere.w * length(plane.xyz)) return false;
+	}
+	return true;
+}
+
+// Same test as the occlusion shader of the CPU driven path
+bool isUnoccluded(vec4 sphere)
+{
+	vec2 rectMin = vec2(1.0);
+	vec2 rectMax = vec2(0.0);
+	float nearest = 1.0;
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = hiZViewProjection * vec4(corner, 1.0);
+		if (clip.w <= 0.0) return true;
+
+		vec3 position = clip.xyz / clip.w * 0.5 + 0.5;
+		rectMin = min(rectMin, position.xy);
+		rectMax = max(rectMax, position.xy);
+		nearest = min(nearest, position.z);
+	}
+
+	if (any(greaterThan(rectMin, vec2(1.0))) || any(lessThan(rectMax, vec2(0.0)))) return true;
+	rectMin = clamp(rectMin, 0.0, 1.0);
+	rectMax = clamp(rectMax, 0.0, 1.0);
+
+	ivec2 depthMin = ivec2(rectMin * depthSize);
+	ivec2 depthMax = min(ivec2(rectMax * depthSize), ivec2(depthSize) - 1);
+	ivec2 span = depthMax - depthMin + 1;
+	int level = clamp(int(ceil(log2(float(max(span.x, span.y))))) - 1, 0, textureQueryLevels(hiZ) - 1);
+
+	ivec2 levelLast = textureSize(hiZ, level) - 1;
+	ivec2 texelMin = min(depthMin >> (level + 1), levelLast);
+	ivec2 texelMax = min(depthMax >> (level + 1), levelLast);
+
+	float farthest = 0.0;
+	for (int y = texelMin.y; y <= texelMax.y; y++)
+	{
+		for (int x = texelMin.x; x <= texelMax.x; x++)
+		{
+			farthest = max(farthest, texelFetch(hiZ, ivec2(x, y), level).r);
+		}
+	}
+	return nearest <= farthest;
+}
+
+void cullObject(uint slot)
+{
+	CullData object = objects[slot];
+	if (object.group == NO_DRAW_GROUP) return;
+
+	// World space bounds, the radius grows with the largest axis scale
+	mat4 model = draws[slot].modelMatrix;
+	float scale = sqrt(max(dot(model[0].xyz, model[0].xyz), max(dot(model[1].xyz, model[1].xyz), dot(model[2].xyz, model[2].xyz))));
+	vec4 sphere = vec4((model * vec4(object.sphere.xyz, 1.0)).xyz, object.sphere.w * scale);
+
+	if (phase == 0)
+	{
+		if (!inFrustum(sphere))
+		{
+			visibility[slot] = 2u;
+			atomicAdd(counters[counterSlot].z, 1u);
+			return;
+		}
+
+		bool visible = testOcclusion == 0 || isUnoccluded(sphere);
+		visibility[slot] = visible ? 1u : 0u;
+		if (!visible) return;
+	}
+	else if (visibility[slot] != 0u || !isUnoccluded(sphere))
+	{
+		return;
+	}
+
+	uint group = object.group;
+	uint instance = atomicAdd(counts[batchCount * 2 + groupCount * phase + group], 1u);
+	instances[instanceCount * phase + groups[group].firstInstance + instance] = slot;
+
+	if (phase == 0) atomicAdd(counters[counterSlot].x, 1u);
+	else atomicAdd(counters[counterSlot].y, 1u);
+}
+
+void compactGroup(uint index)
+{
+	uint visible = counts[batchCount * 2 + groupCount * phase + index];
+	if (visible == 0u) return;
+
+	DrawGroup group = groups[index];
+	uint command = atomicAdd(counts[batchCount * phase + group.batch], 1u);
+	commands[groupCount * phase + group.firstCommand + command] = DrawCommand(
+		group.indexCount,
+		visible,
+		group.firstIndex,
+		group.baseVertex,
+		instanceCount * phase + group.firstInstance
+	);
+	atomicAdd(counters[counterSlot].w, 1u);
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+	if (stage == 0)
+	{
+		if (index < uint(objectCount)) cullObject(index);
+	}
+	else if (index < uint(groupCount))
+	{
+		compactGroup(index);
+	}
+}
\ No newline at end of file
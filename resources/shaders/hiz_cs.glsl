@@ -0,0 +1,33 @@
+#version 450 core
+
+// One level of the Hi-Z pyramid: the farthest depth of the 2x2 source texels below
+// each texel, plus the leftover row and column when the source size is odd
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D sourceDepth; // The depth buffer for level 0, the pyramid otherwise
+uniform int sourceLevel;
+
+layout(r32f, binding = 0) uniform writeonly image2D destination;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(destination);
+	if (any(greaterThanEqual(texel, size))) return;
+
+	ivec2 sourceSize = textureSize(sourceDepth, sourceLevel);
+	ivec2 last = sourceSize - 1;
+	ivec2 leftover = ivec2(equal(texel, size - 1)) * (sourceSize - size * 2);
+	ivec2 first = min(texel * 2, last);
+	ivec2 end = clamp(texel * 2 + 1 + leftover, first, last);
+
+	float depth = 0.0;
+	for (int y = first.y; y <= end.y; y++)
+	{
+		for (int x = first.x; x <= end.x; x++)
+		{
+			depth = max(depth, texelFetch(sourceDepth, ivec2(x, y), sourceLevel).r);
+		}
+	}
+	imageStore(destination, texel, vec4(depth));
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#version 450 core
+
+// Tests the bounds of each queued draw against the Hi-Z pyramid and appends the
+// visible ones to their draw command's instances. Phase 0 tests against the pyramid
+// of the previous frame; phase 1 re-tests what phase 0 rejected against the pyramid
+// of what phase 0 drew, catching objects that were disoccluded since.
+layout(local_size_x = 64) in;
+
+struct CullObject
+{
+	vec4 sphere; // World space center and radius
+	uint slot;
+	uint command;
+	uint padding0;
+	uint padding1;
+};
+
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout(std430, binding = 2) readonly buffer CullObjects
+{
+	CullObject objects[];
+};
+
+// Commands arrive with no instances, this phase's instance buffer is filled from baseInstance
+layout(std430, binding = 3) buffer Commands
+{
+	DrawCommand commands[];
+};
+
+layout(std430, binding = 4) writeonly buffer Instances
+{
+	uint instances[];
+};
+
+layout(std430, binding = 5) buffer EarlyVisibility
+{
+	uint visibleEarly[];
+};
+
+// Per frame in flight, X = visible in phase 0, Y = visible in phase 1
+layout(std430, binding = 6) buffer OcclusionCounters
+{
+	uvec4 counters[];
+};
+
+uniform int objectCount;
+uniform int phase;
+uniform int pyramidValid;
+uniform int counterSlot;
+uniform mat4 viewProjection; // The pyramid's
+uniform vec2 depthSize;
+uniform sampler2D hiZ;
+
+bool isVisible(vec4 sphere)
+{
+	// Screen rectangle and nearest depth of the sphere's bounding box
+	vec2 rectMin = vec2(1.0);
+	vec2 rectMax = vec2(0.0);
+	float nearest = 1.0;
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = viewProjection * vec4(corner, 1.0);
+
+		// Reaches behind the camera, can't be bounded on screen
+		if (clip.w <= 0.0) return true;
+
+		vec3 position = clip.xyz / clip.w * 0.5 + 0.5;
+		rectMin = min(rectMin, position.xy);
+		rectMax = max(rectMax, position.xy);
+		nearest = min(nearest, position.z);
+	}
+
+	// Off screen for the pyramid's view, nothing there to occlude it. Partly off screen
+	// only the part on screen can be tested, the rest is either culled by the frustum
+	// or re-tested in phase 1.
+	if (any(greaterThan(rectMin, vec2(1.0))) || any(lessThan(rectMax, vec2(0.0)))) return true;
+	rectMin = clamp(rectMin, 0.0, 1.0);
+	rectMax = clamp(rectMax, 0.0, 1.0);
+
+	// The level where the rectangle spans at most 2x2 texels
+	ivec2 depthMin = ivec2(rectMin * depthSize);
+	ivec2 depthMax = min(ivec2(rectMax * depthSize), ivec2(depthSize) - 1);
+	ivec2 span = depthMax - depthMin + 1;
+	int level = clamp(int(ceil(log2(float(max(span.x, span.y))))) - 1, 0, textureQueryLevels(hiZ) - 1);
+
+	ivec2 levelLast = textureSize(hiZ, level) - 1;
+	ivec2 texelMin = min(depthMin >> (level + 1), levelLast);
+	ivec2 texelMax = min(depthMax >> (level + 1), levelLast);
+
+	float farthest = 0.0;
+	for (int y = texelMin.y; y <= texelMax.y; y++)
+	{
+		for (int x = texelMin.x; x <= texelMax.x; x++)
+		{
+			farthest = max(farthest, texelFetch(hiZ, ivec2(x, y), level).r);
+		}
+	}
+	return nearest <= farthest;
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= uint(objectCount)) return;
+
+	CullObject object = objects[index];
+	if (phase == 0)
+	{
+		bool visible = pyramidValid == 0 || isVisible(object.sphere);
+		visibleEarly[index] = visible ? 1u : 0u;
+		if (!visible) return;
+	}
+	else if (visibleEarly[index] != 0u || !isVisible(object.sphere))
+	{
+		return;
+	}
+
+	uint instance = atomicAdd(commands[object.command].instanceCount, 1u);
+	instances[commands[object.command].baseInstance + instance] = object.slot;
+
+	if (phase == 0) atomicAdd(counters[counterSlot].x, 1u);
+	else atomicAdd(counters[counterSlot].y, 1u);
+}
\ No newline at end of file
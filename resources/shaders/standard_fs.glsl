@@ -3,6 +3,8 @@
 #define MAX_LIGHTS 10
 #define POINT_LIGHT 0
 #define DIRECTIONAL_LIGHT 1
+#define MAX_CASCADES 4
+#define MAX_POINT_SHADOWS 8
 
 struct Light
 {
@@ -18,6 +20,36 @@ layout(std140, binding = 0) uniform LightsUBO
 };
 uniform int activeLights = 0;
 
+layout(std140, binding = 2) uniform ShadowUBO
+{
+    mat4 shadowMatrices[MAX_CASCADES];
+    vec4 cascadeSplits; // View space far distance of each cascade
+    ivec4 shadowParams; // X = cascade count (0 = no shadows), Y = shadowed light
+};
+uniform sampler2DArrayShadow shadowMap;
+
+layout(std140, binding = 3) uniform PointShadowUBO
+{
+    mat4 pointShadowMatrices[MAX_POINT_SHADOWS * 6]; // World to atlas, faces +X, -X, +Y, -Y, +Z, -Z
+    vec4 pointShadowRects[MAX_POINT_SHADOWS * 6]; // Face tile in the atlas, XY = min, ZW = max
+    ivec4 pointShadowLights[MAX_POINT_SHADOWS]; // X = light slot
+    ivec4 pointShadowParams; // X = shadow count
+};
+uniform sampler2DShadow pointShadowAtlas;
+
+struct DrawData
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    vec4 ambientShininess; // XYZ = ambient, W = shininess
+    vec4 specularOpacity; // XYZ = specular strength, W = opacity
+};
+
+layout(std430, binding = 1) readonly buffer DrawBuffer
+{
+    DrawData draws[];
+};
+
 // Input/Output
 in VS_OUT
 {
@@ -27,6 +59,7 @@ in VS_OUT
     vec3 EyeDirection_cameraspace;
     vec3 Tangent_cameraspace;
     vec3 Bitangent_cameraspace;
+    flat uint DrawIndex;
 } fs_in;
 
 out vec4 FragColor;
@@ -37,12 +70,8 @@ uniform mat4 viewMatrix;
 uniform sampler2D textureAlbedo;
 uniform sampler2D textureNormal;
 uniform sampler2D textureSpecular;
-uniform vec3 materialAmbient;
-uniform vec3 specularStrength;
-uniform float shininess;
-uniform float opacity;
 
-vec3 calculateLightContribution(Light light, vec3 diffuseColor, vec3 normal, vec3 specularColor)
+vec3 calculateLightContribution(Light light, vec3 diffuseColor, vec3 normal, vec3 specularColor, float shininess)
 {   
     vec3 lightColor = light.color.xyz;
     float lightPower = light.power_type.x;
@@ -87,8 +116,79 @@ vec3 calculateLightContribution(Light light, vec3 diffuseColor, vec3 normal, vec
     return 1.0 * (diffuse + specular);
 }
 
+float calculateShadow()
+{
+    // Eye direction is the negated camera space position
+    float viewDepth = fs_in.EyeDirection_cameraspace.z;
+    int cascadeCount = shadowParams.x;
+    if (viewDepth > cascadeSplits[cascadeCount - 1]) return 1.0;
+
+    int cascade = 0;
+    while (cascade < cascadeCount - 1 && viewDepth > cascadeSplits[cascade]) cascade++;
+
+    vec4 shadowPosition = shadowMatrices[cascade] * vec4(fs_in.Position_worldspace, 1.0);
+    vec3 coords = shadowPosition.xyz / shadowPosition.w * 0.5 + 0.5;
+
+    // 3x3 PCF, each tap is itself bilinearly filtered by the comparison sampler
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            vec2 uv = coords.xy + vec2(x, y) * texelSize;
+            lit += texture(shadowMap, vec4(uv, cascade, min(coords.z, 1.0)));
+        }
+    }
+    return lit / 9.0;
+}
+
+float calculatePointShadow(int shadow, vec3 lightPosition)
+{
+    // The major axis of the light to fragment vector picks the cube face
+    vec3 toFragment = fs_in.Position_worldspace - lightPosition;
+    vec3 magnitude = abs(toFragment);
+    int axis = magnitude.x >= magnitude.y && magnitude.x >= magnitude.z ? 0 : magnitude.y >= magnitude.z ? 1 : 2;
+    int face = shadow * 6 + axis * 2 + (toFragment[axis] < 0.0 ? 1 : 0);
+
+    vec4 shadowPosition = pointShadowMatrices[face] * vec4(fs_in.Position_worldspace, 1.0);
+    vec3 coords = shadowPosition.xyz / shadowPosition.w;
+    vec4 rect = pointShadowRects[face];
+
+    // 3x3 PCF clamped to the face's tile
+    vec2 texelSize = 1.0 / vec2(textureSize(pointShadowAtlas, 0));
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            vec2 uv = clamp(coords.xy + vec2(x, y) * texelSize, rect.xy, rect.zw);
+            lit += texture(pointShadowAtlas, vec3(uv, min(coords.z, 1.0)));
+        }
+    }
+    return lit / 9.0;
+}
+
+float calculateLightShadow(int lightIndex, float directionalShadow)
+{
+    if (lightIndex == shadowParams.y) return directionalShadow;
+
+    for (int i = 0; i < pointShadowParams.x; i++)
+    {
+        if (pointShadowLights[i].x == lightIndex) return calculatePointShadow(i, lights[lightIndex].position.xyz);
+    }
+    return 1.0;
+}
+
 void main()
 {
+    vec4 ambientShininess = draws[fs_in.DrawIndex].ambientShininess;
+    vec4 specularOpacity = draws[fs_in.DrawIndex].specularOpacity;
+    vec3 materialAmbient = ambientShininess.xyz;
+    float shininess = ambientShininess.w;
+    vec3 specularStrength = specularOpacity.xyz;
+    float opacity = specularOpacity.w;
+
     vec3 diffuseColor = texture(textureAlbedo, fs_in.UV).rgb;
     vec3 specularColor = texture(textureSpecular, fs_in.UV).rgb * specularStrength;
 
@@ -106,10 +206,13 @@ void main()
     vec3 result = materialAmbient * diffuseColor;
 
     // Accumulate light contributions
+    float shadow = shadowParams.x > 0 ? calculateShadow() : 1.0;
+
     int numLights = min(activeLights, MAX_LIGHTS);
     for(int i = 0; i < numLights; i++) 
     {
-        result += calculateLightContribution(lights[i], diffuseColor, normal, specularColor);
+        vec3 contribution = calculateLightContribution(lights[i], diffuseColor, normal, specularColor, shininess);
+        result += contribution * calculateLightShadow(i, shadow);
     }
 
     FragColor = vec4(result, opacity);
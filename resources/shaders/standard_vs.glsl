@@ -7,6 +7,9 @@ layout(location = 2) in vec3 vertexNormal;
 layout(location = 3) in vec3 vertexTangent;
 layout(location = 4) in vec3 vertexBitangent;
 
+// Draw slot of the instance, per-instance attribute offset by the command's baseInstance
+layout(location = 5) in uint instanceSlot;
+
 out VS_OUT 
 {
 	vec2 UV;
@@ -15,22 +18,43 @@ out VS_OUT
 	vec3 EyeDirection_cameraspace;
 	vec3 Tangent_cameraspace;
 	vec3 Bitangent_cameraspace;
+	flat uint DrawIndex;
 } vs_out;
 
+// Per-draw data, updated by the renderer only when a transform or material changes
+struct DrawData
+{
+	mat4 modelMatrix;
+	mat4 normalMatrix; // World space
+	vec4 ambientShininess;
+	vec4 specularOpacity;
+};
+
+layout(std430, binding = 1) readonly buffer DrawBuffer
+{
+	DrawData draws[];
+};
+
 // Uniforms
-uniform mat4 modelViewProjection;
+uniform mat4 viewProjection;
 uniform mat4 viewMatrix;
-uniform mat4 modelMatrix;
-uniform mat3 normalMatrix;
+
+// Matches the depth only shader, so the depth pre-pass and this pass agree on depth
+invariant gl_Position;
 
 void main()
 {
+	uint drawIndex = instanceSlot;
+	mat4 modelMatrix = draws[drawIndex].modelMatrix;
+	mat3 normalMatrix = mat3(viewMatrix) * mat3(draws[drawIndex].normalMatrix);
+
 	vec4 vertexPos4 = vec4(vertexPosition, 1.0);
+	vec4 worldPosition = modelMatrix * vertexPos4;
 
-	gl_Position = modelViewProjection * vertexPos4;
-	vs_out.Position_worldspace = (modelMatrix * vertexPos4).xyz;
+	gl_Position = viewProjection * worldPosition;
+	vs_out.Position_worldspace = worldPosition.xyz;
 
-	vec3 vertexPosition_cameraspace = (viewMatrix * modelMatrix * vertexPos4).xyz;
+	vec3 vertexPosition_cameraspace = (viewMatrix * worldPosition).xyz;
 	vs_out.EyeDirection_cameraspace = -vertexPosition_cameraspace;
 
 	vs_out.Normal_cameraspace = normalize(normalMatrix * vertexNormal);
@@ -38,4 +62,5 @@ void main()
 	vs_out.Bitangent_cameraspace = normalize(normalMatrix * vertexBitangent);
 
 	vs_out.UV = vertexUV;
+	vs_out.DrawIndex = drawIndex;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <algorithm>
+#include <filesystem>
 
 #include "uuid.h"
 #include "utils.h"
@@ -20,22 +21,48 @@ bool Application::initialize(int width, int height, const char* title)
     m_sdk.scene = std::make_unique<Scene>();
     m_sdk.uiManager = std::make_unique<UIManager>();
     m_sdk.resourceManager = std::make_unique<ResourceManager>();
+    m_sdk.jobSystem = std::make_unique<JobSystem>();
+    m_sdk.scheduler = std::make_unique<SystemScheduler>(*m_sdk.jobSystem);
+    m_sdk.worldStreamer = std::make_unique<WorldStreamer>();
+    m_sdk.sceneLoader = std::make_unique<SceneLoader>();
     
     if (!m_sdk.renderer->initialize()) return false;
+    m_sdk.renderer->attachScene(*m_sdk.scene);
+    m_sdk.resourceManager->onCollected().connect<&OpenGL::Renderer::requestEviction>(*m_sdk.renderer);
     if (!m_sdk.uiManager->initialize(*m_sdk.window)) return false;
     Input::init(*m_sdk.window);
     
     m_fpsCameraSystem = std::make_unique<Editor::FPSCameraSystem>();
     m_editorUI = std::make_unique<Editor::EditorUI>();
+    m_editorUI->attachScene(*m_sdk.scene);
+    registerSystems();
 
     m_sdk.renderer->toggleDebug(true);
 
     return true;
 }
 
-bool Application::loadScene(const std::string& path)
+bool Application::loadScene(const std::string& path, SceneLoader::CompletionCallback onLoaded)
 {
-    return m_sdk.scene->loadScene(path, *m_sdk.resourceManager);
+    if (WorldStreamer::isWorldFile(path))
+    {
+        m_sdk.sceneLoader->cancel();
+        bool opened = m_sdk.worldStreamer->open(path, *m_sdk.scene, *m_sdk.resourceManager);
+        if (onLoaded) onLoaded(opened);
+        return opened;
+    }
+
+    if (!std::filesystem::exists(path))
+    {
+        std::cerr << "Scene file not found: " << path << std::endl;
+        if (onLoaded) onLoaded(false);
+        return false;
+    }
+
+    // Swapped in by applyLoadedScene once the background load finishes, which is
+    // also when onLoaded hears about it
+    m_sdk.sceneLoader->start(path, *m_sdk.resourceManager, std::move(onLoaded));
+    return true;
 }
 
 void Application::run() 
@@ -47,6 +74,7 @@ void Application::run()
         m_lastFrameTime = currentTime;
 
         m_sdk.window->pollEvents();
+        applyLoadedScene();
         m_sdk.uiManager->startFrame();
         
         update(deltaTime);
@@ -57,9 +85,89 @@ void Application::run()
     }
 }
 
+void Application::registerSystems()
+{
+    SystemDesc fpsCamera;
+    fpsCamera.name = "FPS Camera";
+    fpsCamera.mainThread = true; // Polls input and toggles the cursor
+    fpsCamera.read<ActiveCamera>().write<TransformComponent>();
+    fpsCamera.update = [this](Scene& scene, float deltaTime)
+    {
+        m_fpsCameraSystem->update(scene, deltaTime, m_editorUI->isSceneViewActive());
+    };
+    m_sdk.scheduler->addSystem(std::move(fpsCamera));
+
+    SystemDesc boundsSetup;
+    boundsSetup.name = "Bounds Setup";
+    boundsSetup.mainThread = true; // Adds WorldBoundsComponent, drops unindexable entities from the tree
+    boundsSetup.read<TransformComponent, MeshRendererComponent, PrefabInstanceComponent, Inactive>().write<WorldBoundsComponent, BoundsDirty>();
+    boundsSetup.update = [](Scene& scene, float deltaTime)
+    {
+        UNUSED(deltaTime);
+        scene.prepareWorldBounds();
+    };
+    m_sdk.scheduler->addSystem(std::move(boundsSetup));
+
+    SystemDesc worldBounds;
+    worldBounds.name = "World Bounds";
+    worldBounds.read<TransformComponent, MeshRendererComponent, PrefabInstanceComponent, BoundsDirty, Inactive>().write<WorldBoundsComponent>();
+    worldBounds.update = [this](Scene& scene, float deltaTime)
+    {
+        UNUSED(deltaTime);
+        m_sdk.scheduler->parallelEach<BoundsDirty, TransformComponent, WorldBoundsComponent>(scene.getRegistry(),
+            [&scene](entt::entity entity, TransformComponent& transform, WorldBoundsComponent& bounds)
+            {
+                scene.computeWorldBounds(entity, transform, bounds);
+            });
+    };
+    m_sdk.scheduler->addSystem(std::move(worldBounds));
+
+    SystemDesc spatialIndex;
+    spatialIndex.name = "Spatial Index";
+    spatialIndex.mainThread = true; // Mutates the tree and clears BoundsDirty
+    spatialIndex.write<WorldBoundsComponent, BoundsDirty>();
+    spatialIndex.update = [](Scene& scene, float deltaTime)
+    {
+        UNUSED(deltaTime);
+        scene.refitSpatialIndex();
+    };
+    m_sdk.scheduler->addSystem(std::move(spatialIndex));
+
+    SystemDesc worldStreaming;
+    worldStreaming.name = "World Streaming";
+    worldStreaming.mainThread = true;
+    worldStreaming.exclusive = true; // Creates and destroys cell entities
+    worldStreaming.update = [this](Scene& scene, float deltaTime)
+    {
+        UNUSED(deltaTime);
+        m_sdk.worldStreamer->update(scene);
+    };
+    m_sdk.scheduler->addSystem(std::move(worldStreaming));
+}
+
+void Application::applyLoadedScene()
+{
+    // Frame boundary: no system, render pass or UI holds on to the old scene here
+    std::unique_ptr<Scene> scene = m_sdk.sceneLoader->takeLoaded();
+    if (!scene) return;
+
+    m_sdk.worldStreamer->close();
+    m_sdk.renderer->detachScene();
+    m_editorUI->detachScene();
+    m_sdk.scene = std::move(scene);
+    m_sdk.renderer->attachScene(*m_sdk.scene);
+    m_editorUI->attachScene(*m_sdk.scene);
+
+    // Resources only the previous scene used
+    m_sdk.resourceManager->collectUnused();
+}
+
 void Application::update(float deltaTime) 
 {
-    m_fpsCameraSystem->update(*m_sdk.scene, deltaTime, m_editorUI->isSceneViewActive());
+    m_sdk.scheduler->run(*m_sdk.scene, deltaTime);
+
+    // Despawns requested by systems this frame, batched
+    m_sdk.scene->flushDestroyed();
 }
 
 void Application::render() 
@@ -68,14 +176,19 @@ void Application::render()
     
     m_editorUI->setupDockingSpace();
     m_editorUI->renderMenuBar(m_sdk);
-    m_editorUI->renderSceneView(static_cast<uintptr_t>(m_sdk.renderer->getFrameBuffer().colorTexture));
+    m_editorUI->renderSceneView(m_sdk);
     m_editorUI->renderEntityBrowser(*m_sdk.scene);
     m_editorUI->renderEntityDetails(*m_sdk.scene);
 }
 
 void Application::cleanup()
 {
+    m_sdk.sceneLoader.reset();
+    m_sdk.worldStreamer.reset();
+    m_sdk.scheduler.reset();
+    m_sdk.jobSystem.reset();
     m_sdk.uiManager->cleanup();
+    m_sdk.resourceManager->onCollected().disconnect(*m_sdk.renderer);
     m_sdk.renderer->cleanup();
     m_sdk.resourceManager->cleanup();
     m_sdk.window.reset();
@@ -13,7 +13,9 @@ public:
     Application() = default;
 
     bool initialize(int width, int height, const char* title);
-    bool loadScene(const std::string& path);
+    // False if the scene can't be opened; a background load reports its outcome,
+    // including failure and cancellation, through onLoaded on the main thread
+    bool loadScene(const std::string& path, SceneLoader::CompletionCallback onLoaded = nullptr);
     void run();
     void cleanup();
 
@@ -21,6 +23,8 @@ private:
     void processInput(float deltaTime);
     void update(float deltaTime);
     void render();
+    void registerSystems();
+    void applyLoadedScene();
 
     SDK m_sdk;
 
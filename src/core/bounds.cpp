@@ -0,0 +1,235 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE__)
+    #define ENGINE_SIMD_SSE
+    #include <xmmintrin.h>
+#endif
+
+namespace Engine {
+
+AABB BoundsUtils::computeAABB(const std::vector<glm::vec3>& points)
+{
+    AABB aabb;
+    for (const auto& point : points)
+    {
+        aabb.min = glm::min(aabb.min, point);
+        aabb.max = glm::max(aabb.max, point);
+    }
+    return aabb;
+}
+
+BoundingSphere BoundsUtils::computeBoundingSphere(const std::vector<glm::vec3>& points, const AABB& aabb)
+{
+    BoundingSphere sphere;
+    if (!aabb.isValid()) return sphere;
+
+    // Centered on the box, radius reaches the farthest vertex (tighter than the half diagonal)
+    sphere.center = aabb.center();
+    float maxDistanceSq = 0.0f;
+    for (const auto& point : points)
+    {
+        glm::vec3 delta = point - sphere.center;
+        maxDistanceSq = std::max(maxDistanceSq, glm::dot(delta, delta));
+    }
+    sphere.radius = std::sqrt(maxDistanceSq);
+
+    return sphere;
+}
+
+AABB BoundsUtils::transformAABB(const AABB& aabb, const glm::mat4& matrix)
+{
+    if (!aabb.isValid()) return aabb;
+
+    // Arvo's method: project the extents on the absolute rotation/scale basis
+    glm::vec3 center = glm::vec3(matrix * glm::vec4(aabb.center(), 1.0f));
+    glm::vec3 extents = aabb.extents();
+    glm::vec3 newExtents =
+        glm::abs(glm::vec3(matrix[0])) * extents.x +
+        glm::abs(glm::vec3(matrix[1])) * extents.y +
+        glm::abs(glm::vec3(matrix[2])) * extents.z;
+
+    return { center - newExtents, center + newExtents };
+}
+
+BoundingSphere BoundsUtils::transformSphere(const BoundingSphere& sphere, const glm::mat4& matrix)
+{
+    float scaleX = glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0]));
+    float scaleY = glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]));
+    float scaleZ = glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]));
+    float maxScale = std::sqrt(std::max(scaleX, std::max(scaleY, scaleZ)));
+
+    return {
+        glm::vec3(matrix * glm::vec4(sphere.center, 1.0f)),
+        sphere.radius * maxScale
+    };
+}
+
+Frustum BoundsUtils::extractFrustum(const glm::mat4& viewProjection)
+{
+    // Gribb/Hartmann extraction, glm matrices are column-major
+    const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    const glm::vec4 planes[6] =
+    {
+        row3 + row0, // Left
+        row3 - row0, // Right
+        row3 + row1, // Bottom
+        row3 - row1, // Top
+        row3 + row2, // Near
+        row3 - row2  // Far
+    };
+
+    Frustum frustum;
+    for (int i = 0; i < 6; i++)
+    {
+        float length = glm::length(glm::vec3(planes[i]));
+        frustum.planes[i].normal = glm::vec3(planes[i]) / length;
+        frustum.planes[i].distance = planes[i].w / length;
+    }
+
+    return frustum;
+}
+
+FrustumTest BoundsUtils::testFrustum(const Frustum& frustum, const AABB& aabb)
+{
+    glm::vec3 center = aabb.center();
+    glm::vec3 extents = aabb.extents();
+
+    FrustumTest result = FrustumTest::Inside;
+    for (const auto& plane : frustum.planes)
+    {
+        float distance = glm::dot(plane.normal, center) + plane.distance;
+        float radius = glm::dot(extents, glm::abs(plane.normal));
+
+        if (distance + radius < 0.0f) return FrustumTest::Outside;
+        if (distance - radius < 0.0f) result = FrustumTest::Intersects;
+    }
+
+    return result;
+}
+
+bool BoundsUtils::intersects(const AABB& aabb, const BoundingSphere& sphere)
+{
+    glm::vec3 closest = glm::clamp(sphere.center, aabb.min, aabb.max);
+    glm::vec3 delta = closest - sphere.center;
+    return glm::dot(delta, delta) <= sphere.radius * sphere.radius;
+}
+
+glm::vec3 BoundsUtils::inverseDirection(const glm::vec3& direction)
+{
+    const float epsilon = 1e-20f;
+    glm::vec3 clamped;
+    for (int i = 0; i < 3; i++)
+    {
+        clamped[i] = std::abs(direction[i]) < epsilon ? std::copysign(epsilon, direction[i]) : direction[i];
+    }
+    return 1.0f / clamped;
+}
+
+bool BoundsUtils::intersectRay(const Ray& ray, const glm::vec3& invDirection, const AABB& aabb, float maxDistance, float& distance)
+{
+    // Slab test
+    glm::vec3 t1 = (aabb.min - ray.origin) * invDirection;
+    glm::vec3 t2 = (aabb.max - ray.origin) * invDirection;
+    glm::vec3 tNear = glm::min(t1, t2);
+    glm::vec3 tFar = glm::max(t1, t2);
+
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+
+    distance = enter;
+    return enter <= exit;
+}
+
+void FrustumCuller::clear()
+{
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_radius.clear();
+    m_count = 0;
+}
+
+void FrustumCuller::reserve(size_t count)
+{
+    m_centerX.reserve(count);
+    m_centerY.reserve(count);
+    m_centerZ.reserve(count);
+    m_radius.reserve(count);
+}
+
+void FrustumCuller::add(const BoundingSphere& sphere)
+{
+    m_centerX.push_back(sphere.center.x);
+    m_centerY.push_back(sphere.center.y);
+    m_centerZ.push_back(sphere.center.z);
+    m_radius.push_back(sphere.radius);
+    m_count++;
+}
+
+void FrustumCuller::cull(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+    size_t i = 0;
+
+#ifdef ENGINE_SIMD_SSE
+    for (; i + 4 <= m_count; i += 4)
+    {
+        const __m128 centerX = _mm_loadu_ps(&m_centerX[i]);
+        const __m128 centerY = _mm_loadu_ps(&m_centerY[i]);
+        const __m128 centerZ = _mm_loadu_ps(&m_centerZ[i]);
+        const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&m_radius[i]));
+
+        __m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps()); // All lanes set
+        for (const auto& plane : frustum.planes)
+        {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(centerX, _mm_set1_ps(plane.normal.x)),
+                    _mm_mul_ps(centerY, _mm_set1_ps(plane.normal.y))
+                ),
+                _mm_add_ps(
+                    _mm_mul_ps(centerZ, _mm_set1_ps(plane.normal.z)),
+                    _mm_set1_ps(plane.distance)
+                )
+            );
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        while (mask)
+        {
+            int lane = 0;
+            while (!(mask & (1 << lane))) lane++;
+            visible.push_back(static_cast<uint32_t>(i + lane));
+            mask &= ~(1 << lane);
+        }
+    }
+#endif
+
+    // Scalar tail (or whole range without SSE)
+    for (; i < m_count; i++)
+    {
+        bool inside = true;
+        for (const auto& plane : frustum.planes)
+        {
+            float distance = plane.normal.x * m_centerX[i]
+                           + plane.normal.y * m_centerY[i]
+                           + plane.normal.z * m_centerZ[i]
+                           + plane.distance;
+            if (distance < -m_radius[i])
+            {
+                inside = false;
+                break;
+            }
+        }
+        if (inside) visible.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Engine {
+
+struct AABB
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool isValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+    float surfaceArea() const
+    {
+        glm::vec3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    bool contains(const AABB& other) const
+    {
+        return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+    }
+
+    bool overlaps(const AABB& other) const
+    {
+        return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+    }
+
+    static AABB merge(const AABB& a, const AABB& b)
+    {
+        return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+    }
+};
+
+struct BoundingSphere
+{
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+// Points with dot(normal, p) + distance >= 0 are on the inner side
+struct Plane
+{
+    glm::vec3 normal = glm::vec3(0.0f);
+    float distance = 0.0f;
+};
+
+struct Frustum
+{
+    Plane planes[6]; // Left, right, bottom, top, near, far
+};
+
+struct Ray
+{
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+};
+
+enum class FrustumTest : uint8_t
+{
+    Outside,
+    Intersects,
+    Inside
+};
+
+class BoundsUtils
+{
+public:
+    static AABB computeAABB(const std::vector<glm::vec3>& points);
+    static BoundingSphere computeBoundingSphere(const std::vector<glm::vec3>& points, const AABB& aabb);
+
+    static AABB transformAABB(const AABB& aabb, const glm::mat4& matrix);
+    static BoundingSphere transformSphere(const BoundingSphere& sphere, const glm::mat4& matrix);
+
+    static Frustum extractFrustum(const glm::mat4& viewProjection);
+    static FrustumTest testFrustum(const Frustum& frustum, const AABB& aabb);
+
+    static bool intersects(const AABB& aabb, const BoundingSphere& sphere);
+    // Reciprocal for intersectRay. Zero components become a signed epsilon, so an
+    // axis-aligned ray starting on a slab plane doesn't produce 0 * inf = NaN.
+    static glm::vec3 inverseDirection(const glm::vec3& direction);
+    static bool intersectRay(const Ray& ray, const glm::vec3& invDirection, const AABB& aabb, float maxDistance, float& distance);
+};
+
+// Batched sphere/frustum test. Spheres are stored as SoA so four of them
+// are tested per plane with a single SSE instruction stream.
+class FrustumCuller
+{
+public:
+    void clear();
+    void reserve(size_t count);
+    void add(const BoundingSphere& sphere);
+    size_t size() const { return m_count; }
+
+    // Appends the indices (in insertion order) of spheres touching the frustum
+    void cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+private:
+    std::vector<float> m_centerX, m_centerY, m_centerZ, m_radius;
+    size_t m_count = 0;
+};
+
+}
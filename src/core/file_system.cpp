@@ -30,4 +30,19 @@ std::string FileSystem::read(const std::string &filename)
     return fileStream.str();
 }
 
+bool FileSystem::readBinary(const std::string &filename, std::vector<uint8_t> &data)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        std::cout << "FileManager: error reading file: " << filename << std::endl;
+        return false;
+    }
+
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
 }
\ No newline at end of file
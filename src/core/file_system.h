@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstdint>
 
 namespace Engine {
 
@@ -11,6 +13,7 @@ public:
     ~FileSystem();
 
     static std::string read(const std::string &filename);
+    static bool readBinary(const std::string &filename, std::vector<uint8_t> &data);
 };
 
 }
\ No newline at end of file
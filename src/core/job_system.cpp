@@ -0,0 +1,119 @@
+#include "job_system.h"
+
+#include <algorithm>
+
+namespace Engine {
+
+JobSystem::JobSystem(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    m_workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        m_workers.emplace_back(&JobSystem::workerLoop, this);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void JobSystem::run(JobGroup& group, std::function<void()> job)
+{
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back({ std::move(job), &group });
+    }
+    m_condition.notify_one();
+}
+
+void JobSystem::wait(JobGroup& group)
+{
+    while (group.pending.load(std::memory_order_acquire) > 0)
+    {
+        if (!runPending())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::runPending()
+{
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.empty()) return false;
+
+        job = std::move(m_queue.front());
+        m_queue.pop_front();
+    }
+
+    execute(job);
+    return true;
+}
+
+void JobSystem::parallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)>& fn)
+{
+    if (count == 0) return;
+
+    // Roughly four chunks per thread (workers + caller) for load balancing
+    size_t threads = m_workers.size() + 1;
+    size_t chunkSize = std::max(minChunkSize, (count + threads * 4 - 1) / (threads * 4));
+    if (chunkSize >= count)
+    {
+        fn(0, count);
+        return;
+    }
+
+    JobGroup group;
+    for (size_t begin = 0; begin < count; begin += chunkSize)
+    {
+        size_t end = std::min(begin + chunkSize, count);
+        run(group, [&fn, begin, end]() { fn(begin, end); });
+    }
+    wait(group);
+}
+
+void JobSystem::workerLoop()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+
+            if (m_stopping && m_queue.empty()) return;
+
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        execute(job);
+    }
+}
+
+void JobSystem::execute(Job& job)
+{
+    job.function();
+    job.group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Engine {
+
+// Counts outstanding jobs submitted together so they can be waited on
+struct JobGroup
+{
+    std::atomic<uint32_t> pending = 0;
+};
+
+// Fixed pool of worker threads consuming a shared FIFO of short jobs.
+// Threads waiting on a group help execute queued jobs instead of blocking.
+class JobSystem
+{
+public:
+    explicit JobSystem(uint32_t threadCount = 0); // 0 = one less than the hardware threads
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void run(JobGroup& group, std::function<void()> job);
+    void wait(JobGroup& group);
+
+    // Runs one queued job on the calling thread, returns false if the queue was empty
+    bool runPending();
+
+    // Splits [0, count) into chunks of at least minChunkSize and runs fn(begin, end) on them
+    void parallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)>& fn);
+
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+private:
+    struct Job
+    {
+        std::function<void()> function;
+        JobGroup* group;
+    };
+
+    void workerLoop();
+    void execute(Job& job);
+
+    std::vector<std::thread> m_workers;
+    std::deque<Job> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+};
+
+}
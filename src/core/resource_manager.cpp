@@ -16,61 +16,96 @@ namespace Engine {
 
 using json = nlohmann::json;
 
-std::shared_ptr<Image> ResourceManager::loadTexture(const std::string& path)
-{   
-    Image texture;
-    if (!loadTextureFromFile(path, &texture)) 
+template <typename T, typename LoadFn>
+std::shared_ptr<T> ResourceManager::findOrLoad(std::unordered_map<StringId, std::shared_ptr<T>>& resources,
+                                               const std::string& path, LoadFn load)
+{
+    const StringId id(path);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (auto it = resources.find(id); it != resources.end()) return it->second;
+    }
+
+    auto resource = std::make_shared<T>();
+    if (!load(path, resource.get()))
     {
         return nullptr;
     }
+    resource->uuid = UUID_generate();
+    resource->path = id;
 
-    UUID uuid = UUID_generate();
-    texture.uuid = uuid;
+    // Another thread may have loaded the same file meanwhile, the first one wins
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return resources.try_emplace(id, resource).first->second;
+}
 
-    std::shared_ptr<Image> sharedTexture = std::make_shared<Image>(texture);
-    m_textures[uuid] = sharedTexture;
-    return sharedTexture;
+std::shared_ptr<Image> ResourceManager::loadTexture(const std::string& path)
+{   
+    return findOrLoad(m_textures, path, [this](const std::string& file, Image* texture)
+    {
+        return loadTextureFromFile(file, texture);
+    });
 }
 
 std::shared_ptr<MeshData> ResourceManager::loadMesh(const std::string& path)
 {
-    MeshData mesh;
-    if (!loadMeshFromFile(path, &mesh)) 
+    return findOrLoad(m_meshes, path, [this](const std::string& file, MeshData* mesh)
     {
-        return nullptr;
-    }
-
-    UUID uuid = UUID_generate();
-    mesh.uuid = uuid;
-
-    std::shared_ptr<MeshData> sharedMesh = std::make_shared<MeshData>(mesh);
-    m_meshes[uuid] = sharedMesh;
-    return sharedMesh;
+        return loadMeshFromFile(file, mesh);
+    });
 }
 
 std::shared_ptr<Material> ResourceManager::loadMaterial(const std::string& path)
 {
-    Material material;
-    if (!deserializeMaterial(path, &material)) 
+    return findOrLoad(m_materials, path, [this](const std::string& file, Material* material)
     {
-        return nullptr;
-    }
-
-    UUID uuid = UUID_generate();
-    material.uuid = uuid;
-
-    std::shared_ptr<Material> sharedMaterial = std::make_shared<Material>(material);
-    m_materials[uuid] = sharedMaterial;
-    return sharedMaterial;
+        return deserializeMaterial(file, material);
+    });
 }
 
 void ResourceManager::cleanup() 
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_textures.clear();
     m_meshes.clear();
     m_materials.clear();
 }
 
+template <typename T>
+static size_t eraseUnused(std::unordered_map<StringId, std::shared_ptr<T>>& resources)
+{
+    size_t erased = 0;
+    for (auto it = resources.begin(); it != resources.end();)
+    {
+        if (it->second.use_count() == 1)
+        {
+            it = resources.erase(it);
+            erased++;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return erased;
+}
+
+size_t ResourceManager::collectUnused()
+{
+    size_t erased = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Materials first, they hold the last references to their textures
+        erased += eraseUnused(m_materials);
+        erased += eraseUnused(m_meshes);
+        erased += eraseUnused(m_textures);
+    }
+
+    if (erased > 0) m_collectedSignal.publish();
+    return erased;
+}
+
 bool ResourceManager::loadTextureFromFile(const std::string& path, Image* texture) 
 {
     // Clear any existing data
@@ -198,6 +233,13 @@ bool ResourceManager::loadMeshFromFile(const std::string& path, MeshData* mesh)
                 mesh->indices.push_back(face.mIndices[j]);
             }
         }
+
+        // Local space bounds
+        mesh->bounds = BoundsUtils::computeAABB(mesh->vertices);
+        mesh->boundingSphere = BoundsUtils::computeBoundingSphere(mesh->vertices, mesh->bounds);
+
+        // Acceleration structure for precise ray queries (picking)
+        mesh->triangleBVH.build(mesh->vertices, mesh->indices);
     }
     else 
     {
@@ -1,14 +1,20 @@
 #pragma once
 
-#include <map>
+#include <unordered_map>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <entt/signal/sigh.hpp>
 
 #include "uuid.h"
+#include "string_id.h"
 #include "resources.h"
 
 namespace Engine {
 
+// Loading is thread-safe, files are read outside the lock and only the
+// registries are guarded. Resources are cached by path: loading a file that is
+// already resident returns the shared copy until collectUnused drops it.
 class ResourceManager
 {
 public:
@@ -20,14 +26,30 @@ public:
 
     void cleanup();
 
+    // Drops resources nothing outside the manager references anymore
+    size_t collectUnused();
+
+    // Fired by collectUnused when it dropped anything, so GPU copies can follow
+    entt::sink<entt::sigh<void()>> onCollected()
+    {
+        return entt::sink{ m_collectedSignal };
+    }
+
 private:
     bool loadTextureFromFile(const std::string& path, Image* texture);
     bool loadMeshFromFile(const std::string& path, MeshData* mesh);
     bool deserializeMaterial(const std::string& path, Material* material);
 
-    std::map<UUID, std::shared_ptr<Image>> m_textures;
-    std::map<UUID, std::shared_ptr<MeshData>> m_meshes;
-    std::map<UUID, std::shared_ptr<Material>> m_materials;
+    template <typename T, typename LoadFn>
+    std::shared_ptr<T> findOrLoad(std::unordered_map<StringId, std::shared_ptr<T>>& resources,
+                                  const std::string& path, LoadFn load);
+
+    // Keyed by interned path, lookups hash a pointer instead of the path text
+    std::unordered_map<StringId, std::shared_ptr<Image>> m_textures;
+    std::unordered_map<StringId, std::shared_ptr<MeshData>> m_meshes;
+    std::unordered_map<StringId, std::shared_ptr<Material>> m_materials;
+    std::mutex m_mutex;
+    entt::sigh<void()> m_collectedSignal;
 };
 
 }
\ No newline at end of file
@@ -1,9 +1,13 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <memory>
 #include <glm/glm.hpp>
 #include "uuid.h"
+#include "string_id.h"
+#include "bounds.h"
+#include "triangle_bvh.h"
 
 namespace Engine {
 
@@ -14,6 +18,7 @@ struct Image
     uint32_t width;
     uint32_t height;
     uint32_t channels;
+    StringId path; // Source file, empty for generated images
 };
 
 struct MeshData
@@ -24,7 +29,11 @@ struct MeshData
     std::vector<glm::vec3> bitangents;
     std::vector<glm::vec2> uvs;
     std::vector<uint32_t> indices;
+    AABB bounds;
+    BoundingSphere boundingSphere;
+    TriangleBVH triangleBVH;
     UUID uuid;
+    StringId path;
 };
 
 struct Material 
@@ -37,6 +46,7 @@ struct Material
     float shininess = 32.0f;
     float opacity = 1.0f;
     UUID uuid;
+    StringId path;
 };
 
 }
@@ -3,8 +3,11 @@
 #include "window.h"
 #include "renderer/opengl.h"
 #include "scene/scene.h"
+#include "scene/world_streamer.h"
+#include "scene/scene_loader.h"
 #include "ui/ui_manager.h"
-#include "renderer/opengl.h"
+#include "job_system.h"
+#include "system_scheduler.h"
 
 namespace Engine {
 
@@ -15,6 +18,10 @@ struct SDK
     std::unique_ptr<UIManager> uiManager;
     std::unique_ptr<ResourceManager> resourceManager;
     std::unique_ptr<OpenGL::Renderer> renderer;
+    std::unique_ptr<JobSystem> jobSystem;
+    std::unique_ptr<SystemScheduler> scheduler;
+    std::unique_ptr<WorldStreamer> worldStreamer;
+    std::unique_ptr<SceneLoader> sceneLoader;
 };
 
 }
\ No newline at end of file
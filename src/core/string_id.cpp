@@ -0,0 +1,47 @@
+#include "string_id.h"
+
+#include <unordered_set>
+#include <mutex>
+#include <shared_mutex>
+
+namespace Engine {
+
+// Heterogeneous lookup, so finding an existing string doesn't allocate
+struct StringHash
+{
+    using is_transparent = void;
+
+    size_t operator()(std::string_view text) const
+    {
+        return std::hash<std::string_view>()(text);
+    }
+};
+
+// Set nodes never move, the ids point straight at the stored strings
+static std::unordered_set<std::string, StringHash, std::equal_to<>> s_strings;
+static std::shared_mutex s_stringsMutex;
+
+StringId::StringId(std::string_view text)
+{
+    if (text.empty()) return;
+
+    {
+        std::shared_lock<std::shared_mutex> lock(s_stringsMutex);
+        if (auto it = s_strings.find(text); it != s_strings.end())
+        {
+            m_string = &*it;
+            return;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(s_stringsMutex);
+    m_string = &*s_strings.emplace(text).first;
+}
+
+const std::string& StringId::str() const
+{
+    static const std::string emptyString;
+    return m_string ? *m_string : emptyString;
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <functional>
+
+namespace Engine {
+
+// Interned string: every distinct text is stored once in a global table and ids
+// refer to that copy, so comparing and hashing are pointer operations. Interning
+// is thread-safe; interned text lives until the program exits.
+class StringId
+{
+public:
+    StringId() = default;
+    explicit StringId(std::string_view text);
+    explicit StringId(const char* text) : StringId(std::string_view(text)) {}
+    explicit StringId(const std::string& text) : StringId(std::string_view(text)) {}
+
+    const std::string& str() const;
+    const char* c_str() const { return str().c_str(); }
+    bool empty() const { return m_string == nullptr; }
+
+    bool operator==(const StringId& other) const = default;
+
+    size_t hash() const
+    {
+        return std::hash<const std::string*>()(m_string);
+    }
+
+private:
+    // Null for the empty string
+    const std::string* m_string = nullptr;
+};
+
+}
+
+template <>
+struct std::hash<Engine::StringId>
+{
+    size_t operator()(const Engine::StringId& id) const
+    {
+        return id.hash();
+    }
+};
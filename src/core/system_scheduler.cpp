@@ -0,0 +1,144 @@
+#include "system_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+namespace Engine {
+
+static bool overlaps(const std::vector<entt::id_type>& a, const std::vector<entt::id_type>& b)
+{
+    for (entt::id_type id : a)
+    {
+        if (std::find(b.begin(), b.end(), id) != b.end()) return true;
+    }
+    return false;
+}
+
+void SystemScheduler::addSystem(SystemDesc system)
+{
+    SystemTiming timing;
+    timing.name = system.name;
+    timing.mainThread = system.mainThread;
+
+    m_systems.push_back(std::move(system));
+    m_timings.push_back(timing);
+    m_graphDirty = true;
+}
+
+bool SystemScheduler::conflicts(const SystemDesc& a, const SystemDesc& b)
+{
+    if (a.exclusive || b.exclusive) return true;
+    return overlaps(a.writes, b.writes) || overlaps(a.writes, b.reads) || overlaps(a.reads, b.writes);
+}
+
+void SystemScheduler::buildGraph()
+{
+    const size_t count = m_systems.size();
+    m_dependents.assign(count, {});
+    m_dependencyCounts.assign(count, 0);
+
+    // Conflicting systems keep their registration order
+    for (uint32_t i = 0; i < count; i++)
+    {
+        for (uint32_t j = i + 1; j < count; j++)
+        {
+            if (conflicts(m_systems[i], m_systems[j]))
+            {
+                m_dependents[i].push_back(j);
+                m_dependencyCounts[j]++;
+            }
+        }
+    }
+
+    m_graphDirty = false;
+}
+
+void SystemScheduler::run(Scene& scene, float deltaTime)
+{
+    if (m_systems.empty()) return;
+    if (m_graphDirty) buildGraph();
+
+    // Create storages up front, workers must not add pools to the registry concurrently
+    entt::registry& registry = scene.getRegistry();
+    for (auto& system : m_systems)
+    {
+        for (auto storage : system.storages) storage(registry);
+    }
+
+    const size_t count = m_systems.size();
+    std::unique_ptr<std::atomic<uint32_t>[]> remaining(new std::atomic<uint32_t>[count]);
+    for (size_t i = 0; i < count; i++)
+    {
+        remaining[i].store(m_dependencyCounts[i], std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> completed = 0;
+    std::mutex mainMutex;
+    std::vector<uint32_t> mainReady;
+    JobGroup group;
+
+    std::function<void(uint32_t)> schedule;
+    auto execute = [&](uint32_t index)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        m_systems[index].update(scene, deltaTime);
+        auto end = std::chrono::high_resolution_clock::now();
+        m_timings[index].milliseconds = std::chrono::duration<float, std::milli>(end - start).count();
+
+        for (uint32_t dependent : m_dependents[index])
+        {
+            if (remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                schedule(dependent);
+            }
+        }
+        completed.fetch_add(1, std::memory_order_release);
+    };
+
+    schedule = [&](uint32_t index)
+    {
+        if (m_systems[index].mainThread)
+        {
+            std::lock_guard<std::mutex> lock(mainMutex);
+            mainReady.push_back(index);
+        }
+        else
+        {
+            m_jobs.run(group, [&execute, index]() { execute(index); });
+        }
+    };
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (m_dependencyCounts[i] == 0) schedule(i);
+    }
+
+    // Main thread runs its own systems and helps with worker jobs until everything is done
+    while (completed.load(std::memory_order_acquire) < count)
+    {
+        uint32_t index = UINT32_MAX;
+        {
+            std::lock_guard<std::mutex> lock(mainMutex);
+            if (!mainReady.empty())
+            {
+                index = mainReady.back();
+                mainReady.pop_back();
+            }
+        }
+
+        if (index != UINT32_MAX)
+        {
+            execute(index);
+        }
+        else if (!m_jobs.runPending())
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    m_jobs.wait(group);
+}
+
+}
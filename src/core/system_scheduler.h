@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <tuple>
+#include <vector>
+#include <functional>
+#include <entt/entity/registry.hpp>
+#include "job_system.h"
+#include "scene/scene.h"
+
+namespace Engine {
+
+// A per-frame system together with the component types it touches. Systems running
+// on workers may modify and patch the components they declare, but must not create
+// or destroy entities or add/remove components.
+struct SystemDesc
+{
+    std::string name;
+    std::function<void(Scene&, float)> update;
+
+    std::vector<entt::id_type> reads;
+    std::vector<entt::id_type> writes;
+    std::vector<void (*)(entt::registry&)> storages;
+
+    // Systems that touch input, windowing or GL run on the calling thread
+    bool mainThread = false;
+
+    // Creates/destroys entities or adds/removes components, runs with no other system
+    bool exclusive = false;
+
+    template <typename... Components>
+    SystemDesc& read()
+    {
+        (declare<Components>(reads), ...);
+        return *this;
+    }
+
+    template <typename... Components>
+    SystemDesc& write()
+    {
+        (declare<Components>(writes), ...);
+        return *this;
+    }
+
+private:
+    template <typename Component>
+    void declare(std::vector<entt::id_type>& access)
+    {
+        access.push_back(entt::type_hash<Component>::value());
+        storages.push_back([](entt::registry& registry) { registry.storage<Component>(); });
+    }
+};
+
+struct SystemTiming
+{
+    std::string name;
+    float milliseconds = 0.0f;
+    bool mainThread = false;
+};
+
+// Runs registered systems each frame. A system depends on every earlier registered
+// system it conflicts with (one writes a component the other reads or writes);
+// systems without a path between them run concurrently on the job system.
+class SystemScheduler
+{
+public:
+    explicit SystemScheduler(JobSystem& jobs) : m_jobs(jobs) {}
+
+    void addSystem(SystemDesc system);
+    void run(Scene& scene, float deltaTime);
+
+    const std::vector<SystemTiming>& getTimings() const { return m_timings; }
+
+    // Iterates a view split across worker threads, fn(entity, Components&...). Like
+    // view.each(), tag components only filter and aren't passed. Entities parked in a
+    // pool are skipped. The storages must exist already (declare them on the system).
+    template <typename... Components, typename Fn>
+    void parallelEach(entt::registry& registry, Fn fn, size_t minChunkSize = 256)
+    {
+        auto view = registry.view<Components...>(entt::exclude<Inactive>);
+
+        // Not thread_local: parallelFor runs other jobs on this thread while it waits,
+        // and those may call parallelEach too
+        std::vector<entt::entity> entities(view.begin(), view.end());
+
+        m_jobs.parallelFor(entities.size(), minChunkSize, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                std::apply([&](auto&... components) { fn(entities[i], components...); }, view.get(entities[i]));
+            }
+        });
+    }
+
+private:
+    void buildGraph();
+    static bool conflicts(const SystemDesc& a, const SystemDesc& b);
+
+    JobSystem& m_jobs;
+    std::vector<SystemDesc> m_systems;
+    std::vector<SystemTiming> m_timings;
+
+    // Dependency graph, rebuilt when systems are added
+    std::vector<std::vector<uint32_t>> m_dependents;
+    std::vector<uint32_t> m_dependencyCounts;
+    bool m_graphDirty = true;
+};
+
+}
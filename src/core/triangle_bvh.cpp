@@ -0,0 +1,243 @@
+#include "triangle_bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Engine {
+
+const uint32_t MAX_LEAF_TRIANGLES = 4;
+const int SAH_BINS = 12;
+
+static bool intersectTriangle(
+    const Ray& ray,
+    const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+    float& distance
+) {
+    // Moller-Trumbore, double sided
+    const float epsilon = 1e-8f;
+
+    glm::vec3 edge1 = v1 - v0;
+    glm::vec3 edge2 = v2 - v0;
+    glm::vec3 p = glm::cross(ray.direction, edge2);
+    float det = glm::dot(edge1, p);
+    if (std::abs(det) < epsilon) return false;
+
+    float invDet = 1.0f / det;
+    glm::vec3 s = ray.origin - v0;
+    float u = glm::dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(ray.direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    distance = glm::dot(edge2, q) * invDet;
+    return distance > 0.0f;
+}
+
+void TriangleBVH::build(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices)
+{
+    m_nodes.clear();
+    m_triangles.clear();
+
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount == 0) return;
+
+    // Per-triangle bounds and centroids
+    std::vector<AABB> triangleBounds(triangleCount);
+    std::vector<glm::vec3> centroids(triangleCount);
+    m_triangles.resize(triangleCount);
+    for (uint32_t i = 0; i < triangleCount; i++)
+    {
+        const glm::vec3& v0 = vertices[indices[i * 3 + 0]];
+        const glm::vec3& v1 = vertices[indices[i * 3 + 1]];
+        const glm::vec3& v2 = vertices[indices[i * 3 + 2]];
+
+        triangleBounds[i] = { glm::min(v0, glm::min(v1, v2)), glm::max(v0, glm::max(v1, v2)) };
+        centroids[i] = (v0 + v1 + v2) / 3.0f;
+        m_triangles[i] = i;
+    }
+
+    m_nodes.reserve(static_cast<size_t>(triangleCount) * 2);
+    m_nodes.emplace_back();
+    m_nodes[0].leftFirst = 0;
+    m_nodes[0].count = triangleCount;
+
+    std::vector<uint32_t> stack;
+    stack.push_back(0);
+
+    while (!stack.empty())
+    {
+        uint32_t nodeIndex = stack.back();
+        stack.pop_back();
+
+        const uint32_t first = m_nodes[nodeIndex].leftFirst;
+        const uint32_t count = m_nodes[nodeIndex].count;
+
+        AABB bounds;
+        AABB centroidBounds;
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            bounds = AABB::merge(bounds, triangleBounds[m_triangles[i]]);
+            centroidBounds.min = glm::min(centroidBounds.min, centroids[m_triangles[i]]);
+            centroidBounds.max = glm::max(centroidBounds.max, centroids[m_triangles[i]]);
+        }
+        m_nodes[nodeIndex].aabb = bounds;
+
+        if (count <= MAX_LEAF_TRIANGLES) continue;
+
+        // Binned SAH split search
+        int bestAxis = -1;
+        int bestSplit = 0;
+        float bestCost = static_cast<float>(count) * bounds.surfaceArea();
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float axisMin = centroidBounds.min[axis];
+            float axisExtent = centroidBounds.max[axis] - axisMin;
+            if (axisExtent <= 0.0f) continue;
+
+            AABB binBounds[SAH_BINS];
+            uint32_t binCounts[SAH_BINS] = {};
+            float scale = static_cast<float>(SAH_BINS) / axisExtent;
+
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                uint32_t triangle = m_triangles[i];
+                int bin = std::min(SAH_BINS - 1, static_cast<int>((centroids[triangle][axis] - axisMin) * scale));
+                binCounts[bin]++;
+                binBounds[bin] = AABB::merge(binBounds[bin], triangleBounds[triangle]);
+            }
+
+            // Sweep from the left accumulating area * count, then from the right evaluating splits
+            float leftCost[SAH_BINS - 1];
+            AABB leftBounds;
+            uint32_t leftCount = 0;
+            for (int i = 0; i < SAH_BINS - 1; i++)
+            {
+                leftCount += binCounts[i];
+                leftBounds = AABB::merge(leftBounds, binBounds[i]);
+                leftCost[i] = leftCount ? static_cast<float>(leftCount) * leftBounds.surfaceArea() : 0.0f;
+            }
+
+            AABB rightBounds;
+            uint32_t rightCount = 0;
+            for (int i = SAH_BINS - 1; i > 0; i--)
+            {
+                rightCount += binCounts[i];
+                rightBounds = AABB::merge(rightBounds, binBounds[i]);
+                if (rightCount == 0 || rightCount == count) continue;
+
+                float cost = leftCost[i - 1] + static_cast<float>(rightCount) * rightBounds.surfaceArea();
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        // Splitting doesn't pay off
+        if (bestAxis < 0) continue;
+
+        // Partition triangles around the chosen bin boundary
+        float axisMin = centroidBounds.min[bestAxis];
+        float scale = static_cast<float>(SAH_BINS) / (centroidBounds.max[bestAxis] - axisMin);
+        auto middle = std::partition(
+            m_triangles.begin() + first,
+            m_triangles.begin() + first + count,
+            [&](uint32_t triangle)
+            {
+                int bin = std::min(SAH_BINS - 1, static_cast<int>((centroids[triangle][bestAxis] - axisMin) * scale));
+                return bin < bestSplit;
+            }
+        );
+        uint32_t leftCount = static_cast<uint32_t>(middle - m_triangles.begin()) - first;
+        if (leftCount == 0 || leftCount == count) continue;
+
+        uint32_t leftIndex = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+        m_nodes.emplace_back();
+
+        m_nodes[leftIndex].leftFirst = first;
+        m_nodes[leftIndex].count = leftCount;
+        m_nodes[leftIndex + 1].leftFirst = first + leftCount;
+        m_nodes[leftIndex + 1].count = count - leftCount;
+
+        m_nodes[nodeIndex].leftFirst = leftIndex;
+        m_nodes[nodeIndex].count = 0;
+
+        stack.push_back(leftIndex);
+        stack.push_back(leftIndex + 1);
+    }
+
+    m_nodes.shrink_to_fit();
+}
+
+bool TriangleBVH::intersect(
+    const Ray& ray,
+    const std::vector<glm::vec3>& vertices,
+    const std::vector<uint32_t>& indices,
+    float maxDistance,
+    float& distance,
+    uint32_t& triangle
+) const {
+    if (m_nodes.empty()) return false;
+
+    const glm::vec3 invDirection = BoundsUtils::inverseDirection(ray.direction);
+    bool hit = false;
+
+    float entry;
+    if (!BoundsUtils::intersectRay(ray, invDirection, m_nodes[0].aabb, maxDistance, entry)) return false;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+
+    while (!stack.empty())
+    {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        if (node.isLeaf())
+        {
+            for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++)
+            {
+                uint32_t candidate = m_triangles[i];
+                float t;
+                if (intersectTriangle(ray,
+                        vertices[indices[candidate * 3 + 0]],
+                        vertices[indices[candidate * 3 + 1]],
+                        vertices[indices[candidate * 3 + 2]],
+                        t) && t < maxDistance)
+                {
+                    maxDistance = t;
+                    distance = t;
+                    triangle = candidate;
+                    hit = true;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first so the far one is more likely to be pruned
+        uint32_t nearChild = node.leftFirst;
+        uint32_t farChild = node.leftFirst + 1;
+        float nearDistance, farDistance;
+        bool nearHit = BoundsUtils::intersectRay(ray, invDirection, m_nodes[nearChild].aabb, maxDistance, nearDistance);
+        bool farHit = BoundsUtils::intersectRay(ray, invDirection, m_nodes[farChild].aabb, maxDistance, farDistance);
+
+        if (nearHit && farHit && farDistance < nearDistance)
+        {
+            std::swap(nearChild, farChild);
+        }
+
+        if (farHit) stack.push_back(farChild);
+        if (nearHit) stack.push_back(nearChild);
+    }
+
+    return hit;
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "bounds.h"
+
+namespace Engine {
+
+// Static binned-SAH BVH over the triangles of an indexed mesh, used for
+// precise ray queries (picking). Vertex and index data are not copied, they
+// are passed back in at query time.
+class TriangleBVH
+{
+public:
+    void build(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices);
+    bool isBuilt() const { return !m_nodes.empty(); }
+
+    // Closest hit closer than maxDistance, distance is in units of ray.direction
+    bool intersect(
+        const Ray& ray,
+        const std::vector<glm::vec3>& vertices,
+        const std::vector<uint32_t>& indices,
+        float maxDistance,
+        float& distance,
+        uint32_t& triangle
+    ) const;
+
+private:
+    struct Node
+    {
+        AABB aabb;
+        uint32_t leftFirst = 0; // Left child index, or first triangle for leaves
+        uint32_t count = 0;     // Triangle count, zero for internal nodes
+
+        bool isLeaf() const { return count > 0; }
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_triangles;
+};
+
+}
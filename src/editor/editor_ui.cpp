@@ -4,16 +4,98 @@
 #include <GLFW/glfw3.h>
 #include <imgui.h>
 #include <imgui_internal.h>
-#include <typeinfo>
+#include <cstdio>
+#include <filesystem>
 #include "tinyfiledialogs.h"
 #include "scene/components.h"
+#include "scene/prefab.h"
+#include "scene/component_meta.h"
 
 namespace Editor {
 
 using namespace Engine;
 
+// Field widgets, picked by value type. Each returns true when the value changed.
+template <typename Field>
+static bool inspectValue(const Field& field, float& value)
+{
+    return ImGui::DragFloat(field.label, &value, field.speed, field.min, field.max);
+}
+
+template <typename Field>
+static bool inspectValue(const Field& field, bool& value)
+{
+    return ImGui::Checkbox(field.label, &value);
+}
+
+template <typename Field>
+static bool inspectValue(const Field& field, glm::vec3& value)
+{
+    if (field.hint == FieldHint::Color) return ImGui::ColorEdit3(field.label, &value[0]);
+    return ImGui::DragFloat3(field.label, &value[0], field.speed);
+}
+
+template <typename Field>
+static bool inspectValue(const Field& field, glm::quat& value)
+{
+    glm::vec3 degrees = glm::degrees(glm::eulerAngles(value));
+    if (!ImGui::DragFloat3(field.label, &degrees[0], field.speed)) return false;
+
+    value = glm::quat(glm::radians(degrees));
+    return true;
+}
+
+// Typing edits a buffer, the text is interned once when the edit is committed so
+// every intermediate keystroke doesn't stay in the intern table
+template <typename Field>
+static bool inspectValue(const Field& field, StringId& value)
+{
+    static char buffer[256];
+    static ImGuiID editing = 0;
+
+    ImGuiID id = ImGui::GetID(field.label);
+    if (editing != id) std::snprintf(buffer, sizeof(buffer), "%s", value.c_str());
+
+    ImGui::InputText(field.label, buffer, sizeof(buffer));
+    if (ImGui::IsItemActive()) editing = id;
+    else if (editing == id) editing = 0;
+    if (!ImGui::IsItemDeactivatedAfterEdit()) return false;
+
+    value = StringId(buffer);
+    return true;
+}
+
+template <typename Field, typename E> requires std::is_enum_v<E>
+static bool inspectValue(const Field& field, E& value)
+{
+    const auto& names = EnumMeta<E>::names;
+    int selected = static_cast<int>(value);
+    if (!ImGui::Combo(field.label, &selected, names, IM_ARRAYSIZE(names))) return false;
+
+    value = static_cast<E>(selected);
+    return true;
+}
+
+// Resources are referenced by path and not editable here
+template <typename Field, typename Resource>
+static bool inspectValue(const Field& field, std::shared_ptr<Resource>& value)
+{
+    ImGui::TextDisabled("%s: %s", field.label, value ? value->path.c_str() : "None");
+    return false;
+}
+
 EditorUI::EditorUI() {}
 
+void EditorUI::attachScene(Engine::Scene& scene)
+{
+    m_entityList.attach(scene.getRegistry());
+}
+
+void EditorUI::detachScene()
+{
+    m_entityList.detach();
+}
+
 void EditorUI::setupDockingSpace()
 {
     // Create main docking space
@@ -67,6 +149,8 @@ void EditorUI::renderMenuBar(SDK& sdk)
         {
             if (ImGui::MenuItem("New Scene")) 
             {
+                sdk.sceneLoader->cancel();
+                sdk.worldStreamer->close();
                 sdk.scene->newScene();
             }
             
@@ -82,11 +166,79 @@ void EditorUI::renderMenuBar(SDK& sdk)
                     0              // Allow multiple selections (0 = no)
                 );
                 
+                if (filename != nullptr && WorldStreamer::isWorldFile(filename))
+                {
+                    sdk.sceneLoader->cancel();
+                    sdk.worldStreamer->open(filename, *sdk.scene, *sdk.resourceManager);
+                }
+                else if (filename != nullptr)
+                {
+                    // Loads in the background, the application swaps it in when done
+                    sdk.sceneLoader->start(filename, *sdk.resourceManager);
+                }
+            }
+
+            if (ImGui::MenuItem("Add Scene"))
+            {
+                const char* filters[] = { "*.json", "*.scene" };
+                const char* filename = tinyfd_openFileDialog("Add Scene", "", 2, filters, "Scene Files", 0);
+
+                // Merged into the current scene, resources it shares with it are reused
                 if (filename != nullptr)
                 {
-                    sdk.scene->loadScene(filename, *sdk.resourceManager);
+                    sdk.scene->addScene(filename, *sdk.resourceManager);
                 }
-            }            
+            }
+
+            if (ImGui::MenuItem("Save Scene"))
+            {
+                // The extension picks the format, ".scene" is the binary one
+                const char* filters[] = { "*.json", "*.scene" };
+                const char* filename = tinyfd_saveFileDialog("Save Scene", "scene.json", 2, filters, "Scene Files");
+
+                if (filename != nullptr)
+                {
+                    sdk.scene->saveScene(filename);
+                }
+            }
+
+            if (ImGui::BeginMenu("Loaded Scenes", !sdk.scene->getSources().empty()))
+            {
+                // Applied after the loop, both change the source list
+                uint32_t unload = 0, reload = 0;
+                for (const SceneSource& source : sdk.scene->getSources())
+                {
+                    std::string label = std::filesystem::path(source.path).filename().string() + "##" + std::to_string(source.id);
+                    if (ImGui::BeginMenu(label.c_str()))
+                    {
+                        if (ImGui::MenuItem("Reload")) reload = source.id;
+                        if (ImGui::MenuItem("Unload")) unload = source.id;
+                        ImGui::EndMenu();
+                    }
+                }
+
+                if (reload != 0) sdk.scene->reloadSource(reload, *sdk.resourceManager);
+                if (unload != 0) sdk.scene->unloadSource(unload, *sdk.resourceManager);
+                ImGui::EndMenu();
+            }
+            ImGui::EndMenu();
+        }
+
+        if (ImGui::BeginMenu("Renderer"))
+        {
+            if (ImGui::MenuItem("Depth Pre-pass", nullptr, sdk.renderer->isDepthPrepassEnabled()))
+            {
+                sdk.renderer->toggleDepthPrepass(!sdk.renderer->isDepthPrepassEnabled());
+            }
+            if (ImGui::MenuItem("Occlusion Culling", nullptr, sdk.renderer->isOcclusionCullingEnabled()))
+            {
+                sdk.renderer->toggleOcclusionCulling(!sdk.renderer->isOcclusionCullingEnabled());
+            }
+            if (ImGui::MenuItem("GPU Culling", nullptr, sdk.renderer->isGpuCullingEnabled(), sdk.renderer->isGpuCullingSupported()))
+            {
+                sdk.renderer->toggleGpuCulling(!sdk.renderer->isGpuCullingEnabled());
+            }
+
             ImGui::EndMenu();
         }
 
@@ -99,12 +251,29 @@ void EditorUI::renderMenuBar(SDK& sdk)
 
             ImGui::EndMenu();
         }
+
+        if (sdk.sceneLoader->isLoading())
+        {
+            std::string filename = std::filesystem::path(sdk.sceneLoader->getPath()).filename().string();
+
+            ImGui::Separator();
+            ImGui::Text("Loading %s", filename.c_str());
+            ImGui::ProgressBar(sdk.sceneLoader->getProgress(), ImVec2(160.0f, 0.0f));
+            if (ImGui::SmallButton("Cancel"))
+            {
+                sdk.sceneLoader->cancel();
+                sdk.resourceManager->collectUnused();
+            }
+        }
     }    
     ImGui::EndMainMenuBar();
 }
 
-void EditorUI::renderSceneView(uintptr_t fb)
+void EditorUI::renderSceneView(SDK& sdk)
 {
+    uintptr_t fb = static_cast<uintptr_t>(sdk.renderer->getFrameBuffer().colorTexture);
+    const OpenGL::RenderStats& stats = sdk.renderer->getStats();
+
     ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0.0f, 0.0f, 0.0f, 1.0f));
     ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0.0f, 0.0f));
     if (ImGui::Begin("Scene View", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoTitleBar))
@@ -115,12 +284,19 @@ void EditorUI::renderSceneView(uintptr_t fb)
             static_cast<uint32_t>(contentSize.y)
         };
 
+        ImVec2 imageMin = ImGui::GetCursorScreenPos();
         ImGui::Image(
             static_cast<ImTextureID>(fb), 
             contentSize, 
             ImVec2(0, 1), 
             ImVec2(1, 0)
         );
+
+        // Click to select
+        if (ImGui::IsItemClicked(ImGuiMouseButton_Left))
+        {
+            pickEntity(sdk, imageMin, contentSize);
+        }
         
         // Performance overlay
         ImGui::SetCursorPos(ImVec2(10, 30));
@@ -132,6 +308,45 @@ void EditorUI::renderSceneView(uintptr_t fb)
             float fps = ImGui::GetIO().Framerate;
             float msPerFrame = 1000.0f / fps;
             ImGui::Text("%.1f FPS (%.3f ms/frame)", fps, msPerFrame);
+            ImGui::Text("Visible: %u  Culled: %u", stats.visibleObjects, stats.culledObjects);
+            ImGui::Text("Draws: %u (%u commands)  Program/Texture/VAO changes: %u/%u/%u",
+                stats.drawCalls, stats.drawCommands, stats.programChanges, stats.textureChanges, stats.vaoChanges);
+            if (sdk.renderer->isOcclusionCullingEnabled())
+            {
+                ImGui::Text("Occlusion: %u tested, %u + %u visible", stats.occlusionTested,
+                    stats.occlusionVisibleEarly, stats.occlusionVisibleLate);
+            }
+            if (sdk.renderer->isGpuCullingEnabled())
+            {
+                ImGui::Text("GPU culling: %u groups, %u commands, %u outside frustum", stats.gpuDrawGroups,
+                    stats.gpuDrawCommands, stats.gpuFrustumCulled);
+            }
+            ImGui::Text("Frame data: %.1f KB  Stalls: %u", static_cast<float>(stats.frameDataBytes) / 1024.0f, stats.frameDataStalls);
+            for (uint32_t i = 0; i < OpenGL::SHADOW_CASCADES; i++)
+            {
+                const OpenGL::ShadowCascadeStats& cascade = stats.shadowCascades[i];
+                ImGui::Text("Cascade %u: %u static + %u dynamic, %.2f ms%s", i,
+                    cascade.staticCasters, cascade.dynamicCasters, cascade.gpuMilliseconds, cascade.cached ? " (cached)" : "");
+            }
+            ImGui::Text("Point shadows: %u lights, %u faces (%u behind, oldest %u frames)", stats.pointShadows.shadowedLights,
+                stats.pointShadows.facesRendered, stats.pointShadows.staleFaces, stats.pointShadows.oldestFace);
+            if (stats.pendingUploads > 0)
+            {
+                ImGui::Text("Pending uploads: %u", stats.pendingUploads);
+            }
+
+            if (sdk.worldStreamer->isOpen())
+            {
+                ImGui::Text("Cells: %u/%u loaded, %u pending",
+                    sdk.worldStreamer->getLoadedCellCount(),
+                    sdk.worldStreamer->getCellCount(),
+                    sdk.worldStreamer->getPendingCellCount());
+            }
+
+            for (const auto& timing : sdk.scheduler->getTimings())
+            {
+                ImGui::Text("%s: %.3f ms%s", timing.name.c_str(), timing.milliseconds, timing.mainThread ? " (main)" : "");
+            }
         }
         ImGui::EndChild();
         ImGui::PopStyleColor();
@@ -143,55 +358,101 @@ void EditorUI::renderSceneView(uintptr_t fb)
     ImGui::PopStyleVar();
 }
 
+void EditorUI::pickEntity(SDK& sdk, const ImVec2& imageMin, const ImVec2& imageSize)
+{
+    if (imageSize.x <= 0.0f || imageSize.y <= 0.0f) return;
+
+    // Mouse position to NDC, the image is displayed flipped so screen up is NDC +Y
+    ImVec2 mouse = ImGui::GetMousePos();
+    float ndcX = 2.0f * (mouse.x - imageMin.x) / imageSize.x - 1.0f;
+    float ndcY = 1.0f - 2.0f * (mouse.y - imageMin.y) / imageSize.y;
+
+    glm::mat4 invViewProjection = glm::inverse(sdk.renderer->getViewProjection());
+    glm::vec4 nearPoint = invViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = invViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    nearPoint /= nearPoint.w;
+    farPoint /= farPoint.w;
+
+    Ray ray;
+    ray.origin = glm::vec3(nearPoint);
+    ray.direction = glm::normalize(glm::vec3(farPoint - nearPoint));
+
+    RaycastHit hit;
+    select(*sdk.scene, sdk.scene->raycast(ray, hit) ? hit.entity : entt::null);
+}
+
+void EditorUI::select(Engine::Scene& scene, entt::entity entity)
+{
+    m_selection = scene.makeRef(entity);
+    m_selectedEntity = entity;
+}
+
 void EditorUI::renderEntityBrowser(Engine::Scene& scene)
 {
     auto& registry = scene.getRegistry();
+    m_selectedEntity = scene.resolve(m_selection);
+
+    m_entityList.refresh();
+    entt::entity destroyed = entt::null;
 
     ImGui::Begin("Entity Browser");
     {
-        for(auto entity: registry.view<entt::entity>()) 
+        ImGui::SetNextItemWidth(-FLT_MIN);
+        if (ImGui::InputTextWithHint("##EntityFilter", "Filter...", m_entityFilter, sizeof(m_entityFilter)))
         {
-            // Get name or generate ID string
-            std::string displayName;
-            if (auto name = registry.try_get<NameComponent>(entity)) 
-            {
-                displayName = name->name;
-            } 
-            else 
+            m_entityList.setFilter(m_entityFilter);
+        }
+
+        // Only rows inside the visible region are submitted
+        float footerHeight = ImGui::GetStyle().ItemSpacing.y + ImGui::GetFrameHeightWithSpacing();
+        ImGui::BeginChild("##EntityList", ImVec2(0.0f, -footerHeight));
+        {
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(m_entityList.size()));
+            while (clipper.Step())
             {
-                displayName = std::to_string(entt::to_integral(entity));
-            }
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+                {
+                    entt::entity entity = m_entityList.entity(row);
 
-            ImGui::PushID(static_cast<int>(entt::to_integral(entity)));
-            
-            // Selectable entity entry
-            if (ImGui::Selectable(displayName.c_str(), m_selectedEntity == entity)) {
-                m_selectedEntity = entity;
-            }
+                    ImGui::PushID(static_cast<int>(entt::to_integral(entity)));
+                    
+                    // Selectable entity entry
+                    if (ImGui::Selectable(m_entityList.displayName(row).c_str(), m_selectedEntity == entity)) {
+                        select(scene, entity);
+                    }
 
-            if (ImGui::IsItemClicked(ImGuiMouseButton_Right))
-            {
-                ImGui::OpenPopup("EntityOptions");
-            }
+                    if (ImGui::IsItemClicked(ImGuiMouseButton_Right))
+                    {
+                        ImGui::OpenPopup("EntityOptions");
+                    }
 
-            if (ImGui::BeginPopup("EntityOptions"))
-            {
-                if (ImGui::MenuItem("Destroy"))
-                {
-                    registry.destroy(entity);
+                    if (ImGui::BeginPopup("EntityOptions"))
+                    {
+                        // Destroyed after the loop, it removes a row from the list
+                        if (ImGui::MenuItem("Destroy"))
+                        {
+                            destroyed = entity;
+                        }
+                        ImGui::EndPopup();
+                    }
+                    
+                    ImGui::PopID();
                 }
-                ImGui::EndPopup();
             }
-            
-            ImGui::PopID();
+        }
+        ImGui::EndChild();
+
+        if (registry.valid(destroyed))
+        {
+            registry.destroy(destroyed);
         }
 
         ImGui::Separator();
         if (ImGui::Button("Add Entity"))
         {
             entt::entity entity = registry.create();
-            std::string name = "Entity #" + std::to_string(entt::to_integral(entity));
-            registry.emplace_or_replace<NameComponent>(entity, NameComponent{ .name = name });
+            registry.emplace<UUIDComponent>(entity);
         }
     }
     ImGui::End();    
@@ -210,87 +471,25 @@ void EditorUI::renderEntityDetails(Engine::Scene& scene)
 
             if (auto name = registry.try_get<NameComponent>(m_selectedEntity)) 
             {
-                headerText = name->name;
+                headerText = name->name.str();
             } 
             else {
                 headerText += " #" + std::to_string(entityId);
             }
 
             ImGui::Text("%s", headerText.c_str());
-            ImGui::Separator();
-
-            // Name Component
-            if (auto* name = registry.try_get<NameComponent>(m_selectedEntity))
+            if (auto* instance = registry.try_get<PrefabInstanceComponent>(m_selectedEntity))
             {
-                if (ComponentHeader<NameComponent>(registry, m_selectedEntity, "Name"))
-                {
-                    char buf[256];
-                    strcpy_s(buf, 256, name->name.c_str());
-                    if (ImGui::InputText("Name", buf, 256)) {
-                        name->name = buf;
-                    }
-                }
-            }
-
-            // Transform Component
-            if (auto* transform = registry.try_get<TransformComponent>(m_selectedEntity)) 
-            {               
-                if (ComponentHeader<TransformComponent>(registry, m_selectedEntity, "Transform"))
-                {
-                    ImGui::DragFloat3("Position", &transform->position[0], 0.1f);
-                    glm::vec3 degrees = glm::degrees(glm::eulerAngles(transform->rotation));
-                    ImGui::DragFloat3("Rotation", &degrees[0], 0.1f);
-                    transform->rotation = glm::quat(glm::radians(degrees));
-                    ImGui::DragFloat3("Scale", &transform->scale[0], 0.1f);
-                }
-            }
-
-            // Camera Component
-            if (auto* camera = registry.try_get<CameraComponent>(m_selectedEntity)) 
-            {
-                if (ComponentHeader<CameraComponent>(registry, m_selectedEntity, "Camera"))
-                {
-                    ImGui::DragFloat("FOV", &camera->fov, 0.1f, 1.0f, 180.0f);
-                    ImGui::DragFloat("Near Plane", &camera->nearClip, 0.01f, 0.01f, 10.0f);
-                    ImGui::DragFloat("Far Plane", &camera->farClip, 1.0f, 10.0f, 10000.0f);
-                }
-            }
-
-            // Mesh Renderer Component
-            if (auto* meshRenderer = registry.try_get<MeshRendererComponent>(m_selectedEntity)) 
-            {
-                if (ComponentHeader<MeshRendererComponent>(registry, m_selectedEntity, "Mesh Renderer"))
-                {
-                    ImGui::Checkbox("Cast Shadows", &meshRenderer->castShadows);
-                }
+                ImGui::TextDisabled("Prefab: %s", instance->prefab->name.c_str());
             }
+            ImGui::Separator();
 
-            // Light Component
-            if (auto* light = registry.try_get<LightComponent>(m_selectedEntity)) 
+            // Details and the add menu are generated from the reflected component list
+            forEachType(EditorComponents{}, [&](auto type)
             {
-                if (ComponentHeader<LightComponent>(registry, m_selectedEntity, "Light"))
-                {
-                    ImGui::DragFloat3("LightPosition", &light->position[0], 0.1f);
-                    ImGui::DragFloat3("LightDirection", &light->direction[0], 0.1f);
-                    ImGui::ColorEdit3("Color", &light->color[0]);
-                    ImGui::DragFloat("Intensity", &light->power, 0.1f, 0.0f, 100.0f);
-                    
-                    const char* lightTypes[] = { "Point Light", "Directional Light" };
-                    static int selectedType = static_cast<int>(light->type);
-                    ImGui::Combo("Light Type", &selectedType, lightTypes, IM_ARRAYSIZE(lightTypes));
+                renderComponent<typename decltype(type)::type>(registry, m_selectedEntity);
+            });
 
-                    // Update light type based on selection
-                    if (selectedType == 0) 
-                    {
-                        light->type = LightType::POINT;
-                    } 
-                    else if (selectedType == 1) 
-                    {
-                        light->type = LightType::DIRECTIONAL;
-                    }
-                }
-            }
-                        
             // Add Component button and popup
             ImGui::Separator();
             if (ImGui::Button("Add Component")) 
@@ -300,11 +499,15 @@ void EditorUI::renderEntityDetails(Engine::Scene& scene)
 
             if (ImGui::BeginPopup("AddComponentPopup"))
             {
-                AddComponentMenuItem<TransformComponent>(registry, m_selectedEntity, "Transform");
-                AddComponentMenuItem<CameraComponent>(registry, m_selectedEntity, "Camera");
-                AddComponentMenuItem<MeshRendererComponent>(registry, m_selectedEntity, "Mesh Renderer");
-                AddComponentMenuItem<LightComponent>(registry, m_selectedEntity, "Light");
-                AddComponentMenuItem<ActiveCamera>(registry, m_selectedEntity, "Active Camera");
+                forEachType(EditorComponents{}, [&](auto type)
+                {
+                    using T = typename decltype(type)::type;
+                    if (!hasComponent<T>(registry, m_selectedEntity) && ImGui::MenuItem(ComponentMeta<T>::label))
+                    {
+                        registry.emplace<T>(m_selectedEntity);
+                        ImGui::CloseCurrentPopup();
+                    }
+                });
                 ImGui::EndPopup();
             }
         }
@@ -316,53 +519,56 @@ void EditorUI::renderEntityDetails(Engine::Scene& scene)
     ImGui::End();
 }
 
-template <typename ComponentType>
-bool EditorUI::ComponentHeader(entt::registry& registry, entt::entity entity, const char* headerName)
+template <typename T>
+bool EditorUI::hasComponent(const entt::registry& registry, entt::entity entity)
+{
+    if constexpr (isPrefabShared<T>) return findComponent<T>(registry, entity) != nullptr;
+    else return registry.all_of<T>(entity);
+}
+
+template <typename T>
+void EditorUI::renderComponent(entt::registry& registry, entt::entity entity)
 {
-    if (auto* component = registry.try_get<ComponentType>(entity))
-    
-    // Generate unique ID for component type
-    ImGui::PushID(static_cast<int>(typeid(ComponentType).hash_code()));
+    if (!hasComponent<T>(registry, entity)) return;
+
+    // Shared with the prefab until edited, the first edit makes an override
+    const bool inherited = !registry.all_of<T>(entity);
 
-    bool componentExists = registry.any_of<ComponentType>(entity);
-    bool headerOpen = false;
+    ImGui::PushID(ComponentMeta<T>::name);
+    std::string label = inherited ? std::string(ComponentMeta<T>::label) + " (Prefab)" : ComponentMeta<T>::label;
+    bool headerOpen = ImGui::CollapsingHeader(label.c_str(), ImGuiTreeNodeFlags_DefaultOpen);
 
-    if (componentExists)
+    // Right-click the header for component options
+    bool removed = false;
+    if (ImGui::BeginPopupContextItem("ComponentOptions"))
     {
-        if (ImGui::CollapsingHeader(headerName, ImGuiTreeNodeFlags_DefaultOpen))
-        {
-            headerOpen = true;
+        removed = ImGui::MenuItem("Delete", nullptr, false, !inherited);
+        ImGui::EndPopup();
+    }
 
-            // Check for right-click on the header
-            if (ImGui::IsItemClicked(ImGuiMouseButton_Right))
+    if (removed)
+    {
+        registry.remove<T>(entity);
+    }
+    else if (headerOpen)
+    {
+        if constexpr (!std::is_empty_v<T>)
+        {
+            T edited = inherited ? *findComponent<T>(registry, entity) : T{};
+            T& component = inherited ? edited : registry.get<T>(entity);
+            bool changed = false;
+            forEachField<T>([&](const auto& field)
             {
-                ImGui::OpenPopup("ComponentOptions");
-            }
+                changed |= inspectValue(field, component.*field.member);
+            });
 
-            if (ImGui::BeginPopup("ComponentOptions"))
-            {
-                if (ImGui::MenuItem("Delete"))
-                {
-                    registry.remove<ComponentType>(entity);
-                    headerOpen = false; // Component is removed, header should close
-                }
-                ImGui::EndPopup();
-            }
+            // Notify observers (spatial index, renderer buffers, entity list) of the in-place edit
+            if (changed && inherited) registry.emplace<T>(entity, std::move(edited));
+            else if (changed) registry.patch<T>(entity);
         }
     }
 
     ImGui::PopID();
-    return headerOpen;
-}
-
-template <typename ComponentType>
-void EditorUI::AddComponentMenuItem(entt::registry& registry, entt::entity entity, const char* label)
-{
-    if (ImGui::MenuItem(label))
-    {
-        registry.emplace_or_replace<ComponentType>(entity);
-        ImGui::CloseCurrentPopup();
-    }
 }
 
 }
\ No newline at end of file
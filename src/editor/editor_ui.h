@@ -1,6 +1,8 @@
 #pragma once
 
+#include <imgui.h>
 #include "core/sdk.h"
+#include "entity_list.h"
 
 namespace Editor {
 
@@ -9,9 +11,13 @@ class EditorUI
 public:
     EditorUI();
 
+    // Follows the scene's entities for the entity browser
+    void attachScene(Engine::Scene& scene);
+    void detachScene();
+
     void setupDockingSpace();
     void renderMenuBar(Engine::SDK& sdk);
-    void renderSceneView(uintptr_t fb);
+    void renderSceneView(Engine::SDK& sdk);
     void renderEntityBrowser(Engine::Scene& scene);
     void renderEntityDetails(Engine::Scene& scene);
 
@@ -19,13 +25,26 @@ public:
     bool isSceneViewActive() const { return m_isSceneViewActive; }
     
 private:
-    template <typename ComponentType>
-    bool ComponentHeader(entt::registry& registry, entt::entity entity, const char* headerName);
+    void pickEntity(Engine::SDK& sdk, const ImVec2& imageMin, const ImVec2& imageSize);
+
+    // Collapsing header and field widgets generated from the component's reflection
+    template <typename T>
+    void renderComponent(entt::registry& registry, entt::entity entity);
+
+    // Own component, or one shared by the entity's prefab
+    template <typename T>
+    static bool hasComponent(const entt::registry& registry, entt::entity entity);
 
-    template <typename ComponentType>
-    void AddComponentMenuItem(entt::registry& registry, entt::entity entity, const char* label);
+    void select(Engine::Scene& scene, entt::entity entity);
 
+    // Held by persistent id so the selection survives reloading the scene
+    Engine::EntityRef m_selection;
     entt::entity m_selectedEntity = entt::null;
+
+    // Entity browser rows, updated from registry signals
+    EntityList m_entityList;
+    char m_entityFilter[128] = {};
+
     std::pair<uint32_t, uint32_t> m_framebufferSize { 1920, 1080 };
     bool m_isSceneViewActive = false;
 };
@@ -0,0 +1,286 @@
+#include "entity_list.h"
+
+#include <cctype>
+#include <algorithm>
+#include "scene/components.h"
+#include "scene/prefab.h"
+#include "core/assert.h"
+
+namespace Editor {
+
+using namespace Engine;
+
+static std::string toLower(const std::string& text)
+{
+    std::string result(text.size(), '\0');
+    std::transform(text.begin(), text.end(), result.begin(), [](char c)
+    {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+    return result;
+}
+
+EntityList::~EntityList()
+{
+    detach();
+}
+
+void EntityList::attach(entt::registry& registry)
+{
+    detach();
+    m_registry = &registry;
+
+    registry.on_construct<entt::entity>().connect<&EntityList::onEntityCreated>(this);
+    registry.on_destroy<entt::entity>().connect<&EntityList::onEntityDestroyed>(this);
+    registry.on_construct<NameComponent>().connect<&EntityList::onNameChanged>(this);
+    registry.on_update<NameComponent>().connect<&EntityList::onNameChanged>(this);
+    registry.on_destroy<NameComponent>().connect<&EntityList::onNameDestroyed>(this);
+    registry.on_construct<PrefabInstanceComponent>().connect<&EntityList::onNameChanged>(this);
+
+    for (auto entity : registry.view<entt::entity>())
+    {
+        onEntityCreated(registry, entity);
+    }
+}
+
+void EntityList::detach()
+{
+    if (!m_registry) return;
+
+    m_registry->on_construct<entt::entity>().disconnect<&EntityList::onEntityCreated>(this);
+    m_registry->on_destroy<entt::entity>().disconnect<&EntityList::onEntityDestroyed>(this);
+    m_registry->on_construct<NameComponent>().disconnect<&EntityList::onNameChanged>(this);
+    m_registry->on_update<NameComponent>().disconnect<&EntityList::onNameChanged>(this);
+    m_registry->on_destroy<NameComponent>().disconnect<&EntityList::onNameDestroyed>(this);
+    m_registry->on_construct<PrefabInstanceComponent>().disconnect<&EntityList::onNameChanged>(this);
+    m_registry = nullptr;
+
+    m_rows.clear();
+    m_rowOf.clear();
+    m_trigrams.clear();
+    m_filtered.clear();
+    m_dirty = false;
+}
+
+void EntityList::refresh()
+{
+    if (!m_dirty) return;
+    m_dirty = false;
+
+    // Row indices may have moved, so the previous result can't be refined
+    if (m_filter.size() >= 3)
+    {
+        filterIndexed(m_filter);
+    }
+    else if (!m_filter.empty())
+    {
+        filterAll(m_filter);
+    }
+}
+
+void EntityList::onEntityCreated(entt::registry& registry, entt::entity entity)
+{
+    const uint32_t row = static_cast<uint32_t>(m_rows.size());
+    m_rows.push_back({ .entity = entity });
+    m_rowOf[entity] = row;
+
+    // Components are usually added after creation, each add renames the row once
+    const auto* name = registry.try_get<NameComponent>(entity);
+    setName(entity, name ? name->name.str() : defaultName(registry, entity));
+}
+
+void EntityList::onEntityDestroyed(entt::registry& registry, entt::entity entity)
+{
+    UNUSED(registry);
+
+    auto it = m_rowOf.find(entity);
+    if (it == m_rowOf.end()) return;
+
+    // Swap the last row into the hole and repoint its postings
+    const uint32_t row = it->second;
+    const uint32_t last = static_cast<uint32_t>(m_rows.size() - 1);
+    unindexRow(row);
+    m_rowOf.erase(it);
+
+    if (row != last)
+    {
+        m_rows[row] = std::move(m_rows[last]);
+        m_rowOf[m_rows[row].entity] = row;
+        for (const auto& [key, position] : m_rows[row].postings)
+        {
+            m_trigrams[key][position] = row;
+        }
+    }
+    m_rows.pop_back();
+    m_dirty = true;
+}
+
+void EntityList::onNameChanged(entt::registry& registry, entt::entity entity)
+{
+    const auto* name = registry.try_get<NameComponent>(entity);
+    setName(entity, name ? name->name.str() : defaultName(registry, entity));
+}
+
+void EntityList::onNameDestroyed(entt::registry& registry, entt::entity entity)
+{
+    // Still attached while the signal runs
+    setName(entity, defaultName(registry, entity));
+}
+
+void EntityList::setName(entt::entity entity, std::string name)
+{
+    auto it = m_rowOf.find(entity);
+    if (it == m_rowOf.end()) return;
+
+    Row& row = m_rows[it->second];
+    if (row.name == name) return;
+
+    unindexRow(it->second);
+    row.name = std::move(name);
+    row.lowerName = toLower(row.name);
+    indexRow(it->second);
+    m_dirty = true;
+}
+
+void EntityList::indexRow(uint32_t row)
+{
+    Row& entry = m_rows[row];
+    const std::string& lower = entry.lowerName;
+    for (size_t i = 0; i + 3 <= lower.size(); i++)
+    {
+        // A row is posted once per distinct trigram
+        uint32_t key = trigramKey(&lower[i]);
+        bool posted = std::any_of(entry.postings.begin(), entry.postings.end(), [key](const auto& posting)
+        {
+            return posting.first == key;
+        });
+        if (posted) continue;
+
+        auto& postings = m_trigrams[key];
+        entry.postings.emplace_back(key, static_cast<uint32_t>(postings.size()));
+        postings.push_back(row);
+    }
+}
+
+void EntityList::unindexRow(uint32_t row)
+{
+    for (const auto& [key, position] : m_rows[row].postings)
+    {
+        auto it = m_trigrams.find(key);
+        auto& postings = it->second;
+
+        // Swap-remove, then fix the position the moved row recorded for this trigram
+        const uint32_t moved = postings.back();
+        postings[position] = moved;
+        postings.pop_back();
+        if (moved != row)
+        {
+            for (auto& posting : m_rows[moved].postings)
+            {
+                if (posting.first == key)
+                {
+                    posting.second = position;
+                    break;
+                }
+            }
+        }
+
+        if (postings.empty())
+        {
+            m_trigrams.erase(it);
+        }
+    }
+    m_rows[row].postings.clear();
+}
+
+std::string EntityList::defaultName(const entt::registry& registry, entt::entity entity)
+{
+    // Shown, never stored: unnamed entities don't intern a name of their own
+    if (const auto* instance = registry.try_get<PrefabInstanceComponent>(entity))
+    {
+        return instance->prefab->name + " #" + std::to_string(entt::to_integral(entity));
+    }
+    return "Entity #" + std::to_string(entt::to_integral(entity));
+}
+
+void EntityList::setFilter(const std::string& filter)
+{
+    std::string lower = toLower(filter);
+    if (lower == m_filter) return;
+
+    // Extending the query can only remove rows from the current result
+    bool extends = !m_filter.empty() && lower.compare(0, m_filter.size(), m_filter) == 0;
+    m_filter = lower;
+
+    if (extends)
+    {
+        refine(m_filter);
+    }
+    else if (m_filter.size() >= 3)
+    {
+        filterIndexed(m_filter);
+    }
+    else if (!m_filter.empty())
+    {
+        filterAll(m_filter);
+    }
+}
+
+void EntityList::filterAll(const std::string& filter)
+{
+    m_filtered.clear();
+    for (uint32_t row = 0; row < static_cast<uint32_t>(m_rows.size()); row++)
+    {
+        if (m_rows[row].lowerName.find(filter) != std::string::npos)
+        {
+            m_filtered.push_back(row);
+        }
+    }
+}
+
+void EntityList::filterIndexed(const std::string& filter)
+{
+    m_filtered.clear();
+
+    // Start from the rarest trigram of the query, then verify the full substring
+    const std::vector<uint32_t>* candidates = nullptr;
+    for (size_t i = 0; i + 3 <= filter.size(); i++)
+    {
+        auto it = m_trigrams.find(trigramKey(&filter[i]));
+        if (it == m_trigrams.end()) return;
+
+        if (!candidates || it->second.size() < candidates->size())
+        {
+            candidates = &it->second;
+        }
+    }
+
+    for (uint32_t row : *candidates)
+    {
+        if (m_rows[row].lowerName.find(filter) != std::string::npos)
+        {
+            m_filtered.push_back(row);
+        }
+    }
+
+    // Postings are unordered after removals, keep the browser order stable
+    std::sort(m_filtered.begin(), m_filtered.end());
+}
+
+void EntityList::refine(const std::string& filter)
+{
+    auto last = std::remove_if(m_filtered.begin(), m_filtered.end(), [&](uint32_t row)
+    {
+        return m_rows[row].lowerName.find(filter) == std::string::npos;
+    });
+    m_filtered.erase(last, m_filtered.end());
+}
+
+uint32_t EntityList::trigramKey(const char* text)
+{
+    return (static_cast<uint32_t>(static_cast<unsigned char>(text[0])) << 16) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(text[1])) << 8) |
+            static_cast<uint32_t>(static_cast<unsigned char>(text[2]));
+}
+
+}
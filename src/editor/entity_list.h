@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <entt/entity/registry.hpp>
+
+namespace Editor {
+
+// Filterable list of entities for the entity browser. Rows and their trigram
+// postings are kept up to date from registry signals one entity at a time;
+// filtering narrows the previous result when the query is extended and
+// otherwise starts from the trigram index, so typing never rescans the whole
+// registry.
+class EntityList
+{
+public:
+    ~EntityList();
+
+    // Indexes the registry's entities and follows their creation, destruction and renames
+    void attach(entt::registry& registry);
+    void detach();
+
+    // Re-applies the filter if rows changed since the last call
+    void refresh();
+    void setFilter(const std::string& filter);
+
+    size_t size() const { return m_filter.empty() ? m_rows.size() : m_filtered.size(); }
+    entt::entity entity(size_t row) const { return m_rows[rowIndex(row)].entity; }
+    const std::string& displayName(size_t row) const { return m_rows[rowIndex(row)].name; }
+
+private:
+    struct Row
+    {
+        entt::entity entity = entt::null;
+        std::string name;
+        std::string lowerName;
+        std::vector<std::pair<uint32_t, uint32_t>> postings; // Trigram key, position in its posting list
+    };
+
+    uint32_t rowIndex(size_t row) const { return m_filter.empty() ? static_cast<uint32_t>(row) : m_filtered[row]; }
+
+    void onEntityCreated(entt::registry& registry, entt::entity entity);
+    void onEntityDestroyed(entt::registry& registry, entt::entity entity);
+    void onNameChanged(entt::registry& registry, entt::entity entity);
+    void onNameDestroyed(entt::registry& registry, entt::entity entity);
+
+    void setName(entt::entity entity, std::string name);
+    void indexRow(uint32_t row);
+    void unindexRow(uint32_t row);
+
+    static std::string defaultName(const entt::registry& registry, entt::entity entity);
+
+    void filterAll(const std::string& filter);
+    void filterIndexed(const std::string& filter);
+    void refine(const std::string& filter);
+
+    static uint32_t trigramKey(const char* text);
+
+    entt::registry* m_registry = nullptr;
+
+    std::vector<Row> m_rows;
+    std::unordered_map<entt::entity, uint32_t> m_rowOf;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> m_trigrams;
+
+    std::vector<uint32_t> m_filtered;
+    std::string m_filter;
+    bool m_dirty = false;
+};
+
+}
@@ -103,6 +103,7 @@ void FPSCameraSystem::update(Scene& scene, float deltaTime, bool allowMovement)
 
         // Combine rotations and set the transform's rotation
         cameraTransform.rotation = horizontalQuat * verticalQuat;
+        registry.patch<TransformComponent>(cameraEntity);
     }
 }
 
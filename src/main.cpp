@@ -31,7 +31,10 @@ int main(int argc, char* argv[])
     
     if (!scenePath.empty()) 
     {
-      app.loadScene(scenePath);
+      app.loadScene(scenePath, [scenePath](bool loaded)
+      {
+        if (!loaded) std::cerr << "Error: failed to load scene " << scenePath << std::endl;
+      });
     }
 
     app.run();
@@ -0,0 +1,207 @@
+#include "cascaded_shadow_map.h"
+
+#include <cmath>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace OpenGL
+{
+
+// Cascades cover the view up to this distance, or the far plane if it's closer
+const float SHADOW_DISTANCE = 100.0f;
+
+// Blend between logarithmic (1) and uniform (0) split distances
+const float SPLIT_LAMBDA = 0.75f;
+
+// Light-space depth of a cascade's center is snapped to this fraction of its
+// radius, so the static cache survives camera moves along the light direction
+const float DEPTH_SNAP_FRACTION = 0.25f;
+
+// Depth bias applied while rendering casters, in slope and constant units
+const float SHADOW_SLOPE_BIAS = 2.0f;
+const float SHADOW_CONSTANT_BIAS = 4.0f;
+
+bool CascadedShadowMap::initialize(uint32_t resolution)
+{
+    m_resolution = resolution;
+    const GLsizei size = static_cast<GLsizei>(resolution);
+
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &m_shadowTexture);
+    glTextureStorage3D(m_shadowTexture, 1, GL_DEPTH_COMPONENT32F, size, size, SHADOW_CASCADES);
+    glTextureParameteri(m_shadowTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_shadowTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_shadowTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTextureParameteri(m_shadowTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTextureParameteri(m_shadowTexture, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTextureParameteri(m_shadowTexture, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    // Outside the map is lit
+    const float borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTextureParameterfv(m_shadowTexture, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &m_cacheTexture);
+    glTextureStorage3D(m_cacheTexture, 1, GL_DEPTH_COMPONENT32F, size, size, SHADOW_CASCADES);
+    glTextureParameteri(m_cacheTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(m_cacheTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // No color buffer
+    glCreateFramebuffers(1, &m_framebuffer);
+    glNamedFramebufferDrawBuffer(m_framebuffer, GL_NONE);
+    glNamedFramebufferReadBuffer(m_framebuffer, GL_NONE);
+
+    for (auto& timers : m_timers)
+    {
+        glCreateQueries(GL_TIME_ELAPSED, RingBuffer::FRAMES, timers.data());
+    }
+
+    m_cascades = {};
+    m_stats = {};
+    m_timerPending = {};
+    return m_shadowTexture && m_cacheTexture && m_framebuffer;
+}
+
+void CascadedShadowMap::cleanup()
+{
+    for (auto& timers : m_timers)
+    {
+        glDeleteQueries(RingBuffer::FRAMES, timers.data());
+        timers = {};
+    }
+
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteTextures(1, &m_shadowTexture);
+    glDeleteTextures(1, &m_cacheTexture);
+    m_framebuffer = m_shadowTexture = m_cacheTexture = 0;
+}
+
+void CascadedShadowMap::beginFrame()
+{
+    // The ring buffer has waited for this slot's frame, its queries are complete
+    m_frame = (m_frame + 1) % RingBuffer::FRAMES;
+    for (uint32_t i = 0; i < SHADOW_CASCADES; i++)
+    {
+        m_stats[i] = {};
+        if (!m_timerPending[i][m_frame]) continue;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(m_timers[i][m_frame], GL_QUERY_RESULT, &elapsed);
+        m_stats[i].gpuMilliseconds = static_cast<float>(static_cast<double>(elapsed) / 1e6);
+        m_timerPending[i][m_frame] = false;
+    }
+}
+
+void CascadedShadowMap::update(const glm::mat4& view, float fov, float aspect, float nearClip, float farClip, const glm::vec3& lightDirection)
+{
+    const float shadowFar = std::min(farClip, SHADOW_DISTANCE);
+    const float tanHalfFov = std::tan(fov * 0.5f);
+    const glm::mat4 inverseView = glm::inverse(view);
+
+    // Rotation only, translation is snapped per cascade in light space
+    const glm::vec3 up = std::abs(lightDirection.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+
+    float sliceNear = nearClip;
+    for (uint32_t i = 0; i < SHADOW_CASCADES; i++)
+    {
+        Cascade& cascade = m_cascades[i];
+
+        const float t = static_cast<float>(i + 1) / static_cast<float>(SHADOW_CASCADES);
+        const float logSplit = nearClip * std::pow(shadowFar / nearClip, t);
+        const float uniformSplit = nearClip + (shadowFar - nearClip) * t;
+        const float sliceFar = SPLIT_LAMBDA * logSplit + (1.0f - SPLIT_LAMBDA) * uniformSplit;
+
+        // The slice's bounding sphere only depends on the projection, so it doesn't
+        // change size as the camera turns. Its center lies on the view axis where the
+        // near and far corners are equidistant.
+        const float nearHalf = sliceNear * tanHalfFov;
+        const float farHalf = sliceFar * tanHalfFov;
+        const float nearDiagonal = nearHalf * nearHalf * (1.0f + aspect * aspect);
+        const float farDiagonal = farHalf * farHalf * (1.0f + aspect * aspect);
+
+        float centerDepth = 0.5f * (sliceNear + sliceFar) + 0.5f * (farDiagonal - nearDiagonal) / (sliceFar - sliceNear);
+        centerDepth = std::min(centerDepth, sliceFar);
+        float radius = std::sqrt((sliceFar - centerDepth) * (sliceFar - centerDepth) + farDiagonal);
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        const glm::vec3 center = glm::vec3(inverseView * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+
+        // Snapped to whole texels so static edges don't shimmer as the camera moves
+        const float texelSize = 2.0f * radius / static_cast<float>(m_resolution);
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+        lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+        lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+        // Depth moves in coarse steps too, the range grows by a step on each side so
+        // the sphere stays inside it wherever the center falls within the step
+        const float depthStep = radius * DEPTH_SNAP_FRACTION;
+        lightCenter.z = std::floor(lightCenter.z / depthStep) * depthStep;
+        const float depthRadius = radius + depthStep;
+
+        const glm::mat4 projection = glm::ortho(
+            lightCenter.x - radius, lightCenter.x + radius,
+            lightCenter.y - radius, lightCenter.y + radius,
+            -(lightCenter.z + depthRadius), -(lightCenter.z - depthRadius)
+        );
+
+        const glm::mat4 viewProjection = projection * lightView;
+        if (viewProjection != cascade.viewProjection) cascade.staticValid = false;
+
+        cascade.viewProjection = viewProjection;
+        cascade.splitDepth = sliceFar;
+        sliceNear = sliceFar;
+    }
+}
+
+void CascadedShadowMap::invalidateStatic()
+{
+    for (Cascade& cascade : m_cascades)
+    {
+        cascade.staticValid = false;
+    }
+}
+
+Frustum CascadedShadowMap::getCasterFrustum(uint32_t cascade) const
+{
+    Frustum frustum = BoundsUtils::extractFrustum(m_cascades[cascade].viewProjection);
+
+    // No near plane: every point passes
+    frustum.planes[4].normal = glm::vec3(0.0f);
+    frustum.planes[4].distance = FLT_MAX;
+    return frustum;
+}
+
+void CascadedShadowMap::beginPass()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, static_cast<GLsizei>(m_resolution), static_cast<GLsizei>(m_resolution));
+
+    // Casters between the light and the near plane are flattened onto it
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(SHADOW_SLOPE_BIAS, SHADOW_CONSTANT_BIAS);
+}
+
+void CascadedShadowMap::endPass()
+{
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_CLAMP);
+}
+
+ShadowData CascadedShadowMap::getShaderData(int32_t lightSlot) const
+{
+    ShadowData data;
+    for (uint32_t i = 0; i < SHADOW_CASCADES; i++)
+    {
+        data.matrices[i] = m_cascades[i].viewProjection;
+        data.splits[i] = m_cascades[i].splitDepth;
+    }
+    data.params = glm::ivec4(lightSlot >= 0 ? static_cast<int32_t>(SHADOW_CASCADES) : 0, lightSlot, 0, 0);
+    return data;
+}
+
+void CascadedShadowMap::attachLayer(GLuint texture, uint32_t layer)
+{
+    glNamedFramebufferTextureLayer(m_framebuffer, GL_DEPTH_ATTACHMENT, texture, 0, static_cast<GLint>(layer));
+}
+
+}
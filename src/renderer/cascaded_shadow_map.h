@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "core/bounds.h"
+#include "ring_buffer.h"
+
+namespace OpenGL
+{
+
+using namespace Engine;
+
+const uint32_t SHADOW_CASCADES = 4;
+
+struct ShadowCascadeStats
+{
+    uint32_t staticCasters = 0;  // Drawn into the static cache this frame
+    uint32_t dynamicCasters = 0;
+    float gpuMilliseconds = 0.0f; // Measured RingBuffer::FRAMES frames ago
+    bool cached = false;          // Nothing was rendered, the layer was still valid
+};
+
+// Matches ShadowUBO of the standard fragment shader (std140, binding 2)
+struct ShadowData
+{
+    glm::mat4 matrices[SHADOW_CASCADES];
+    glm::vec4 splits; // View space far distance of each cascade
+    glm::ivec4 params; // X = cascade count (0 = no shadows), Y = shadowed light slot
+};
+
+// Shadow maps of the directional light, one texture array layer per cascade.
+// Cascades are fit to bounding spheres of the view frustum slices and snapped to
+// whole texels, so their matrices only change when the camera moves a texel. Static
+// casters are rendered into a cache layer that's kept while the matrix is unchanged;
+// each frame the cache is copied and dynamic casters are drawn on top, and cascades
+// without dynamic casters aren't touched at all.
+class CascadedShadowMap
+{
+public:
+    bool initialize(uint32_t resolution);
+    void cleanup();
+
+    // Collects timings of the frame that last used this frame's query slots
+    void beginFrame();
+
+    // Fits the cascades, a cascade whose matrix changed loses its static cache
+    void update(const glm::mat4& view, float fov, float aspect, float nearClip, float farClip, const glm::vec3& lightDirection);
+
+    // A static caster moved, changed or went away
+    void invalidateStatic();
+
+    bool needsStaticPass(uint32_t cascade) const { return !m_cascades[cascade].staticValid; }
+
+    // The cascade's volume extended towards the light, casters outside the cascade
+    // can still shadow it (their depth is clamped to the near plane)
+    Frustum getCasterFrustum(uint32_t cascade) const;
+    const glm::mat4& getViewProjection(uint32_t cascade) const { return m_cascades[cascade].viewProjection; }
+
+    void beginPass();
+    void endPass();
+
+    // draw(slots) submits the casters' depth and returns how many were drawn
+    template <typename DrawFn>
+    void renderCascade(uint32_t index, std::vector<uint32_t>& staticCasters, std::vector<uint32_t>& dynamicCasters, DrawFn&& draw);
+
+    ShadowData getShaderData(int32_t lightSlot) const;
+    GLuint getTexture() const { return m_shadowTexture; }
+    const std::array<ShadowCascadeStats, SHADOW_CASCADES>& getStats() const { return m_stats; }
+
+private:
+    struct Cascade
+    {
+        glm::mat4 viewProjection = glm::mat4(1.0f);
+        float splitDepth = 0.0f;
+        bool staticValid = false;
+        bool hasDynamic = false; // The shadow layer differs from the cache
+    };
+
+    void attachLayer(GLuint texture, uint32_t layer);
+
+    uint32_t m_resolution = 0;
+    GLuint m_framebuffer = 0;
+    GLuint m_shadowTexture = 0; // Sampled with depth comparison
+    GLuint m_cacheTexture = 0;  // Static casters only
+    std::array<Cascade, SHADOW_CASCADES> m_cascades;
+    std::array<ShadowCascadeStats, SHADOW_CASCADES> m_stats;
+
+    // GL_TIME_ELAPSED per cascade, one slot per frame in flight
+    std::array<std::array<GLuint, RingBuffer::FRAMES>, SHADOW_CASCADES> m_timers = {};
+    std::array<std::array<bool, RingBuffer::FRAMES>, SHADOW_CASCADES> m_timerPending = {};
+    uint32_t m_frame = 0;
+};
+
+template <typename DrawFn>
+void CascadedShadowMap::renderCascade(uint32_t index, std::vector<uint32_t>& staticCasters, std::vector<uint32_t>& dynamicCasters, DrawFn&& draw)
+{
+    Cascade& cascade = m_cascades[index];
+    ShadowCascadeStats& stats = m_stats[index];
+
+    const bool refreshStatic = !cascade.staticValid;
+    const bool hasDynamic = !dynamicCasters.empty();
+    if (!refreshStatic && !hasDynamic && !cascade.hasDynamic)
+    {
+        stats.cached = true;
+        return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, m_timers[index][m_frame]);
+    if (refreshStatic)
+    {
+        attachLayer(m_cacheTexture, index);
+        const float clearDepth = 1.0f;
+        glClearNamedFramebufferfv(m_framebuffer, GL_DEPTH, 0, &clearDepth);
+        stats.staticCasters = draw(staticCasters);
+        cascade.staticValid = true;
+    }
+
+    glCopyImageSubData(
+        m_cacheTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(index),
+        m_shadowTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(index),
+        static_cast<GLsizei>(m_resolution), static_cast<GLsizei>(m_resolution), 1
+    );
+
+    if (hasDynamic)
+    {
+        attachLayer(m_shadowTexture, index);
+        stats.dynamicCasters = draw(dynamicCasters);
+    }
+    cascade.hasDynamic = hasDynamic;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_timerPending[index][m_frame] = true;
+}
+
+}
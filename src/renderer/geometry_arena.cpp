@@ -0,0 +1,166 @@
+#include "geometry_arena.h"
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include "core/assert.h"
+
+namespace OpenGL
+{
+
+bool RangeAllocator::allocate(uint32_t size, uint32_t& offset)
+{
+    for (auto it = m_free.begin(); it != m_free.end(); ++it)
+    {
+        if (it->second < size) continue;
+
+        offset = it->first;
+        uint32_t remaining = it->second - size;
+        m_free.erase(it);
+        if (remaining > 0) m_free.emplace(offset + size, remaining);
+        return true;
+    }
+    return false;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t size)
+{
+    if (size == 0) return;
+
+    auto next = m_free.lower_bound(offset);
+    if (next != m_free.end() && offset + size == next->first)
+    {
+        size += next->second;
+        next = m_free.erase(next);
+    }
+
+    if (next != m_free.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += size;
+            return;
+        }
+    }
+    m_free.emplace(offset, size);
+}
+
+void RangeAllocator::grow(uint32_t capacity)
+{
+    ASSERT(capacity >= m_capacity, "Allocators only grow");
+    uint32_t previous = m_capacity;
+    m_capacity = capacity;
+    free(previous, capacity - previous);
+}
+
+bool GeometryArena::initialize(uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+    glCreateVertexArrays(1, &m_vao);
+    growBuffer(m_vertexBuffer, m_vertices, sizeof(Vertex), vertexCapacity);
+    growBuffer(m_indexBuffer, m_indices, sizeof(uint32_t), indexCapacity);
+    attachBuffers();
+
+    const auto setupAttrib = [&](GLuint attribIndex, GLint size, size_t offset)
+    {
+        glVertexArrayAttribFormat(m_vao, attribIndex, size, GL_FLOAT, GL_FALSE, static_cast<GLuint>(offset));
+        glVertexArrayAttribBinding(m_vao, attribIndex, 0);
+        glEnableVertexArrayAttrib(m_vao, attribIndex);
+    };
+
+    setupAttrib(0, 3, offsetof(Vertex, position));
+    setupAttrib(1, 2, offsetof(Vertex, uv));
+    setupAttrib(2, 3, offsetof(Vertex, normal));
+    setupAttrib(3, 3, offsetof(Vertex, tangent));
+    setupAttrib(4, 3, offsetof(Vertex, bitangent));
+
+    glVertexArrayAttribIFormat(m_vao, 5, 1, GL_UNSIGNED_INT, 0);
+    glVertexArrayAttribBinding(m_vao, 5, 1);
+    glVertexArrayBindingDivisor(m_vao, 1, 1);
+    glEnableVertexArrayAttrib(m_vao, 5);
+
+    return m_vao != 0;
+}
+
+void GeometryArena::cleanup()
+{
+    glDeleteVertexArrays(1, &m_vao);
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_indexBuffer);
+    m_vao = m_vertexBuffer = m_indexBuffer = 0;
+    m_vertices = {};
+    m_indices = {};
+}
+
+MeshBuffer GeometryArena::allocate(const MeshData& meshData)
+{
+    MeshBuffer meshBuffer;
+    meshBuffer.vertexCount = static_cast<uint32_t>(meshData.vertices.size());
+    meshBuffer.indexCount = static_cast<uint32_t>(meshData.indices.size());
+
+    if (!m_vertices.allocate(meshBuffer.vertexCount, meshBuffer.firstVertex))
+    {
+        growBuffer(m_vertexBuffer, m_vertices, sizeof(Vertex), m_vertices.getCapacity() + meshBuffer.vertexCount);
+        m_vertices.allocate(meshBuffer.vertexCount, meshBuffer.firstVertex);
+        attachBuffers();
+    }
+    if (!m_indices.allocate(meshBuffer.indexCount, meshBuffer.firstIndex))
+    {
+        growBuffer(m_indexBuffer, m_indices, sizeof(uint32_t), m_indices.getCapacity() + meshBuffer.indexCount);
+        m_indices.allocate(meshBuffer.indexCount, meshBuffer.firstIndex);
+        attachBuffers();
+    }
+
+    // Attributes a mesh doesn't have are left zero
+    std::vector<Vertex> vertices(meshBuffer.vertexCount);
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        Vertex& vertex = vertices[i];
+        vertex.position = meshData.vertices[i];
+        if (i < meshData.uvs.size()) vertex.uv = meshData.uvs[i];
+        if (i < meshData.normals.size()) vertex.normal = meshData.normals[i];
+        if (i < meshData.tangents.size()) vertex.tangent = meshData.tangents[i];
+        if (i < meshData.bitangents.size()) vertex.bitangent = meshData.bitangents[i];
+    }
+
+    glNamedBufferSubData(m_vertexBuffer, sizeof(Vertex) * meshBuffer.firstVertex, sizeof(Vertex) * vertices.size(), vertices.data());
+    glNamedBufferSubData(m_indexBuffer, sizeof(uint32_t) * meshBuffer.firstIndex, sizeof(uint32_t) * meshData.indices.size(), meshData.indices.data());
+    return meshBuffer;
+}
+
+void GeometryArena::free(MeshBuffer& meshBuffer)
+{
+    m_vertices.free(meshBuffer.firstVertex, meshBuffer.vertexCount);
+    m_indices.free(meshBuffer.firstIndex, meshBuffer.indexCount);
+    meshBuffer = {};
+}
+
+void GeometryArena::setInstanceBuffer(GLuint buffer, GLintptr offset)
+{
+    glVertexArrayVertexBuffer(m_vao, 1, buffer, offset, sizeof(uint32_t));
+}
+
+void GeometryArena::growBuffer(GLuint& buffer, RangeAllocator& ranges, size_t elementSize, uint32_t minCapacity)
+{
+    uint32_t capacity = std::max(ranges.getCapacity(), 1u);
+    while (capacity < minCapacity) capacity *= 2;
+
+    GLuint grown;
+    glCreateBuffers(1, &grown);
+    glNamedBufferStorage(grown, elementSize * capacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    if (buffer)
+    {
+        glCopyNamedBufferSubData(buffer, grown, 0, 0, elementSize * ranges.getCapacity());
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = grown;
+    ranges.grow(capacity);
+}
+
+void GeometryArena::attachBuffers()
+{
+    glVertexArrayVertexBuffer(m_vao, 0, m_vertexBuffer, 0, sizeof(Vertex));
+    glVertexArrayElementBuffer(m_vao, m_indexBuffer);
+}
+
+}
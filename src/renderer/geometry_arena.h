@@ -0,0 +1,78 @@
+#pragma once
+
+#include <map>
+#include <cstdint>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "core/resources.h"
+
+namespace OpenGL
+{
+
+// A mesh's sub-allocation in the GeometryArena. Indices are stored mesh-relative
+// and drawn with firstVertex as the base vertex.
+struct MeshBuffer
+{
+    uint32_t indexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstVertex = 0;
+};
+
+// First-fit allocator over [0, capacity), adjacent free ranges are merged
+class RangeAllocator
+{
+public:
+    bool allocate(uint32_t size, uint32_t& offset);
+    void free(uint32_t offset, uint32_t size);
+    void grow(uint32_t capacity);
+
+    uint32_t getCapacity() const { return m_capacity; }
+
+private:
+    std::map<uint32_t, uint32_t> m_free; // Offset to size
+    uint32_t m_capacity = 0;
+};
+
+// Every mesh's vertices and indices live in one interleaved vertex buffer and one
+// index buffer behind a single VAO, so draws with different meshes need no VAO
+// switch and can be merged into multi-draw indirect calls.
+class GeometryArena
+{
+public:
+    // Interleaved layout of attributes 0-4 of standard_vs.glsl
+    struct Vertex
+    {
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec2 uv = glm::vec2(0.0f);
+        glm::vec3 normal = glm::vec3(0.0f);
+        glm::vec3 tangent = glm::vec3(0.0f);
+        glm::vec3 bitangent = glm::vec3(0.0f);
+    };
+
+    bool initialize(uint32_t vertexCapacity, uint32_t indexCapacity);
+    void cleanup();
+
+    // Uploads the mesh, growing the buffers when it doesn't fit
+    MeshBuffer allocate(const MeshData& meshData);
+    void free(MeshBuffer& meshBuffer);
+
+    GLuint getVertexArray() const { return m_vao; }
+
+    // Per-instance draw slots, attribute 5 with a divisor of one so the baseInstance
+    // of an indirect command selects where an instanced run starts
+    void setInstanceBuffer(GLuint buffer, GLintptr offset);
+
+private:
+    // Reallocates and copies the old contents, existing allocations keep their offsets
+    void growBuffer(GLuint& buffer, RangeAllocator& ranges, size_t elementSize, uint32_t minCapacity);
+    void attachBuffers();
+
+    GLuint m_vao = 0;
+    GLuint m_vertexBuffer = 0;
+    GLuint m_indexBuffer = 0;
+    RangeAllocator m_vertices;
+    RangeAllocator m_indices;
+};
+
+}
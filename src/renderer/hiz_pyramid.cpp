@@ -0,0 +1,48 @@
+#include "hiz_pyramid.h"
+
+#include <algorithm>
+
+namespace OpenGL
+{
+
+bool HiZPyramid::initialize(uint32_t depthWidth, uint32_t depthHeight)
+{
+    m_depthSize = glm::uvec2(depthWidth, depthHeight);
+
+    const glm::uvec2 size = getLevelSize(0);
+    m_levels = 1;
+    for (uint32_t largest = std::max(size.x, size.y); largest > 1; largest >>= 1) m_levels++;
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_texture);
+    glTextureStorage2D(m_texture, static_cast<GLsizei>(m_levels), GL_R32F, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y));
+    glTextureParameteri(m_texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTextureParameteri(m_texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    m_valid = false;
+    return m_texture != 0;
+}
+
+void HiZPyramid::cleanup()
+{
+    glDeleteTextures(1, &m_texture);
+    m_texture = 0;
+    m_levels = 0;
+    m_valid = false;
+}
+
+glm::uvec2 HiZPyramid::getLevelSize(uint32_t level) const
+{
+    // Level 0 rounds up so it covers the whole depth buffer, later levels follow the
+    // mip chain and round down
+    return glm::max(glm::uvec2(1), (m_depthSize + 1u) / 2u >> level);
+}
+
+void HiZPyramid::setBuilt(const glm::mat4& viewProjection)
+{
+    m_viewProjection = viewProjection;
+    m_valid = true;
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace OpenGL
+{
+
+// Mip chain of the farthest depth under each texel, built from the depth buffer by
+// the Hi-Z compute shader. Level 0 is half the depth buffer; each texel covers the
+// 2x2 texels below it, and the last row and column of odd sized levels also cover
+// the leftover one, so depth texel d is always under texel min(d >> (level + 1), size - 1).
+class HiZPyramid
+{
+public:
+    bool initialize(uint32_t depthWidth, uint32_t depthHeight);
+    void cleanup();
+
+    GLuint getTexture() const { return m_texture; }
+    uint32_t getLevelCount() const { return m_levels; }
+    glm::uvec2 getLevelSize(uint32_t level) const;
+    glm::vec2 getDepthSize() const { return glm::vec2(m_depthSize); }
+
+    // View projection of the depth the pyramid was last built from, occlusion tests
+    // project bounds with it
+    void setBuilt(const glm::mat4& viewProjection);
+    void invalidate() { m_valid = false; }
+    bool isValid() const { return m_valid; }
+    const glm::mat4& getViewProjection() const { return m_viewProjection; }
+
+private:
+    GLuint m_texture = 0;
+    uint32_t m_levels = 0;
+    glm::uvec2 m_depthSize = glm::uvec2(0);
+    glm::mat4 m_viewProjection = glm::mat4(1.0f);
+    bool m_valid = false;
+};
+
+}
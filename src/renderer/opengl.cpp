@@ -1,6 +1,8 @@
 #include "opengl.h"
 
+#include <cmath>
 #include <iostream>
+#include <algorithm>
 #include "core/utils.h"
 #include "core/file_system.h"
 #include "core/assert.h"
@@ -10,18 +12,69 @@ namespace OpenGL
 
 using namespace Engine;
 
-struct LightsUBO 
+const uint32_t INITIAL_DRAW_CAPACITY = 1024;
+
+// Per-frame region of the ring buffer, grows when a frame needs more
+const size_t FRAME_DATA_SIZE = 1024 * 1024;
+
+// Starting size of the shared geometry buffers, they grow on demand
+const uint32_t INITIAL_ARENA_VERTICES = 256 * 1024;
+const uint32_t INITIAL_ARENA_INDICES = 1024 * 1024;
+
+// Point light cube faces rendered per frame, more shadowed lights lower their refresh rate
+const uint32_t POINT_SHADOW_FACE_BUDGET = 12;
+
+// Point light shadows reach as far as the light's intensity stays above this
+const float POINT_SHADOW_CUTOFF = 0.01f;
+
+// Dirty slots closer than this are uploaded as one range
+const uint32_t DIRTY_RANGE_GAP = 8;
+
+// New texture and mesh data uploaded per frame, a freshly opened scene is brought
+// in over several frames instead of stalling one
+const size_t UPLOAD_BUDGET_BYTES = 32 * 1024 * 1024;
+
+// Draw slots the GPU culling pass skips: free, parked, transparent or without a material
+const uint32_t NO_DRAW_GROUP = 0xFFFFFFFF;
+
+// Sorts and merges dirty slots into ranges, calls upload(first, count) for each
+template <typename Fn>
+static void forEachDirtyRange(std::vector<uint32_t>& slots, Fn upload)
 {
-    struct Light 
+    if (slots.empty()) return;
+
+    std::sort(slots.begin(), slots.end());
+    uint32_t first = slots[0];
+    uint32_t last = slots[0];
+    for (size_t i = 1; i < slots.size(); i++)
     {
-        glm::vec4 position;
-        glm::vec4 direction;
-        glm::vec4 color;
-        glm::vec4 power_type; // X = power, Y = type
-    };
-    
-    Light lights[MAX_LIGHTS];
-};
+        if (slots[i] <= last + DIRTY_RANGE_GAP)
+        {
+            last = slots[i];
+            continue;
+        }
+        upload(first, last - first + 1);
+        first = last = slots[i];
+    }
+    upload(first, last - first + 1);
+
+    slots.clear();
+}
+
+// Reallocates a storage buffer smaller than size, growing by doubling. Contents are lost.
+template <typename StorageBuffer>
+static void reserveBuffer(StorageBuffer& buffer, size_t size, GLbitfield flags)
+{
+    if (buffer.id && size <= buffer.capacity) return;
+
+    size_t capacity = std::max<size_t>(buffer.capacity, 256);
+    while (capacity < size) capacity *= 2;
+
+    glDeleteBuffers(1, &buffer.id);
+    glCreateBuffers(1, &buffer.id);
+    glNamedBufferStorage(buffer.id, static_cast<GLsizeiptr>(capacity), nullptr, flags);
+    buffer.capacity = capacity;
+}
 
 bool Renderer::initialize() 
 {
@@ -60,23 +113,131 @@ bool Renderer::initialize()
 
     // Initialize standard shader
     {
-        std::string standardVsCode = FileSystem::read("resources/shaders/standard_vs.glsl");
-        std::string standardFsCode = FileSystem::read("resources/shaders/standard_fs.glsl");
-
-        GLuint standardVs = compileShader(standardVsCode, GL_VERTEX_SHADER);
+        GLuint standardVs = compileShader("resources/shaders/standard_vs.glsl", GL_VERTEX_SHADER);
         if (!standardVs) return false;
 
-        GLuint standardFs = compileShader(standardFsCode, GL_FRAGMENT_SHADER);
+        GLuint standardFs = compileShader("resources/shaders/standard_fs.glsl", GL_FRAGMENT_SHADER);
         if (!standardFs) return false;
 
-        m_standardProgram.id = linkProgram(standardVs, standardFs);
+        m_standardProgram.id = linkProgram({ standardVs, standardFs });
         if (!m_standardProgram.id) return false;
+
+        m_standardProgram.reflect();
+        ASSERT(m_standardProgram.getBlockBinding("LightsUBO") == 0, "LightsUBO is expected at binding 0");
+        ASSERT(m_standardProgram.getBlockBinding("DrawBuffer") == 1, "DrawBuffer is expected at binding 1");
+        ASSERT(m_standardProgram.getBlockBinding("ShadowUBO") == 2, "ShadowUBO is expected at binding 2");
+        ASSERT(m_standardProgram.getBlockBinding("PointShadowUBO") == 3, "PointShadowUBO is expected at binding 3");
+
+        StandardUniforms& uniforms = m_standardUniforms;
+        uniforms.viewMatrix = m_standardProgram.getUniform<glm::mat4>("viewMatrix");
+        uniforms.viewProjection = m_standardProgram.getUniform<glm::mat4>("viewProjection");
+        uniforms.activeLights = m_standardProgram.getUniform<int>("activeLights");
+        uniforms.textureAlbedo = m_standardProgram.getUniform<int>("textureAlbedo");
+        uniforms.textureNormal = m_standardProgram.getUniform<int>("textureNormal");
+        uniforms.textureSpecular = m_standardProgram.getUniform<int>("textureSpecular");
+        uniforms.textureShadow = m_standardProgram.getUniform<int>("shadowMap");
+        uniforms.texturePointShadow = m_standardProgram.getUniform<int>("pointShadowAtlas");
+
+        // Texture units never change
+        m_standardProgram.set(uniforms.textureAlbedo, 0);
+        m_standardProgram.set(uniforms.textureNormal, 1);
+        m_standardProgram.set(uniforms.textureSpecular, 2);
+        m_standardProgram.set(uniforms.textureShadow, 3);
+        m_standardProgram.set(uniforms.texturePointShadow, 4);
+    }
+
+    // Initialize depth only shader, shared by the shadow passes and the depth pre-pass
+    {
+        GLuint depthVs = compileShader("resources/shaders/depth_vs.glsl", GL_VERTEX_SHADER);
+        if (!depthVs) return false;
+
+        GLuint depthFs = compileShader("resources/shaders/depth_fs.glsl", GL_FRAGMENT_SHADER);
+        if (!depthFs) return false;
+
+        m_depthProgram.id = linkProgram({ depthVs, depthFs });
+        if (!m_depthProgram.id) return false;
+
+        m_depthProgram.reflect();
+        m_depthViewProjection = m_depthProgram.getUniform<glm::mat4>("viewProjection");
+    }
+
+    // Initialize Hi-Z pyramid and occlusion culling compute shaders
+    {
+        GLuint hiZCs = compileShader("resources/shaders/hiz_cs.glsl", GL_COMPUTE_SHADER);
+        if (!hiZCs) return false;
+
+        m_hiZProgram.id = linkProgram({ hiZCs });
+        if (!m_hiZProgram.id) return false;
+
+        m_hiZProgram.reflect();
+        m_hiZSource = m_hiZProgram.getUniform<int>("sourceDepth");
+        m_hiZSourceLevel = m_hiZProgram.getUniform<int>("sourceLevel");
+        m_hiZProgram.set(m_hiZSource, 6);
+
+        GLuint occlusionCs = compileShader("resources/shaders/occlusion_cs.glsl", GL_COMPUTE_SHADER);
+        if (!occlusionCs) return false;
+
+        m_occlusionProgram.id = linkProgram({ occlusionCs });
+        if (!m_occlusionProgram.id) return false;
+
+        m_occlusionProgram.reflect();
+        OcclusionUniforms& uniforms = m_occlusionUniforms;
+        uniforms.objectCount = m_occlusionProgram.getUniform<int>("objectCount");
+        uniforms.phase = m_occlusionProgram.getUniform<int>("phase");
+        uniforms.pyramidValid = m_occlusionProgram.getUniform<int>("pyramidValid");
+        uniforms.counterSlot = m_occlusionProgram.getUniform<int>("counterSlot");
+        uniforms.hiZ = m_occlusionProgram.getUniform<int>("hiZ");
+        uniforms.viewProjection = m_occlusionProgram.getUniform<glm::mat4>("viewProjection");
+        uniforms.depthSize = m_occlusionProgram.getUniform<glm::vec2>("depthSize");
+        m_occlusionProgram.set(uniforms.hiZ, 5);
+    }
+
+    // Initialize GPU driven culling, the draw count comes from a buffer
+    m_gpuCullingSupported = GLEW_VERSION_4_6 || GLEW_ARB_indirect_parameters;
+    m_gpuCulling = m_gpuCullingSupported;
+    if (m_gpuCullingSupported)
+    {
+        GLuint gpuCullCs = compileShader("resources/shaders/gpu_cull_cs.glsl", GL_COMPUTE_SHADER);
+        if (!gpuCullCs) return false;
+
+        m_gpuCullProgram.id = linkProgram({ gpuCullCs });
+        if (!m_gpuCullProgram.id) return false;
+
+        m_gpuCullProgram.reflect();
+        GpuCullUniforms& uniforms = m_gpuCullUniforms;
+        uniforms.stage = m_gpuCullProgram.getUniform<int>("stage");
+        uniforms.phase = m_gpuCullProgram.getUniform<int>("phase");
+        uniforms.objectCount = m_gpuCullProgram.getUniform<int>("objectCount");
+        uniforms.groupCount = m_gpuCullProgram.getUniform<int>("groupCount");
+        uniforms.batchCount = m_gpuCullProgram.getUniform<int>("batchCount");
+        uniforms.instanceCount = m_gpuCullProgram.getUniform<int>("instanceCount");
+        uniforms.testOcclusion = m_gpuCullProgram.getUniform<int>("testOcclusion");
+        uniforms.counterSlot = m_gpuCullProgram.getUniform<int>("counterSlot");
+        uniforms.hiZ = m_gpuCullProgram.getUniform<int>("hiZ");
+        uniforms.viewProjection = m_gpuCullProgram.getUniform<glm::mat4>("viewProjection");
+        uniforms.hiZViewProjection = m_gpuCullProgram.getUniform<glm::mat4>("hiZViewProjection");
+        uniforms.depthSize = m_gpuCullProgram.getUniform<glm::vec2>("depthSize");
+        m_gpuCullProgram.set(uniforms.hiZ, 5);
     }
 
     // Create UBOs
     {
-        glCreateBuffers(1, &m_lightsUBO);
-        glNamedBufferStorage(m_lightsUBO, sizeof(LightsUBO), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        m_lightData.resize(MAX_LIGHTS);
+
+        m_drawCapacity = INITIAL_DRAW_CAPACITY;
+        glCreateBuffers(1, &m_drawBuffer);
+        glNamedBufferStorage(m_drawBuffer, sizeof(DrawData) * m_drawCapacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_uniformAlignment);
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &m_storageAlignment);
+        if (!m_frameData.initialize(FRAME_DATA_SIZE)) return false;
+    }
+
+    // Create geometry arena
+    if (!m_geometry.initialize(INITIAL_ARENA_VERTICES, INITIAL_ARENA_INDICES))
+    {
+        std::cerr << "Failed to create the geometry arena" << std::endl;
+        return false;
     }
 
     // Create default texture
@@ -89,6 +250,39 @@ bool Renderer::initialize()
     // Create frame buffer
     m_frameBuffer = createFrameBuffer(FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT, FrameBufferType::Color);
 
+    if (!m_shadowMap.initialize(SHADOW_MAP_SIZE))
+    {
+        std::cerr << "Failed to create the shadow map" << std::endl;
+        return false;
+    }
+
+    if (!m_pointShadows.initialize(POINT_SHADOW_ATLAS_SIZE))
+    {
+        std::cerr << "Failed to create the point shadow atlas" << std::endl;
+        return false;
+    }
+
+    if (!m_hiZ.initialize(FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT))
+    {
+        std::cerr << "Failed to create the Hi-Z pyramid" << std::endl;
+        return false;
+    }
+
+    // Read by the CPU once the ring buffer has waited for the frame that wrote them
+    {
+        const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr size = sizeof(glm::uvec4) * RingBuffer::FRAMES;
+        glCreateBuffers(1, &m_occlusionCounters);
+        glNamedBufferStorage(m_occlusionCounters, size, nullptr, flags);
+        glClearNamedBufferData(m_occlusionCounters, GL_RGBA32UI, GL_RGBA_INTEGER, GL_UNSIGNED_INT, nullptr);
+        m_occlusionCounterData = static_cast<const glm::uvec4*>(glMapNamedBufferRange(m_occlusionCounters, 0, size, flags));
+        if (!m_occlusionCounterData)
+        {
+            std::cerr << "Failed to map the occlusion counters" << std::endl;
+            return false;
+        }
+    }
+
     m_debugRenderer.initialize();
     
     return true;
@@ -96,27 +290,43 @@ bool Renderer::initialize()
 
 void Renderer::cleanup() 
 {
+    detachScene();
+
     deleteShader(m_standardProgram.id);
-    deleteUniformBuffer(m_lightsUBO);
+    deleteShader(m_depthProgram.id);
+    deleteShader(m_hiZProgram.id);
+    deleteShader(m_occlusionProgram.id);
+    deleteShader(m_gpuCullProgram.id);
+    deleteUniformBuffer(m_drawBuffer);
+    for (StorageBuffer* buffer : { &m_cullBuffer, &m_drawGroupBuffer, &m_groupCommands, &m_groupInstances, &m_groupCounts, &m_groupVisibility })
+    {
+        deleteUniformBuffer(buffer->id);
+        buffer->capacity = 0;
+    }
+    m_frameData.cleanup();
 
     deleteTexture(m_defaultAlbedo);
     deleteTexture(m_defaultNormalMap);
     deleteTexture(m_defaultSpecularMap);
 
-    for(auto& [uuid, meshBuffer] : m_meshCache)
+    for(auto& [uuid, cached] : m_textureCache)
     {
-        deleteMeshBuffer(meshBuffer);
-    }   
-    for(auto& [uuid, texture] : m_textureCache)
-    {
-        deleteTexture(texture);
+        deleteTexture(cached.texture);
     }
     
     m_meshCache.clear();
     m_textureCache.clear();
+    m_geometry.cleanup();
     m_debugRenderer.cleanup();
 
     deleteFrameBuffer(m_frameBuffer);
+    m_shadowMap.cleanup();
+    m_pointShadows.cleanup();
+    m_hiZ.cleanup();
+
+    // Deleting a mapped buffer unmaps it
+    deleteUniformBuffer(m_occlusionCounters);
+    m_occlusionCounterData = nullptr;
 }
 
 void Renderer::render(std::pair<uint32_t, uint32_t> framebufferSize, Scene& scene)
@@ -127,17 +337,13 @@ void Renderer::render(std::pair<uint32_t, uint32_t> framebufferSize, Scene& scen
     auto [width, height] = framebufferSize;
     if (width == 0 || height == 0) return;
     
-    // Allocate meshes and textures
-    allocateResources(registry);
-    
-    // Update lights uniform buffer
-    updateLightsUB(registry);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_lightsUBO);
-    
-    // Main Render Pass
-    glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer.id);
-    glViewport(0, 0, m_frameBuffer.width, m_frameBuffer.height);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Upload what changed since the last frame (resources, draw data, lights)
+    ASSERT(&scene == m_scene, "Rendering a scene the renderer isn't attached to");
+    m_frameData.beginFrame();
+    readOcclusionCounters();
+    processSceneChanges(registry);
+    if (m_gpuCulling && m_drawGroupsDirty) buildDrawGroups();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_drawBuffer);
     
     // Default cameara values
     float fov = glm::radians(60.0f);
@@ -170,86 +376,193 @@ void Renderer::render(std::pair<uint32_t, uint32_t> framebufferSize, Scene& scen
     glm::mat4 projection = glm::perspective(fov, aspect, nearClip, farClip);
     glm::mat4 view = glm::lookAt(cameraPosition, cameraPosition + cameraForward, cameraUp);
 
-    // Render all meshes
-    auto renderView = registry.view<MeshRendererComponent, TransformComponent>();
-    for(auto [entity, mesh, transform] : renderView.each())
-    {
-        if(!mesh.material) continue;
-
-        glm::mat4 model = MathUtils::calculateModelMatrix(transform);
-        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(view * model)));
-        glm::mat4 modelViewProjection = projection * view * model;
+    glm::mat4 viewProjection = projection * view;
+    m_viewProjection = viewProjection;
 
-        glUseProgram(m_standardProgram.id);
-        
-        m_standardProgram.setMat4("viewMatrix", view);
-        m_standardProgram.setMat4("modelMatrix", model);
-        m_standardProgram.setMat3("normalMatrix", normalMatrix);
-        m_standardProgram.setMat4("modelViewProjection", modelViewProjection);
-        m_standardProgram.setInt("activeLights", m_activeLights);
-
-        // Bind textures
-        if(mesh.material->albedo)
+    // Frustum culling: the scene BVH rejects or accepts whole subtrees, leaves
+    // straddling the frustum are batch tested against their bounding spheres
+    if (m_gpuCulling)
+    {
+        // Opaque draws are culled on the GPU, only the transparent ones are tested here.
+        // GPU visible counts are read back RingBuffer::FRAMES frames late.
+        m_culler.clear();
+        m_visibleEntities.clear();
+        m_visibleIndices.clear();
+        m_cullEntities.clear();
+
+        for (entt::entity entity : m_transparentEntities)
         {
-            ASSERT(m_textureCache.contains(mesh.material->albedo->uuid), "Failed to find albedo texture");
-            m_standardProgram.setInt("textureAlbedo", 0);
-            glBindTextureUnit(0, m_textureCache[mesh.material->albedo->uuid].id);
+            const auto* bounds = registry.try_get<WorldBoundsComponent>(entity);
+            if (!bounds) continue;
+
+            m_culler.add(bounds->sphere);
+            m_cullEntities.push_back(entity);
         }
-        else
+
+        m_culler.cull(BoundsUtils::extractFrustum(viewProjection), m_visibleIndices);
+        for (uint32_t index : m_visibleIndices)
         {
-            m_standardProgram.setInt("textureAlbedo", 0);
-            glBindTextureUnit(0, m_defaultAlbedo.id);
+            m_visibleEntities.push_back(m_cullEntities[index]);
         }
 
-        if (mesh.material->normal)
+        const uint32_t total = m_groupInstanceCount + static_cast<uint32_t>(m_cullEntities.size());
+        const uint32_t visible = static_cast<uint32_t>(m_visibleEntities.size()) + m_stats.occlusionVisibleEarly + m_stats.occlusionVisibleLate;
+        m_stats.visibleObjects = std::min(visible, total);
+        m_stats.culledObjects = total - m_stats.visibleObjects;
+    }
+    else
+    {
+        m_culler.clear();
+        m_cullEntities.clear();
+        m_visibleEntities.clear();
+        m_visibleIndices.clear();
+
+        const DynamicBVH& spatialIndex = scene.getSpatialIndex();
+        const Frustum frustum = BoundsUtils::extractFrustum(viewProjection);
+
+        spatialIndex.queryFrustum(frustum, [&](int32_t proxy, bool fullyInside)
         {
-            ASSERT(m_textureCache.contains(mesh.material->normal->uuid), "Failed to find normal map texture");
-            m_standardProgram.setInt("textureNormal", 1);
-            glBindTextureUnit(1, m_textureCache[mesh.material->normal->uuid].id);
-        } 
-        else
+            auto entity = static_cast<entt::entity>(spatialIndex.getUserData(proxy));
+            if (fullyInside)
+            {
+                m_visibleEntities.push_back(entity);
+            }
+            else
+            {
+                m_culler.add(registry.get<WorldBoundsComponent>(entity).sphere);
+                m_cullEntities.push_back(entity);
+            }
+        });
+
+        m_culler.cull(frustum, m_visibleIndices);
+        for (uint32_t index : m_visibleIndices)
         {
-            m_standardProgram.setInt("textureNormal", 1);
-            glBindTextureUnit(1, m_defaultNormalMap.id);
+            m_visibleEntities.push_back(m_cullEntities[index]);
         }
 
-        if (mesh.material->specular)
-        {
-            ASSERT(m_textureCache.contains(mesh.material->specular->uuid), "Failed to find specular map texture");
-            m_standardProgram.setInt("textureSpecular", 2);
-            glBindTextureUnit(2, m_textureCache[mesh.material->specular->uuid].id);
-        } 
-        else
+        m_stats.visibleObjects = static_cast<uint32_t>(m_visibleEntities.size());
+        m_stats.culledObjects = static_cast<uint32_t>(spatialIndex.getProxyCount() - m_visibleEntities.size());
+    }
+
+    // Shadow casters are culled and drawn per cascade
+    m_stateTracker.reset();
+    renderShadows(scene, view, fov, aspect, nearClip, farClip);
+    renderPointShadows(scene, cameraPosition, fov, viewProjection);
+
+    // Main Render Pass
+    glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer.id);
+    glViewport(0, 0, m_frameBuffer.width, m_frameBuffer.height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Queue visible meshes, sorted so draws sharing state are submitted together
+    {
+        m_renderQueue.clear();
+        m_drawSpheres.resize(m_drawRecords.size());
+        const float depthScale = 1.0f / farClip;
+
+        for (entt::entity entity : m_visibleEntities)
         {
-            m_standardProgram.setInt("textureSpecular", 2);
-            glBindTextureUnit(2, m_defaultSpecularMap.id);
+            auto it = m_drawSlots.find(entity);
+            if (it == m_drawSlots.end()) continue;
+
+            const DrawRecord& record = m_drawRecords[it->second];
+            if (!record.material) continue;
+
+            const BoundingSphere& sphere = registry.get<WorldBoundsComponent>(entity).sphere;
+            float depth = glm::dot(sphere.center - cameraPosition, cameraForward) * depthScale;
+            RenderPass pass = record.material->opacity < 1.0f ? RenderPass::Transparent : RenderPass::Opaque;
+
+            m_drawSpheres[it->second] = sphere;
+            m_renderQueue.push(RenderQueue::makeKey(pass, STANDARD_PROGRAM_KEY, record.materialKey, record.meshKey, depth), it->second);
         }
 
-        m_standardProgram.setVec3("materialAmbient", mesh.material->ambient);
-        m_standardProgram.setVec3("specularStrength", mesh.material->specularStrength);
-        m_standardProgram.setFloat("shininess", mesh.material->shininess);
-        m_standardProgram.setFloat("opacity", mesh.material->opacity);
+        m_renderQueue.sort();
+        buildDrawCommands();
+        uploadDrawPhases();
+    }
+
+    // Render visible meshes
+    const StandardUniforms& uniforms = m_standardUniforms;
+    m_stateTracker.bindTexture(3, m_shadowMap.getTexture());
+    m_stateTracker.bindTexture(4, m_pointShadows.getTexture());
+    m_standardProgram.set(uniforms.viewMatrix, view);
+    m_standardProgram.set(uniforms.viewProjection, viewProjection);
+    m_standardProgram.set(uniforms.activeLights, static_cast<int>(m_activeLights));
+    m_depthProgram.set(m_depthViewProjection, viewProjection);
+
+    // Every mesh lives in the geometry arena, so one VAO serves the whole pass and
+    // each batch of commands sharing a texture set is a single multi-draw
+    m_stateTracker.bindVertexArray(m_geometry.getVertexArray());
+    m_stats.drawCalls = 0;
+
+    // Opaque draws come from the GPU culling pass or the render queue's phases
+    auto drawOpaquePhase = [&](uint32_t phase, bool shaded)
+    {
+        if (m_gpuCulling) drawGpuPhase(phase, shaded);
+        else if (shaded) drawShadedPhase(m_drawPhases[phase], 0, m_opaqueBatches);
+        else drawDepthPhase(m_drawPhases[phase]);
+    };
+
+    // Opaque draws. With occlusion culling, what passes against the previous frame's
+    // Hi-Z is drawn first, the pyramid is rebuilt from that depth and the rest is
+    // re-tested against it, so objects that just came into view are still drawn.
+    const uint32_t opaquePhases = m_occlusionCulling ? 2 : 1;
+    if (m_depthPrepass) glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    for (uint32_t phase = 0; phase < opaquePhases; phase++)
+    {
+        if (phase > 0) buildHiZ(viewProjection);
+        if (m_gpuCulling) cullOnGpu(phase, viewProjection);
+        else if (m_occlusionCulling) cullOcclusion(phase);
+
+        drawOpaquePhase(phase, !m_depthPrepass);
+    }
+
+    // Kept for the next frame's first phase
+    if (m_occlusionCulling) buildHiZ(viewProjection);
+
+    // Depth is final, shading only runs for the visible surface
+    if (m_depthPrepass)
+    {
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthFunc(GL_LEQUAL);
+        glDepthMask(GL_FALSE);
+        for (uint32_t phase = 0; phase < opaquePhases; phase++)
+        {
+            drawOpaquePhase(phase, true);
+        }
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+    }
 
-        // Bind mesh buffer
-        ASSERT(m_meshCache.contains(mesh.meshData->uuid), "Failed to find mesh buffer");
-        glBindVertexArray(m_meshCache[mesh.meshData->uuid].vao);
-        glDrawElements(GL_TRIANGLES, m_meshCache[mesh.meshData->uuid].indexCount, GL_UNSIGNED_INT, 0);
+    for (uint32_t phase = 0; phase < m_phaseCount; phase++)
+    {
+        drawShadedPhase(m_drawPhases[phase], m_opaqueBatches, m_drawBatches.size());
     }
 
+    const StateChangeStats& stateChanges = m_stateTracker.getStats();
+    m_stats.drawCommands = static_cast<uint32_t>(m_drawCommands.size()) + (m_gpuCulling ? m_stats.gpuDrawCommands : 0);
+    m_stats.programChanges = stateChanges.programChanges;
+    m_stats.textureChanges = stateChanges.textureChanges;
+    m_stats.vaoChanges = stateChanges.vaoChanges;
+
     // Render debug geometry
     if (m_debugEnabled)
     {
-        m_debugRenderer.startFrame();
-
-        for(auto [entity, light] : registry.view<LightComponent>().each())
+        for(auto [entity, light] : registry.view<LightComponent>(entt::exclude<Inactive>).each())
         {
             m_debugRenderer.addSphere(light.position, 0.1f * light.power, light.color);
             // m_debugRenderer.addLine(light.position, light.position + glm::normalize(light.direction), light.color);
         }
 
-        glm::mat4 viewProjection = projection * view;
-        m_debugRenderer.endFrame(viewProjection);
+        const glm::vec2 screenSize(static_cast<float>(m_frameBuffer.width), static_cast<float>(m_frameBuffer.height));
+        m_debugRenderer.render(viewProjection, screenSize, m_frameData);
     }
+    m_debugRenderer.endFrame();
+
+    // Everything reading this frame's ring buffer region has been submitted
+    m_frameData.endFrame();
+    m_stats.frameDataBytes = m_frameData.getStats().frameBytes;
+    m_stats.frameDataStalls = m_frameData.getStats().stalls;
 
     // Restore viewport
     {        
@@ -265,54 +578,986 @@ void Renderer::render(std::pair<uint32_t, uint32_t> framebufferSize, Scene& scen
     }
 }
 
-void Renderer::allocateResources(entt::registry& registry)
+void Renderer::attachScene(Scene& scene)
+{
+    detachScene();
+    m_scene = &scene;
+
+    entt::registry& registry = scene.getRegistry();
+    registry.on_construct<MeshRendererComponent>().connect<&Renderer::onMeshRendererChanged>(this);
+    registry.on_update<MeshRendererComponent>().connect<&Renderer::onMeshRendererChanged>(this);
+    registry.on_destroy<MeshRendererComponent>().connect<&Renderer::onMeshRendererDestroyed>(this);
+    registry.on_construct<PrefabInstanceComponent>().connect<&Renderer::onMeshRendererChanged>(this);
+    registry.on_destroy<PrefabInstanceComponent>().connect<&Renderer::onPrefabInstanceDestroyed>(this);
+    registry.on_construct<TransformComponent>().connect<&Renderer::onTransformChanged>(this);
+    registry.on_update<TransformComponent>().connect<&Renderer::onTransformChanged>(this);
+    registry.on_construct<LightComponent>().connect<&Renderer::onLightConstructed>(this);
+    registry.on_update<LightComponent>().connect<&Renderer::onLightChanged>(this);
+    registry.on_destroy<LightComponent>().connect<&Renderer::onLightDestroyed>(this);
+    registry.on_construct<Inactive>().connect<&Renderer::onActivationChanged>(this);
+    registry.on_destroy<Inactive>().connect<&Renderer::onActivationChanged>(this);
+    registry.on_construct<Static>().connect<&Renderer::onStaticChanged>(this);
+    registry.on_destroy<Static>().connect<&Renderer::onStaticChanged>(this);
+
+    // Pick up whatever the scene already contains
+    for (auto entity : registry.view<MeshRendererComponent>())
+    {
+        onMeshRendererChanged(registry, entity);
+    }
+    for (auto entity : registry.view<PrefabInstanceComponent>(entt::exclude<MeshRendererComponent>))
+    {
+        onMeshRendererChanged(registry, entity);
+    }
+    for (auto entity : registry.view<LightComponent>())
+    {
+        onLightConstructed(registry, entity);
+    }
+}
+
+void Renderer::detachScene()
+{
+    if (!m_scene) return;
+
+    entt::registry& registry = m_scene->getRegistry();
+    registry.on_construct<MeshRendererComponent>().disconnect<&Renderer::onMeshRendererChanged>(this);
+    registry.on_update<MeshRendererComponent>().disconnect<&Renderer::onMeshRendererChanged>(this);
+    registry.on_destroy<MeshRendererComponent>().disconnect<&Renderer::onMeshRendererDestroyed>(this);
+    registry.on_construct<PrefabInstanceComponent>().disconnect<&Renderer::onMeshRendererChanged>(this);
+    registry.on_destroy<PrefabInstanceComponent>().disconnect<&Renderer::onPrefabInstanceDestroyed>(this);
+    registry.on_construct<TransformComponent>().disconnect<&Renderer::onTransformChanged>(this);
+    registry.on_update<TransformComponent>().disconnect<&Renderer::onTransformChanged>(this);
+    registry.on_construct<LightComponent>().disconnect<&Renderer::onLightConstructed>(this);
+    registry.on_update<LightComponent>().disconnect<&Renderer::onLightChanged>(this);
+    registry.on_destroy<LightComponent>().disconnect<&Renderer::onLightDestroyed>(this);
+    registry.on_construct<Inactive>().disconnect<&Renderer::onActivationChanged>(this);
+    registry.on_destroy<Inactive>().disconnect<&Renderer::onActivationChanged>(this);
+    registry.on_construct<Static>().disconnect<&Renderer::onStaticChanged>(this);
+    registry.on_destroy<Static>().disconnect<&Renderer::onStaticChanged>(this);
+    m_scene = nullptr;
+
+    m_changedMeshRenderers.clear();
+    m_pendingMeshRenderers.clear();
+    m_changedTransforms.clear();
+    m_changedLights.clear();
+    m_changedActivations.clear();
+
+    m_drawSlots.clear();
+    m_drawRecords.clear();
+    m_resourcesReleased = true;
+    m_drawData.clear();
+    m_freeDrawSlots.clear();
+    m_dirtyDrawSlots.clear();
+    m_drawGroupsDirty = true;
+
+    m_lightEntities.clear();
+    m_dirtyLightSlots.clear();
+    m_activeLights = 0;
+    m_shadowMap.invalidateStatic();
+}
+
+void Renderer::onMeshRendererChanged(entt::registry& registry, entt::entity entity)
+{
+    UNUSED(registry);
+    std::lock_guard<std::mutex> lock(m_changeMutex);
+    m_changedMeshRenderers.push_back(entity);
+}
+
+void Renderer::onMeshRendererDestroyed(entt::registry& registry, entt::entity entity)
+{
+    // Structural change, main thread only
+    if (registry.all_of<Static>(entity)) m_shadowMap.invalidateStatic();
+
+    // A prefab instance losing its override draws the prefab's mesh renderer again
+    if (const auto* instance = registry.try_get<PrefabInstanceComponent>(entity);
+        instance && std::get<std::optional<MeshRendererComponent>>(instance->prefab->components))
+    {
+        onMeshRendererChanged(registry, entity);
+        return;
+    }
+    releaseDrawRecord(entity);
+}
+
+void Renderer::onPrefabInstanceDestroyed(entt::registry& registry, entt::entity entity)
+{
+    // An override keeps the draw record, whichever of the two goes last releases it
+    if (registry.all_of<MeshRendererComponent>(entity)) return;
+
+    if (registry.all_of<Static>(entity)) m_shadowMap.invalidateStatic();
+    releaseDrawRecord(entity);
+}
+
+void Renderer::releaseDrawRecord(entt::entity entity)
+{
+    auto it = m_drawSlots.find(entity);
+    if (it == m_drawSlots.end()) return;
+
+    m_drawRecords[it->second] = {};
+    m_freeDrawSlots.push_back(it->second);
+    m_drawSlots.erase(it);
+    m_resourcesReleased = true;
+    m_drawGroupsDirty = true;
+}
+
+void Renderer::onTransformChanged(entt::registry& registry, entt::entity entity)
+{
+    UNUSED(registry);
+    std::lock_guard<std::mutex> lock(m_changeMutex);
+    m_changedTransforms.push_back(entity);
+}
+
+void Renderer::onLightConstructed(entt::registry& registry, entt::entity entity)
+{
+    UNUSED(registry);
+
+    // Structural change, main thread only
+    uint32_t slot = static_cast<uint32_t>(m_lightEntities.size());
+    m_lightEntities.push_back(entity);
+    if (slot < MAX_LIGHTS) m_dirtyLightSlots.push_back(slot);
+}
+
+void Renderer::onLightChanged(entt::registry& registry, entt::entity entity)
+{
+    UNUSED(registry);
+    std::lock_guard<std::mutex> lock(m_changeMutex);
+    m_changedLights.push_back(entity);
+}
+
+void Renderer::onActivationChanged(entt::registry& registry, entt::entity entity)
+{
+    // Structural change, main thread only
+    if (registry.all_of<Static>(entity)) m_shadowMap.invalidateStatic();
+
+    // Parked meshes drop out through the spatial index and their draw group, lights are
+    // written out dark. Inactive is still attached while it's being removed, so both
+    // are resolved once the change is done.
+    std::lock_guard<std::mutex> lock(m_changeMutex);
+    if (findComponent<MeshRendererComponent>(registry, entity)) m_changedActivations.push_back(entity);
+    if (registry.all_of<LightComponent>(entity)) m_changedLights.push_back(entity);
+}
+
+void Renderer::onStaticChanged(entt::registry& registry, entt::entity entity)
+{
+    // Structural change, main thread only
+    if (findComponent<MeshRendererComponent>(registry, entity)) m_shadowMap.invalidateStatic();
+}
+
+void Renderer::onLightDestroyed(entt::registry& registry, entt::entity entity)
+{
+    UNUSED(registry);
+
+    // Keep lights packed: the last one moves into the freed slot
+    auto it = std::find(m_lightEntities.begin(), m_lightEntities.end(), entity);
+    if (it == m_lightEntities.end()) return;
+
+    uint32_t slot = static_cast<uint32_t>(it - m_lightEntities.begin());
+    *it = m_lightEntities.back();
+    m_lightEntities.pop_back();
+    if (slot < m_lightEntities.size() && slot < MAX_LIGHTS) m_dirtyLightSlots.push_back(slot);
+}
+
+void Renderer::processSceneChanges(entt::registry& registry)
+{
+    std::vector<entt::entity> meshRenderers, transforms, lights, activations;
+    {
+        std::lock_guard<std::mutex> lock(m_changeMutex);
+        meshRenderers.swap(m_changedMeshRenderers);
+        transforms.swap(m_changedTransforms);
+        lights.swap(m_changedLights);
+        activations.swap(m_changedActivations);
+    }
+
+    // Deferred entities stay ahead of anything queued since, so they aren't starved.
+    // Processing stops at the first one over budget, later frames resume from there.
+    m_pendingMeshRenderers.insert(m_pendingMeshRenderers.end(), meshRenderers.begin(), meshRenderers.end());
+    size_t uploadBudget = UPLOAD_BUDGET_BYTES;
+    while (!m_pendingMeshRenderers.empty())
+    {
+        // Entities may have been destroyed since they were queued
+        entt::entity entity = m_pendingMeshRenderers.front();
+        const MeshRendererComponent* mesh = registry.valid(entity) ? findComponent<MeshRendererComponent>(registry, entity) : nullptr;
+        if (mesh)
+        {
+            // The first upload of a frame always goes through so oversized resources still make progress
+            size_t uploadSize = getPendingUploadSize(*mesh);
+            if (uploadSize > uploadBudget && uploadBudget < UPLOAD_BUDGET_BYTES) break;
+            uploadBudget -= std::min(uploadSize, uploadBudget);
+
+            updateDrawRecord(registry, entity);
+            updateDrawData(registry, entity);
+            if (registry.all_of<Static>(entity)) m_shadowMap.invalidateStatic();
+        }
+        m_pendingMeshRenderers.pop_front();
+    }
+    m_stats.pendingUploads = static_cast<uint32_t>(m_pendingMeshRenderers.size());
+
+    for (auto entity : transforms)
+    {
+        if (!registry.valid(entity)) continue;
+
+        updateDrawData(registry, entity);
+        if (registry.all_of<Static>(entity)) m_shadowMap.invalidateStatic();
+    }
+    uploadDrawData();
+
+    for (auto entity : activations)
+    {
+        auto it = m_drawSlots.find(entity);
+        if (it == m_drawSlots.end() || !registry.valid(entity)) continue;
+
+        m_drawRecords[it->second].active = !registry.all_of<Inactive>(entity);
+        m_drawGroupsDirty = true;
+    }
+
+    for (auto entity : lights)
+    {
+        auto it = std::find(m_lightEntities.begin(), m_lightEntities.end(), entity);
+        if (it != m_lightEntities.end() && it - m_lightEntities.begin() < MAX_LIGHTS)
+        {
+            m_dirtyLightSlots.push_back(static_cast<uint32_t>(it - m_lightEntities.begin()));
+        }
+    }
+    for (uint32_t slot : m_dirtyLightSlots)
+    {
+        updateLightData(registry, slot);
+    }
+    m_dirtyLightSlots.clear();
+    uploadLightData();
+    m_activeLights = std::min<uint32_t>(static_cast<uint32_t>(m_lightEntities.size()), MAX_LIGHTS);
+
+    if (m_resourcesReleased)
+    {
+        evictUnusedResources();
+        m_resourcesReleased = false;
+    }
+}
+
+void Renderer::evictUnusedResources()
 {
-    auto allocateResource = [&](const auto& resource, auto& map, auto createFunc) 
+    // GPU copies live as long as the CPU resource does, the resource manager keeps
+    // those shared between scenes alive across loads
+    for (auto it = m_meshCache.begin(); it != m_meshCache.end();)
+    {
+        if (!it->second.source.expired())
+        {
+            ++it;
+            continue;
+        }
+        m_geometry.free(it->second.buffer);
+        it = m_meshCache.erase(it);
+    }
+
+    for (auto it = m_textureCache.begin(); it != m_textureCache.end();)
+    {
+        if (!it->second.source.expired())
+        {
+            ++it;
+            continue;
+        }
+        deleteTexture(it->second.texture);
+        it = m_textureCache.erase(it);
+    }
+}
+
+void Renderer::updateDrawRecord(entt::registry& registry, entt::entity entity)
+{
+    const auto& mesh = *findComponent<MeshRendererComponent>(registry, entity);
+
+    auto [it, inserted] = m_drawSlots.try_emplace(entity, 0);
+    if (inserted)
+    {
+        if (!m_freeDrawSlots.empty())
+        {
+            it->second = m_freeDrawSlots.back();
+            m_freeDrawSlots.pop_back();
+        }
+        else
+        {
+            it->second = static_cast<uint32_t>(m_drawRecords.size());
+            m_drawRecords.emplace_back();
+            m_drawData.emplace_back();
+        }
+    }
+
+    DrawRecord& record = m_drawRecords[it->second];
+    if (!inserted) m_resourcesReleased = true;
+    record = {};
+    m_drawGroupsDirty = true;
+    if (!mesh.material || !mesh.meshData) return;
+
+    // Upload textures and mesh buffers the first time they're referenced
+    auto resolveTexture = [&](const std::shared_ptr<Image>& image, const Texture& fallback)
     {
-        if(resource && !map.contains(resource->uuid))
+        if (!image) return fallback.id;
+
+        auto cached = m_textureCache.find(image->uuid);
+        if (cached == m_textureCache.end())
         {
-            map.try_emplace(resource->uuid, (this->*createFunc)(*resource));
+            cached = m_textureCache.try_emplace(image->uuid, CachedTexture{ createTexture(*image), image }).first;
         }
+        return cached->second.texture.id;
     };
 
-    for(auto [entity, mesh] : registry.view<MeshRendererComponent>().each())
+    auto cachedMesh = m_meshCache.find(mesh.meshData->uuid);
+    if (cachedMesh == m_meshCache.end())
+    {
+        cachedMesh = m_meshCache.try_emplace(mesh.meshData->uuid, CachedMesh{ m_geometry.allocate(*mesh.meshData), mesh.meshData }).first;
+    }
+
+    record.mesh = cachedMesh->second.buffer;
+    record.albedo = resolveTexture(mesh.material->albedo, m_defaultAlbedo);
+    record.normal = resolveTexture(mesh.material->normal, m_defaultNormalMap);
+    record.specular = resolveTexture(mesh.material->specular, m_defaultSpecularMap);
+    record.material = mesh.material;
+    record.castShadows = mesh.castShadows;
+    record.bounds = mesh.meshData->boundingSphere;
+    record.active = !registry.all_of<Inactive>(entity);
+
+    // Sort keys: materials group by their texture set, the state that's costly to switch
+    record.materialKey = static_cast<uint16_t>(record.albedo * 0x9E37u ^ record.normal * 0x85EBu ^ record.specular * 0xC2B2u);
+    record.meshKey = static_cast<uint16_t>(record.mesh.firstIndex ^ record.mesh.firstIndex >> 16);
+}
+
+size_t Renderer::getPendingUploadSize(const MeshRendererComponent& mesh) const
+{
+    if (!mesh.material || !mesh.meshData) return 0;
+
+    size_t size = 0;
+    if (!m_meshCache.contains(mesh.meshData->uuid))
     {
-        if(!mesh.material) continue;
+        const MeshData& data = *mesh.meshData;
+        size += data.vertices.size() * sizeof(GeometryArena::Vertex);
+        size += data.indices.size() * sizeof(uint32_t);
+    }
+
+    for (const auto& image : { mesh.material->albedo, mesh.material->normal, mesh.material->specular })
+    {
+        if (image && !m_textureCache.contains(image->uuid)) size += image->pixels.size();
+    }
+    return size;
+}
+
+void Renderer::updateDrawData(entt::registry& registry, entt::entity entity)
+{
+    auto it = m_drawSlots.find(entity);
+    if (it == m_drawSlots.end()) return;
+
+    auto* transform = registry.try_get<TransformComponent>(entity);
+    if (!transform) return;
+
+    glm::mat4 model = MathUtils::calculateModelMatrix(*transform);
+    DrawData& data = m_drawData[it->second];
+    data.modelMatrix = model;
+    data.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+
+    DrawRecord& record = m_drawRecords[it->second];
+    if (!record.placed)
+    {
+        record.placed = true;
+        m_drawGroupsDirty = true;
+    }
+
+    if (const auto& material = record.material)
+    {
+        data.ambientShininess = glm::vec4(material->ambient, material->shininess);
+        data.specularOpacity = glm::vec4(material->specularStrength, material->opacity);
+    }
+    m_dirtyDrawSlots.push_back(it->second);
+}
+
+void Renderer::updateLightData(entt::registry& registry, uint32_t slot)
+{
+    if (slot >= m_lightEntities.size()) return;
 
-        allocateResource(mesh.material->albedo, m_textureCache, &Renderer::createTexture);
-        allocateResource(mesh.material->normal, m_textureCache, &Renderer::createTexture);
-        allocateResource(mesh.material->specular, m_textureCache, &Renderer::createTexture);
-        allocateResource(mesh.meshData, m_meshCache, &Renderer::createMeshBuffer);
+    const auto& light = registry.get<LightComponent>(m_lightEntities[slot]);
+    glm::vec3 lightPos = light.type == LightType::DIRECTIONAL 
+                        ? -light.direction * 1000.0f
+                        : light.position;
+
+    const float power = registry.all_of<Inactive>(m_lightEntities[slot]) ? 0.0f : light.power;
+
+    m_lightData[slot] = {
+        glm::vec4(lightPos, 1.0f),
+        glm::vec4(-light.direction, 0.0f),
+        glm::vec4(light.color, 0.0f),
+        glm::vec4(power, static_cast<float>(light.type), 0.0f, 0.0f)
     };
 }
 
-void Renderer::updateLightsUB(entt::registry& registry)
+void Renderer::uploadDrawData()
 {
-    LightsUBO lightsData{};
-    auto lightView = registry.view<LightComponent>();
-    
-    int lightIdx = 0;
-    for(auto [entity, light] : lightView.each()) 
+    // Grow by reallocating, the whole CPU copy is uploaded once
+    if (m_drawData.size() > m_drawCapacity)
     {
-        if(lightIdx >= 10) break;
+        while (m_drawCapacity < m_drawData.size()) m_drawCapacity *= 2;
 
-        glm::vec3 lightPos = light.type == LightType::DIRECTIONAL 
-                            ? -light.direction * 1000.0f
-                            : light.position;
+        deleteUniformBuffer(m_drawBuffer);
+        glCreateBuffers(1, &m_drawBuffer);
+        glNamedBufferStorage(m_drawBuffer, sizeof(DrawData) * m_drawCapacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glNamedBufferSubData(m_drawBuffer, 0, sizeof(DrawData) * m_drawData.size(), m_drawData.data());
+        m_dirtyDrawSlots.clear();
+        return;
+    }
 
-        lightsData.lights[lightIdx] = {
-            glm::vec4(lightPos, 1.0f),
-            glm::vec4(-light.direction, 0.0f),
-            glm::vec4(light.color, 0.0f),
-            glm::vec4(light.power, static_cast<float>(light.type), 0.0f, 0.0f)
-        };
-        
-        lightIdx++;
+    forEachDirtyRange(m_dirtyDrawSlots, [&](uint32_t first, uint32_t count)
+    {
+        glNamedBufferSubData(m_drawBuffer, sizeof(DrawData) * first, sizeof(DrawData) * count, &m_drawData[first]);
+    });
+}
+
+void Renderer::buildDrawCommands()
+{
+    m_drawCommands.clear();
+    m_drawBatches.clear();
+    m_opaqueCommands = 0;
+    m_opaqueBatches = 0;
+
+    // Runs of packets with the same mesh become one instanced command, baseInstance
+    // points the run at its draw slots in the instance buffer. Neither runs nor
+    // batches cross from opaque to transparent packets.
+    const std::vector<DrawPacket>& packets = m_renderQueue.getPackets();
+    bool transparent = false;
+    for (size_t first = 0, last = 0; first < packets.size(); first = last)
+    {
+        const DrawRecord& record = m_drawRecords[packets[first].slot];
+        const RenderPass pass = RenderQueue::getPass(packets[first].key);
+        for (last = first + 1; last < packets.size(); last++)
+        {
+            const DrawRecord& next = m_drawRecords[packets[last].slot];
+            if (next.mesh.firstIndex != record.mesh.firstIndex || next.mesh.firstVertex != record.mesh.firstVertex ||
+                next.albedo != record.albedo || next.normal != record.normal || next.specular != record.specular ||
+                RenderQueue::getPass(packets[last].key) != pass) break;
+        }
+
+        // Opaque packets sort first
+        const bool passStarts = pass == RenderPass::Transparent && !transparent;
+        if (passStarts)
+        {
+            transparent = true;
+            m_opaqueCommands = static_cast<uint32_t>(m_drawCommands.size());
+            m_opaqueBatches = static_cast<uint32_t>(m_drawBatches.size());
+        }
+
+        if (m_drawBatches.empty() || passStarts || m_drawBatches.back().albedo != record.albedo ||
+            m_drawBatches.back().normal != record.normal || m_drawBatches.back().specular != record.specular)
+        {
+            m_drawBatches.push_back({ static_cast<uint32_t>(m_drawCommands.size()), 0, record.albedo, record.normal, record.specular });
+        }
+        m_drawBatches.back().commandCount++;
+
+        m_drawCommands.push_back({
+            record.mesh.indexCount,
+            static_cast<uint32_t>(last - first),
+            record.mesh.firstIndex,
+            static_cast<int32_t>(record.mesh.firstVertex),
+            static_cast<uint32_t>(first)
+        });
+    }
+
+    if (!transparent)
+    {
+        m_opaqueCommands = static_cast<uint32_t>(m_drawCommands.size());
+        m_opaqueBatches = static_cast<uint32_t>(m_drawBatches.size());
+    }
+}
+
+void Renderer::uploadDrawPhases()
+{
+    // With GPU culling the queue only holds transparent draws, they aren't occlusion culled
+    const bool occlusionCulling = m_occlusionCulling && !m_gpuCulling;
+    m_drawPhases = {};
+    m_phaseCount = occlusionCulling ? 2 : 1;
+    m_cullObjectCount = 0;
+    if (!m_gpuCulling) m_stats.occlusionTested = 0;
+
+    const std::vector<DrawPacket>& packets = m_renderQueue.getPackets();
+    if (packets.empty()) return;
+
+    const size_t instanceSize = sizeof(uint32_t) * packets.size();
+    const size_t commandSize = sizeof(DrawCommand) * m_drawCommands.size();
+    if (!occlusionCulling)
+    {
+        // Draw slots in submission order, rewritten every frame
+        DrawPhase& phase = m_drawPhases[0];
+        phase.instances = m_frameData.allocate(instanceSize, sizeof(uint32_t));
+        uint32_t* slots = static_cast<uint32_t*>(phase.instances.data);
+        for (size_t i = 0; i < packets.size(); i++)
+        {
+            slots[i] = packets[i].slot;
+        }
+
+        phase.commands = m_frameData.allocate(commandSize, sizeof(uint32_t));
+        std::memcpy(phase.commands.data, m_drawCommands.data(), commandSize);
+        return;
+    }
+
+    // Commands start out without instances, the occlusion shader appends the visible ones
+    const size_t alignment = static_cast<size_t>(m_storageAlignment);
+    for (DrawPhase& phase : m_drawPhases)
+    {
+        phase.instances = m_frameData.allocate(instanceSize, alignment);
+        phase.commands = m_frameData.allocate(commandSize, alignment);
+
+        DrawCommand* commands = static_cast<DrawCommand*>(phase.commands.data);
+        for (size_t i = 0; i < m_drawCommands.size(); i++)
+        {
+            commands[i] = m_drawCommands[i];
+            commands[i].instanceCount = 0;
+        }
+    }
+
+    // One object per packet, pointing at the command that draws it
+    m_cullObjectCount = static_cast<uint32_t>(packets.size());
+    m_cullObjects = m_frameData.allocate(sizeof(CullObject) * packets.size(), alignment);
+    m_earlyVisibility = m_frameData.allocate(sizeof(uint32_t) * packets.size(), alignment);
+    m_stats.occlusionTested = m_cullObjectCount;
+
+    CullObject* objects = static_cast<CullObject*>(m_cullObjects.data);
+    for (uint32_t command = 0; command < m_drawCommands.size(); command++)
+    {
+        const DrawCommand& draw = m_drawCommands[command];
+        for (uint32_t i = draw.baseInstance; i < draw.baseInstance + draw.instanceCount; i++)
+        {
+            const BoundingSphere& sphere = m_drawSpheres[packets[i].slot];
+            objects[i] = { glm::vec4(sphere.center, sphere.radius), packets[i].slot, command, {} };
+        }
+    }
+}
+
+void Renderer::buildHiZ(const glm::mat4& viewProjection)
+{
+    m_stateTracker.useProgram(m_hiZProgram.id);
+    for (uint32_t level = 0; level < m_hiZ.getLevelCount(); level++)
+    {
+        // Level 0 reads the depth buffer, every other level the one before it
+        m_stateTracker.bindTexture(6, level == 0 ? m_frameBuffer.depthTexture : m_hiZ.getTexture());
+        m_hiZProgram.set(m_hiZSourceLevel, level == 0 ? 0 : static_cast<int>(level - 1));
+        glBindImageTexture(0, m_hiZ.getTexture(), static_cast<GLint>(level), GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        const glm::uvec2 size = m_hiZ.getLevelSize(level);
+        glDispatchCompute((size.x + 7) / 8, (size.y + 7) / 8, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    m_hiZ.setBuilt(viewProjection);
+}
+
+void Renderer::cullOcclusion(uint32_t phase)
+{
+    if (m_cullObjectCount == 0) return;
+
+    const OcclusionUniforms& uniforms = m_occlusionUniforms;
+    m_stateTracker.useProgram(m_occlusionProgram.id);
+    m_stateTracker.bindTexture(5, m_hiZ.getTexture());
+    m_occlusionProgram.set(uniforms.objectCount, static_cast<int>(m_cullObjectCount));
+    m_occlusionProgram.set(uniforms.phase, static_cast<int>(phase));
+    m_occlusionProgram.set(uniforms.pyramidValid, m_hiZ.isValid() ? 1 : 0);
+    m_occlusionProgram.set(uniforms.counterSlot, static_cast<int>(m_occlusionFrame));
+    m_occlusionProgram.set(uniforms.viewProjection, m_hiZ.getViewProjection());
+    m_occlusionProgram.set(uniforms.depthSize, m_hiZ.getDepthSize());
+
+    const DrawPhase& target = m_drawPhases[phase];
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, m_cullObjects.buffer, m_cullObjects.offset, sizeof(CullObject) * m_cullObjectCount);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, target.commands.buffer, target.commands.offset, sizeof(DrawCommand) * m_drawCommands.size());
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 4, target.instances.buffer, target.instances.offset, sizeof(uint32_t) * m_cullObjectCount);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 5, m_earlyVisibility.buffer, m_earlyVisibility.offset, sizeof(uint32_t) * m_cullObjectCount);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, m_occlusionCounters);
+
+    glDispatchCompute((m_cullObjectCount + 63) / 64, 1, 1);
+
+    // Commands are read by the indirect draws, instances as vertex attributes and
+    // the counters by the CPU after the frame's fence
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+}
+
+void Renderer::drawDepthPhase(const DrawPhase& phase)
+{
+    if (m_opaqueCommands == 0) return;
+
+    // Opaque commands come first, so they're a single multi-draw without textures
+    m_stateTracker.useProgram(m_depthProgram.id);
+    m_geometry.setInstanceBuffer(phase.instances.buffer, phase.instances.offset);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, phase.commands.buffer);
+    const void* offset = reinterpret_cast<const void*>(phase.commands.offset);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset, static_cast<GLsizei>(m_opaqueCommands), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    m_stats.drawCalls++;
+}
+
+void Renderer::drawShadedPhase(const DrawPhase& phase, size_t firstBatch, size_t lastBatch)
+{
+    if (firstBatch >= lastBatch) return;
+
+    m_stateTracker.useProgram(m_standardProgram.id);
+    m_geometry.setInstanceBuffer(phase.instances.buffer, phase.instances.offset);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, phase.commands.buffer);
+    for (size_t i = firstBatch; i < lastBatch; i++)
+    {
+        const DrawBatch& batch = m_drawBatches[i];
+        m_stateTracker.bindTexture(0, batch.albedo);
+        m_stateTracker.bindTexture(1, batch.normal);
+        m_stateTracker.bindTexture(2, batch.specular);
+
+        const GLintptr commandOffset = phase.commands.offset + static_cast<GLintptr>(sizeof(DrawCommand) * batch.firstCommand);
+        const void* offset = reinterpret_cast<const void*>(commandOffset);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset, static_cast<GLsizei>(batch.commandCount), 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    m_stats.drawCalls += static_cast<uint32_t>(lastBatch - firstBatch);
+}
+
+void Renderer::buildDrawGroups()
+{
+    m_drawGroupsDirty = false;
+    m_drawGroups.clear();
+    m_groupBatches.clear();
+    m_groupSlots.clear();
+    m_transparentEntities.clear();
+    m_cullData.assign(m_drawRecords.size(), { glm::vec4(0.0f), NO_DRAW_GROUP, {} });
+
+    for (const auto& [entity, slot] : m_drawSlots)
+    {
+        const DrawRecord& record = m_drawRecords[slot];
+        if (!record.material || !record.active || !record.placed) continue;
+
+        if (record.material->opacity < 1.0f) m_transparentEntities.push_back(entity);
+        else m_groupSlots.push_back(slot);
+    }
+
+    // Texture set first so a batch's groups are contiguous, then mesh so a group's slots are
+    std::sort(m_groupSlots.begin(), m_groupSlots.end(), [&](uint32_t a, uint32_t b)
+    {
+        const DrawRecord& recordA = m_drawRecords[a];
+        const DrawRecord& recordB = m_drawRecords[b];
+        if (recordA.albedo != recordB.albedo) return recordA.albedo < recordB.albedo;
+        if (recordA.normal != recordB.normal) return recordA.normal < recordB.normal;
+        if (recordA.specular != recordB.specular) return recordA.specular < recordB.specular;
+        if (recordA.mesh.firstIndex != recordB.mesh.firstIndex) return recordA.mesh.firstIndex < recordB.mesh.firstIndex;
+        return recordA.mesh.firstVertex < recordB.mesh.firstVertex;
+    });
+
+    // Each group gets as many instances as it has slots, a batch as many commands as
+    // it has groups, so the shader never runs out of room
+    for (size_t first = 0, last = 0; first < m_groupSlots.size(); first = last)
+    {
+        const DrawRecord& record = m_drawRecords[m_groupSlots[first]];
+        for (last = first + 1; last < m_groupSlots.size(); last++)
+        {
+            const DrawRecord& next = m_drawRecords[m_groupSlots[last]];
+            if (next.mesh.firstIndex != record.mesh.firstIndex || next.mesh.firstVertex != record.mesh.firstVertex ||
+                next.albedo != record.albedo || next.normal != record.normal || next.specular != record.specular) break;
+        }
+
+        if (m_groupBatches.empty() || m_groupBatches.back().albedo != record.albedo ||
+            m_groupBatches.back().normal != record.normal || m_groupBatches.back().specular != record.specular)
+        {
+            m_groupBatches.push_back({ static_cast<uint32_t>(m_drawGroups.size()), 0, record.albedo, record.normal, record.specular });
+        }
+        m_groupBatches.back().commandCount++;
+
+        const uint32_t group = static_cast<uint32_t>(m_drawGroups.size());
+        m_drawGroups.push_back({
+            record.mesh.indexCount,
+            record.mesh.firstIndex,
+            static_cast<int32_t>(record.mesh.firstVertex),
+            static_cast<uint32_t>(first),
+            static_cast<uint32_t>(m_groupBatches.size() - 1),
+            m_groupBatches.back().firstCommand,
+            {}
+        });
+
+        for (size_t i = first; i < last; i++)
+        {
+            const uint32_t slot = m_groupSlots[i];
+            const BoundingSphere& bounds = m_drawRecords[slot].bounds;
+            m_cullData[slot] = { glm::vec4(bounds.center, bounds.radius), group, {} };
+        }
+    }
+
+    m_groupInstanceCount = static_cast<uint32_t>(m_groupSlots.size());
+    m_stats.gpuDrawGroups = static_cast<uint32_t>(m_drawGroups.size());
+    if (m_drawGroups.empty()) return;
+
+    // Objects, groups and batches are fixed until the next rebuild, commands, instances
+    // and counts are written again by every frame's culling pass
+    const size_t groups = m_drawGroups.size();
+    reserveBuffer(m_cullBuffer, sizeof(CullData) * m_cullData.size(), GL_DYNAMIC_STORAGE_BIT);
+    reserveBuffer(m_drawGroupBuffer, sizeof(DrawGroup) * groups, GL_DYNAMIC_STORAGE_BIT);
+    reserveBuffer(m_groupCommands, sizeof(DrawCommand) * groups * 2, 0);
+    reserveBuffer(m_groupInstances, sizeof(uint32_t) * m_groupInstanceCount * 2, 0);
+    reserveBuffer(m_groupCounts, sizeof(uint32_t) * (m_groupBatches.size() + groups) * 2, 0);
+    reserveBuffer(m_groupVisibility, sizeof(uint32_t) * m_cullData.size(), 0);
+
+    glNamedBufferSubData(m_cullBuffer.id, 0, sizeof(CullData) * m_cullData.size(), m_cullData.data());
+    glNamedBufferSubData(m_drawGroupBuffer.id, 0, sizeof(DrawGroup) * groups, m_drawGroups.data());
+}
+
+void Renderer::cullOnGpu(uint32_t phase, const glm::mat4& viewProjection)
+{
+    if (phase == 0) m_stats.occlusionTested = m_occlusionCulling ? m_groupInstanceCount : 0;
+    if (m_drawGroups.empty()) return;
+
+    const GpuCullUniforms& uniforms = m_gpuCullUniforms;
+    m_stateTracker.useProgram(m_gpuCullProgram.id);
+    m_stateTracker.bindTexture(5, m_hiZ.getTexture());
+    m_gpuCullProgram.set(uniforms.phase, static_cast<int>(phase));
+    m_gpuCullProgram.set(uniforms.objectCount, static_cast<int>(m_cullData.size()));
+    m_gpuCullProgram.set(uniforms.groupCount, static_cast<int>(m_drawGroups.size()));
+    m_gpuCullProgram.set(uniforms.batchCount, static_cast<int>(m_groupBatches.size()));
+    m_gpuCullProgram.set(uniforms.instanceCount, static_cast<int>(m_groupInstanceCount));
+    m_gpuCullProgram.set(uniforms.testOcclusion, m_occlusionCulling && (phase > 0 || m_hiZ.isValid()) ? 1 : 0);
+    m_gpuCullProgram.set(uniforms.counterSlot, static_cast<int>(m_occlusionFrame));
+    m_gpuCullProgram.set(uniforms.viewProjection, viewProjection);
+    m_gpuCullProgram.set(uniforms.hiZViewProjection, m_hiZ.getViewProjection());
+    m_gpuCullProgram.set(uniforms.depthSize, m_hiZ.getDepthSize());
+
+    // Draw slot transforms are read from the draw buffer at binding 1
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_occlusionCounters);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_cullBuffer.id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_drawGroupBuffer.id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_groupCommands.id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_groupInstances.id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, m_groupCounts.id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, m_groupVisibility.id);
+
+    // Counts restart every frame, commands past a batch's count are never read
+    if (phase == 0) glClearNamedBufferData(m_groupCounts.id, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    m_gpuCullProgram.set(uniforms.stage, 0);
+    glDispatchCompute((static_cast<uint32_t>(m_cullData.size()) + 63) / 64, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    m_gpuCullProgram.set(uniforms.stage, 1);
+    glDispatchCompute((static_cast<uint32_t>(m_drawGroups.size()) + 63) / 64, 1, 1);
+
+    // Commands and draw counts are read by the indirect draws, instances as vertex
+    // attributes and the counters by the CPU after the frame's fence
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+}
+
+void Renderer::drawGpuPhase(uint32_t phase, bool shaded)
+{
+    if (m_drawGroups.empty()) return;
+
+    // One multi-draw per texture batch whatever the number of objects, the GPU decides
+    // how many of the batch's commands are drawn
+    m_stateTracker.useProgram(shaded ? m_standardProgram.id : m_depthProgram.id);
+    m_geometry.setInstanceBuffer(m_groupInstances.id, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_groupCommands.id);
+    glBindBuffer(GL_PARAMETER_BUFFER, m_groupCounts.id);
+
+    const size_t batches = m_groupBatches.size();
+    for (size_t i = 0; i < batches; i++)
+    {
+        const DrawBatch& batch = m_groupBatches[i];
+        if (shaded)
+        {
+            m_stateTracker.bindTexture(0, batch.albedo);
+            m_stateTracker.bindTexture(1, batch.normal);
+            m_stateTracker.bindTexture(2, batch.specular);
+        }
+
+        const size_t command = m_drawGroups.size() * phase + batch.firstCommand;
+        const void* offset = reinterpret_cast<const void*>(sizeof(DrawCommand) * command);
+        const GLintptr drawCount = static_cast<GLintptr>(sizeof(uint32_t) * (batches * phase + i));
+        const GLsizei maxDrawCount = static_cast<GLsizei>(batch.commandCount);
+        if (GLEW_VERSION_4_6) glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, offset, drawCount, maxDrawCount, 0);
+        else glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, offset, drawCount, maxDrawCount, 0);
+    }
+    glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    m_stats.drawCalls += static_cast<uint32_t>(batches);
+}
+
+void Renderer::readOcclusionCounters()
+{
+    // The ring buffer has waited for the frame that last used this slot
+    m_occlusionFrame = (m_occlusionFrame + 1) % RingBuffer::FRAMES;
+    const glm::uvec4 counters = m_occlusionCounterData[m_occlusionFrame];
+    m_stats.occlusionVisibleEarly = counters.x;
+    m_stats.occlusionVisibleLate = counters.y;
+    m_stats.gpuFrustumCulled = counters.z;
+    m_stats.gpuDrawCommands = counters.w;
+
+    const GLintptr offset = static_cast<GLintptr>(sizeof(glm::uvec4) * m_occlusionFrame);
+    glClearNamedBufferSubData(m_occlusionCounters, GL_RGBA32UI, offset, sizeof(glm::uvec4), GL_RGBA_INTEGER, GL_UNSIGNED_INT, nullptr);
+}
+
+void Renderer::renderShadows(Scene& scene, const glm::mat4& view, float fov, float aspect, float nearClip, float farClip)
+{
+    entt::registry& registry = scene.getRegistry();
+    m_shadowMap.beginFrame();
+
+    // The first active directional light casts shadows
+    int32_t lightSlot = -1;
+    glm::vec3 lightDirection(0.0f);
+    for (uint32_t slot = 0; slot < m_activeLights; slot++)
+    {
+        entt::entity entity = m_lightEntities[slot];
+        const auto& light = registry.get<LightComponent>(entity);
+        if (light.type != LightType::DIRECTIONAL || registry.all_of<Inactive>(entity)) continue;
+        if (glm::dot(light.direction, light.direction) == 0.0f) continue;
+
+        lightSlot = static_cast<int32_t>(slot);
+        lightDirection = glm::normalize(light.direction);
+        break;
+    }
+
+    if (lightSlot >= 0)
+    {
+        m_shadowMap.update(view, fov, aspect, nearClip, farClip, lightDirection);
+
+        const DynamicBVH& spatialIndex = scene.getSpatialIndex();
+        m_shadowMap.beginPass();
+        m_stateTracker.useProgram(m_depthProgram.id);
+        m_stateTracker.bindVertexArray(m_geometry.getVertexArray());
+
+        for (uint32_t cascade = 0; cascade < SHADOW_CASCADES; cascade++)
+        {
+            // Static casters are only needed when the cascade's cache is rebuilt
+            const bool collectStatic = m_shadowMap.needsStaticPass(cascade);
+            m_staticCasters.clear();
+            m_dynamicCasters.clear();
+
+            spatialIndex.queryFrustum(m_shadowMap.getCasterFrustum(cascade), [&](int32_t proxy, bool fullyInside)
+            {
+                UNUSED(fullyInside);
+                auto entity = static_cast<entt::entity>(spatialIndex.getUserData(proxy));
+                auto it = m_drawSlots.find(entity);
+                if (it == m_drawSlots.end()) return;
+
+                const DrawRecord& record = m_drawRecords[it->second];
+                if (!record.material || !record.castShadows) return;
+
+                if (!registry.all_of<Static>(entity)) m_dynamicCasters.push_back(it->second);
+                else if (collectStatic) m_staticCasters.push_back(it->second);
+            });
+
+            m_depthProgram.set(m_depthViewProjection, m_shadowMap.getViewProjection(cascade));
+            m_shadowMap.renderCascade(cascade, m_staticCasters, m_dynamicCasters, [&](std::vector<uint32_t>& slots)
+            {
+                return drawDepthOnly(slots);
+            });
+        }
+        m_shadowMap.endPass();
+    }
+    m_stats.shadowCascades = m_shadowMap.getStats();
+
+    const ShadowData data = m_shadowMap.getShaderData(lightSlot);
+    RingAllocation allocation = m_frameData.allocate(sizeof(ShadowData), static_cast<size_t>(m_uniformAlignment));
+    std::memcpy(allocation.data, &data, sizeof(ShadowData));
+    glBindBufferRange(GL_UNIFORM_BUFFER, 2, allocation.buffer, allocation.offset, sizeof(ShadowData));
+}
+
+void Renderer::renderPointShadows(Scene& scene, const glm::vec3& cameraPosition, float fov, const glm::mat4& viewProjection)
+{
+    entt::registry& registry = scene.getRegistry();
+
+    m_pointShadowLights.clear();
+    for (uint32_t slot = 0; slot < m_activeLights; slot++)
+    {
+        entt::entity entity = m_lightEntities[slot];
+        const auto& light = registry.get<LightComponent>(entity);
+        if (light.type != LightType::POINT || light.power <= 0.0f || registry.all_of<Inactive>(entity)) continue;
+
+        const float radius = std::sqrt(light.power / POINT_SHADOW_CUTOFF);
+        m_pointShadowLights.push_back({ static_cast<uint32_t>(entity), slot, light.position, radius });
+    }
+
+    const Frustum viewFrustum = BoundsUtils::extractFrustum(viewProjection);
+    m_pointShadows.update(m_pointShadowLights, cameraPosition, fov, viewFrustum, POINT_SHADOW_FACE_BUDGET);
+
+    const std::vector<PointShadowFace>& faces = m_pointShadows.getPendingFaces();
+    if (!faces.empty())
+    {
+        const DynamicBVH& spatialIndex = scene.getSpatialIndex();
+        m_pointShadows.beginPass();
+        m_stateTracker.useProgram(m_depthProgram.id);
+        m_stateTracker.bindVertexArray(m_geometry.getVertexArray());
+
+        uint32_t casters = 0;
+        for (const PointShadowFace& face : faces)
+        {
+            m_pointCasters.clear();
+            spatialIndex.queryFrustum(face.frustum, [&](int32_t proxy, bool fullyInside)
+            {
+                UNUSED(fullyInside);
+                auto entity = static_cast<entt::entity>(spatialIndex.getUserData(proxy));
+                auto it = m_drawSlots.find(entity);
+                if (it == m_drawSlots.end()) return;
+
+                const DrawRecord& record = m_drawRecords[it->second];
+                if (record.material && record.castShadows) m_pointCasters.push_back(it->second);
+            });
+
+            m_pointShadows.beginFace(face);
+            m_depthProgram.set(m_depthViewProjection, face.viewProjection);
+            casters += drawDepthOnly(m_pointCasters);
+        }
+        m_pointShadows.endPass(casters);
+    }
+    m_stats.pointShadows = m_pointShadows.getStats();
+
+    const PointShadowData data = m_pointShadows.getShaderData();
+    RingAllocation allocation = m_frameData.allocate(sizeof(PointShadowData), static_cast<size_t>(m_uniformAlignment));
+    std::memcpy(allocation.data, &data, sizeof(PointShadowData));
+    glBindBufferRange(GL_UNIFORM_BUFFER, 3, allocation.buffer, allocation.offset, sizeof(PointShadowData));
+}
+
+uint32_t Renderer::drawDepthOnly(std::vector<uint32_t>& slots)
+{
+    if (slots.empty()) return 0;
+
+    // Casters sharing a mesh end up next to each other and merge into instanced commands
+    std::sort(slots.begin(), slots.end(), [&](uint32_t a, uint32_t b)
+    {
+        const MeshBuffer& meshA = m_drawRecords[a].mesh;
+        const MeshBuffer& meshB = m_drawRecords[b].mesh;
+        if (meshA.firstIndex != meshB.firstIndex) return meshA.firstIndex < meshB.firstIndex;
+        return meshA.firstVertex < meshB.firstVertex;
+    });
+
+    const size_t instanceSize = sizeof(uint32_t) * slots.size();
+    RingAllocation instances = m_frameData.allocate(instanceSize, sizeof(uint32_t));
+    std::memcpy(instances.data, slots.data(), instanceSize);
+
+    m_depthCommands.clear();
+    for (size_t first = 0, last = 0; first < slots.size(); first = last)
+    {
+        const MeshBuffer& mesh = m_drawRecords[slots[first]].mesh;
+        for (last = first + 1; last < slots.size(); last++)
+        {
+            const MeshBuffer& next = m_drawRecords[slots[last]].mesh;
+            if (next.firstIndex != mesh.firstIndex || next.firstVertex != mesh.firstVertex) break;
+        }
+
+        m_depthCommands.push_back({
+            mesh.indexCount,
+            static_cast<uint32_t>(last - first),
+            mesh.firstIndex,
+            static_cast<int32_t>(mesh.firstVertex),
+            static_cast<uint32_t>(first)
+        });
     }
-    m_activeLights = lightIdx;
 
-    // Update UBO data
-    glNamedBufferSubData(m_lightsUBO, 0, sizeof(LightsUBO), &lightsData);
+    const size_t commandSize = sizeof(DrawCommand) * m_depthCommands.size();
+    RingAllocation commands = m_frameData.allocate(commandSize, sizeof(uint32_t));
+    std::memcpy(commands.data, m_depthCommands.data(), commandSize);
+
+    m_geometry.setInstanceBuffer(instances.buffer, instances.offset);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.buffer);
+    const void* offset = reinterpret_cast<const void*>(commands.offset);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset, static_cast<GLsizei>(m_depthCommands.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    return static_cast<uint32_t>(slots.size());
+}
+
+void Renderer::uploadLightData()
+{
+    // A few hundred bytes, the whole block is copied into this frame's region
+    const size_t size = sizeof(LightData) * MAX_LIGHTS;
+    RingAllocation allocation = m_frameData.allocate(size, static_cast<size_t>(m_uniformAlignment));
+    std::memcpy(allocation.data, m_lightData.data(), size);
+    glBindBufferRange(GL_UNIFORM_BUFFER, 0, allocation.buffer, allocation.offset, static_cast<GLsizeiptr>(size));
 }
 
 Texture Renderer::createTexture(const Image& image)
@@ -375,64 +1620,6 @@ void Renderer::deleteTexture(Texture& texture)
     glDeleteTextures(1, &texture.id);
 }
 
-MeshBuffer Renderer::createMeshBuffer(const MeshData& meshData)
-{
-    MeshBuffer meshBuffer;
-
-    meshBuffer.indexCount = static_cast<uint16_t>(meshData.indices.size());
-
-    glCreateVertexArrays(1, &meshBuffer.vao);
-    glCreateBuffers(1, &meshBuffer.vbo);
-    glCreateBuffers(1, &meshBuffer.tbo);
-    glCreateBuffers(1, &meshBuffer.nbo);
-    glCreateBuffers(1, &meshBuffer.tanbo);
-    glCreateBuffers(1, &meshBuffer.bitanbo);
-    glCreateBuffers(1, &meshBuffer.ebo);
-
-    glNamedBufferData(meshBuffer.vbo, meshData.vertices.size() * sizeof(glm::vec3), 
-                     meshData.vertices.data(), GL_STATIC_DRAW);
-    glNamedBufferData(meshBuffer.tbo, meshData.uvs.size() * sizeof(glm::vec2), 
-                     meshData.uvs.data(), GL_STATIC_DRAW);
-    glNamedBufferData(meshBuffer.nbo, meshData.normals.size() * sizeof(glm::vec3), 
-                     meshData.normals.data(), GL_STATIC_DRAW);
-    glNamedBufferData(meshBuffer.tanbo, meshData.tangents.size() * sizeof(glm::vec3), 
-                     meshData.tangents.data(), GL_STATIC_DRAW);
-    glNamedBufferData(meshBuffer.bitanbo, meshData.bitangents.size() * sizeof(glm::vec3), 
-                     meshData.bitangents.data(), GL_STATIC_DRAW);
-    glNamedBufferData(meshBuffer.ebo, meshData.indices.size() * sizeof(uint32_t), 
-                     meshData.indices.data(), GL_STATIC_DRAW);
-
-    const auto setupAttrib = [&](GLuint attribIndex, GLuint buffer, GLint size, GLenum type)
-    {
-        glVertexArrayVertexBuffer(meshBuffer.vao, attribIndex, buffer, 0, size * sizeof(float));
-        glVertexArrayAttribFormat(meshBuffer.vao, attribIndex, size, type, GL_FALSE, 0);
-        glVertexArrayAttribBinding(meshBuffer.vao, attribIndex, attribIndex);
-        glEnableVertexArrayAttrib(meshBuffer.vao, attribIndex);
-    };
-
-    setupAttrib(0, meshBuffer.vbo,     3, GL_FLOAT);  // Positions
-    setupAttrib(1, meshBuffer.tbo,     2, GL_FLOAT);  // UVs
-    setupAttrib(2, meshBuffer.nbo,     3, GL_FLOAT);  // Normals
-    setupAttrib(3, meshBuffer.tanbo,   3, GL_FLOAT);  // Tangents
-    setupAttrib(4, meshBuffer.bitanbo, 3, GL_FLOAT);  // Bitangents
-
-    glVertexArrayElementBuffer(meshBuffer.vao, meshBuffer.ebo);
-
-    return meshBuffer;
-}
-
-void Renderer::deleteMeshBuffer(MeshBuffer& meshBuffer)
-{
-    meshBuffer.indexCount = 0;
-    glDeleteVertexArrays(1, &meshBuffer.vao);
-    glDeleteBuffers(1, &meshBuffer.vbo);
-    glDeleteBuffers(1, &meshBuffer.tbo);
-    glDeleteBuffers(1, &meshBuffer.nbo);
-    glDeleteBuffers(1, &meshBuffer.tanbo);
-    glDeleteBuffers(1, &meshBuffer.bitanbo);
-    glDeleteBuffers(1, &meshBuffer.ebo);
-}
-
 FrameBuffer Renderer::createFrameBuffer(int width, int height, FrameBufferType type)
 {  
     FrameBuffer fb;
@@ -472,11 +1659,12 @@ FrameBuffer Renderer::createFrameBuffer(int width, int height, FrameBufferType t
         glTextureStorage2D(fb.colorTexture, 1, GL_RGBA8, width, height);
         glNamedFramebufferTexture(fb.id, GL_COLOR_ATTACHMENT0, fb.colorTexture, 0);
 
-        // DEPTH/STENCIL BUFFER
-        GLuint rbo;
-        glCreateRenderbuffers(1, &rbo);
-        glNamedRenderbufferStorage(rbo, GL_DEPTH24_STENCIL8, width, height);
-        glNamedFramebufferRenderbuffer(fb.id, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+        // DEPTH/STENCIL TEXTURE, read back into the Hi-Z pyramid
+        glCreateTextures(GL_TEXTURE_2D, 1, &fb.depthTexture);
+        glTextureParameteri(fb.depthTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(fb.depthTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureStorage2D(fb.depthTexture, 1, GL_DEPTH24_STENCIL8, width, height);
+        glNamedFramebufferTexture(fb.id, GL_DEPTH_STENCIL_ATTACHMENT, fb.depthTexture, 0);
     }
 
     if (glCheckNamedFramebufferStatus(fb.id, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) 
@@ -508,8 +1696,9 @@ void Renderer::deleteFrameBuffer(FrameBuffer& fb)
     fb.width = fb.height = 0;
 }
 
-GLuint Renderer::compileShader(std::string source, GLenum type)
+GLuint Renderer::compileShader(const std::string& path, GLenum type)
 {
+    std::string source = FileSystem::read(path);
     GLuint shader = glCreateShader(type);
     const char* sourceCStr = source.c_str();
     
@@ -523,8 +1712,14 @@ GLuint Renderer::compileShader(std::string source, GLenum type)
     {
         char infoLog[512];
         glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-        std::cerr << (type == GL_VERTEX_SHADER ? "Vertex" : "Fragment") 
-                  << " shader compilation failed:\n" << infoLog << std::endl;
+        const char* stage = "Unknown";
+        switch (type)
+        {
+            case GL_VERTEX_SHADER: stage = "Vertex"; break;
+            case GL_FRAGMENT_SHADER: stage = "Fragment"; break;
+            case GL_COMPUTE_SHADER: stage = "Compute"; break;
+        }
+        std::cerr << stage << " shader compilation failed (" << path << "):\n" << infoLog << std::endl;
         glDeleteShader(shader);
         return 0;
     }
@@ -532,18 +1727,21 @@ GLuint Renderer::compileShader(std::string source, GLenum type)
     return shader;
 }
 
-GLuint Renderer::linkProgram(GLuint vertexShader, GLuint fragmentShader)
+GLuint Renderer::linkProgram(std::initializer_list<GLuint> shaders)
 {
     GLuint program = glCreateProgram();
-    glAttachShader(program, vertexShader);
-    glAttachShader(program, fragmentShader);
+    for (GLuint shader : shaders)
+    {
+        glAttachShader(program, shader);
+    }
     glLinkProgram(program);
 
     // Detach and delete shaders regardless of link success
-    glDetachShader(program, vertexShader);
-    glDetachShader(program, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    for (GLuint shader : shaders)
+    {
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+    }
 
     // Check linking status
     GLint success;
@@ -654,44 +1852,4 @@ void Renderer::debugCallback(
 }
 #endif
 
-void ShaderProgram::setBool(const std::string &name, bool value) const
-{
-    glUniform1i(glGetUniformLocation(id, name.c_str()), value);
-}
-
-void ShaderProgram::setInt(const std::string &name, int value) const
-{
-    glUniform1i(glGetUniformLocation(id, name.c_str()), value);
-}
-
-void ShaderProgram::setFloat(const std::string &name, float value) const
-{
-    glUniform1f(glGetUniformLocation(id, name.c_str()), value);
-}
-
-void ShaderProgram::setVec2(const std::string &name, const glm::vec2 &value) const
-{
-    glUniform2fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
-}
-
-void ShaderProgram::setVec3(const std::string &name, const glm::vec3 &value) const
-{
-    glUniform3fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
-}
-
-void ShaderProgram::setVec4(const std::string &name, const glm::vec4 &value) const
-{
-    glUniform4fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
-}
-
-void ShaderProgram::setMat3(const std::string &name, const glm::mat3 &mat) const
-{
-    glUniformMatrix3fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
-}
-
-void ShaderProgram::setMat4(const std::string &name, const glm::mat4 &mat) const
-{
-    glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
-}
-
 } // namespace OpenGL
\ No newline at end of file
@@ -3,13 +3,30 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <deque>
+#include <array>
+#include <mutex>
+#include <unordered_map>
+#include <cstring>
+#include <type_traits>
+#include <initializer_list>
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include "core/uuid.h"
+#include "core/assert.h"
+#include "core/string_id.h"
 #include "core/window.h"
 #include "core/resources.h"
+#include "core/bounds.h"
 #include "scene/scene.h"
+#include "render_queue.h"
+#include "geometry_arena.h"
+#include "ring_buffer.h"
+#include "cascaded_shadow_map.h"
+#include "point_shadow_atlas.h"
+#include "hiz_pyramid.h"
+#include "shader_program.h"
 
 namespace OpenGL 
 {
@@ -19,6 +36,8 @@ using namespace Engine;
 const uint16_t MAX_LIGHTS = 10;
 const uint16_t FRAMEBUFFER_WIDTH = 1920;
 const uint16_t FRAMEBUFFER_HEIGHT = 1080;
+const uint16_t SHADOW_MAP_SIZE = 2048;
+const uint16_t POINT_SHADOW_ATLAS_SIZE = 4096;
 
 const Image DEFAULT_ALBEDO = {
     .pixels = {245, 245, 245}, 
@@ -60,6 +79,26 @@ void main() {
 }
 )";
 
+// Unit primitive expanded per instance, w is divided out so projective transforms
+// (frustums from an inverse view projection) work too
+const std::string DEBUG_SHAPE_VERTEX_SHADER = R"(
+#version 450 core
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec4 aColor;
+layout(location = 2) in mat4 aTransform;
+
+uniform mat4 uViewProjection;
+
+out vec3 vColor;
+
+void main() {
+    vec4 worldPos = aTransform * vec4(aPos, 1.0);
+    gl_Position = uViewProjection * vec4(worldPos.xyz / worldPos.w, 1.0);
+    vColor = aColor.rgb;
+}
+)";
+
 const std::string DEBUG_FRAGMENT_SHADER = R"(
 #version 450 core
 
@@ -78,12 +117,6 @@ struct Texture
     int levels;
 };
 
-struct MeshBuffer
-{
-    uint16_t indexCount;
-    GLuint vao, vbo, tbo, nbo, tanbo, bitanbo, ebo;
-};
-
 enum class FrameBufferType 
 {
     Color,           // Color texture + depth/stencil buffer
@@ -97,31 +130,74 @@ struct FrameBuffer
     int width, height;
 };
 
-class ShaderProgram
+struct RenderStats
 {
-public:
-    GLuint id;
+    uint32_t visibleObjects = 0;
+    uint32_t culledObjects = 0;
+    uint32_t pendingUploads = 0; // Mesh renderers waiting for the per-frame upload budget
+    uint32_t drawCalls = 0;
+    uint32_t drawCommands = 0; // Indirect commands, several per multi-draw call
+    uint32_t programChanges = 0;
+    uint32_t textureChanges = 0;
+    uint32_t vaoChanges = 0;
+    uint32_t frameDataBytes = 0; // Written to the per-frame ring buffer
+    uint32_t frameDataStalls = 0; // Frames that waited for the GPU to release ring buffer space
+    std::array<ShadowCascadeStats, SHADOW_CASCADES> shadowCascades;
+    PointShadowStats pointShadows;
+    uint32_t occlusionTested = 0;
+    uint32_t occlusionVisibleEarly = 0; // Passed against the previous frame's Hi-Z, RingBuffer::FRAMES frames ago
+    uint32_t occlusionVisibleLate = 0;  // Passed the re-test against the current frame's Hi-Z
+    uint32_t gpuDrawGroups = 0;         // Opaque mesh and texture set combinations, one command each at most
+    uint32_t gpuDrawCommands = 0;       // Written by the GPU culling pass, as late as the occlusion counts
+    uint32_t gpuFrustumCulled = 0;
+};
 
-    void setBool(const std::string &name, bool value) const;
-    void setInt(const std::string &name, int value) const;
-    void setFloat(const std::string &name, float value) const;
-    void setVec2(const std::string &name, const glm::vec2 &value) const;
-    void setVec3(const std::string &name, const glm::vec3 &value) const;
-    void setVec4(const std::string &name, const glm::vec4 &value) const;
-    void setMat3(const std::string &name, const glm::mat3 &mat) const;
-    void setMat4(const std::string &name, const glm::mat4 &mat) const;
+enum class DebugMode : uint8_t
+{
+    DepthTested, // World space, hidden by scene geometry
+    Overlay,     // World space, drawn on top
+    Screen,      // Framebuffer pixels, origin top left, drawn on top
+    Count
 };
-    
+
+enum class DebugShape : uint8_t
+{
+    Cube,   // [-1, 1] on every axis
+    Sphere, // Radius 1
+    Cone,   // Apex at the origin, base of radius 1 at z = 1
+    Count
+};
+
+// Shapes are unit primitives built once and drawn instanced, lines are streamed
+// through the frame's ring buffer. A primitive added with a duration is kept and
+// redrawn until it expires, otherwise it's drawn for the current frame only.
 class DebugRenderer
 {
 public:
     bool initialize();
     void cleanup();
-    void startFrame();
-    void addLine(const glm::vec3& start, const glm::vec3& end, const glm::vec3& color);
-    void addCube(const glm::vec3& position, const glm::vec3& size, const glm::vec3& color);
-    void addSphere(const glm::vec3& position, float radius, const glm::vec3& color, int segments = 20);
-    void endFrame(const glm::mat4& viewProjection);
+
+    void addLine(const glm::vec3& start, const glm::vec3& end, const glm::vec3& color,
+                 DebugMode mode = DebugMode::DepthTested, float duration = 0.0f);
+    void addShape(DebugShape shape, const glm::mat4& transform, const glm::vec3& color,
+                  DebugMode mode = DebugMode::DepthTested, float duration = 0.0f);
+
+    void addCube(const glm::vec3& position, const glm::vec3& size, const glm::vec3& color,
+                 DebugMode mode = DebugMode::DepthTested, float duration = 0.0f);
+    void addAABB(const AABB& aabb, const glm::vec3& color,
+                 DebugMode mode = DebugMode::DepthTested, float duration = 0.0f);
+    void addSphere(const glm::vec3& position, float radius, const glm::vec3& color,
+                   DebugMode mode = DebugMode::DepthTested, float duration = 0.0f);
+    void addCone(const glm::vec3& apex, const glm::vec3& direction, float length, float radius, const glm::vec3& color,
+                 DebugMode mode = DebugMode::DepthTested, float duration = 0.0f);
+    void addFrustum(const glm::mat4& viewProjection, const glm::vec3& color,
+                    DebugMode mode = DebugMode::DepthTested, float duration = 0.0f);
+
+    // Two draws per mode at most, one for all shapes and one for all lines
+    void render(const glm::mat4& viewProjection, glm::vec2 screenSize, RingBuffer& frameData);
+
+    // Drops single frame and expired primitives, call every frame whether rendered or not
+    void endFrame();
 
 private:
     struct DebugVertex {
@@ -129,8 +205,46 @@ private:
         glm::vec3 color;
     };
 
-    ShaderProgram m_debugShader;
-    std::vector<DebugVertex> m_vertices;
+    // Matches attributes 1-2 of the shape shader
+    struct DebugInstance {
+        glm::vec4 color;
+        glm::mat4 transform;
+    };
+
+    // Matches DrawArraysIndirectCommand
+    struct ShapeCommand {
+        uint32_t count;
+        uint32_t instanceCount;
+        uint32_t first;
+        uint32_t baseInstance;
+    };
+
+    struct ShapeRange {
+        uint32_t first, count;
+    };
+
+    // Expiry times run parallel to the primitives, 0 expires after the next render
+    struct ModeBatch {
+        std::vector<DebugVertex> lines; // Pairs
+        std::vector<double> lineExpiry; // One per pair
+        std::array<std::vector<DebugInstance>, static_cast<size_t>(DebugShape::Count)> instances;
+        std::array<std::vector<double>, static_cast<size_t>(DebugShape::Count)> instanceExpiry;
+    };
+
+    static double getExpiry(float duration);
+    void buildShapes();
+
+    ShaderProgram m_lineShader;
+    ShaderProgram m_shapeShader;
+    Uniform<glm::mat4> m_lineViewProjection;
+    Uniform<glm::mat4> m_shapeViewProjection;
+
+    GLuint m_lineVao = 0; // Vertex buffer is the frame's ring buffer allocation
+    GLuint m_shapeVao = 0;
+    GLuint m_shapeBuffer = 0;
+    std::array<ShapeRange, static_cast<size_t>(DebugShape::Count)> m_shapeRanges;
+
+    std::array<ModeBatch, static_cast<size_t>(DebugMode::Count)> m_batches;
 };
 
 class Renderer 
@@ -140,20 +254,130 @@ public:
     void cleanup();
     void render(std::pair<uint32_t, uint32_t> framebufferSize, Scene& scene);
     void toggleDebug(bool enabled) { m_debugEnabled = enabled; };
+    void toggleDepthPrepass(bool enabled) { m_depthPrepass = enabled; }
+    void toggleOcclusionCulling(bool enabled) { m_occlusionCulling = enabled; }
+    void toggleGpuCulling(bool enabled) { m_gpuCulling = enabled && m_gpuCullingSupported; }
+    bool isDepthPrepassEnabled() const { return m_depthPrepass; }
+    bool isOcclusionCullingEnabled() const { return m_occlusionCulling; }
+    bool isGpuCullingEnabled() const { return m_gpuCulling; }
+    bool isGpuCullingSupported() const { return m_gpuCullingSupported; }
     FrameBuffer getFrameBuffer() const { return m_frameBuffer; };
+    const RenderStats& getStats() const { return m_stats; };
+    const glm::mat4& getViewProjection() const { return m_viewProjection; };
+
+    // Subscribes to the scene's mesh renderer, transform and light signals. Draw and
+    // light data then live in persistent GPU buffers updated only for changed entities.
+    void attachScene(Scene& scene);
+    void detachScene();
+
+    // GPU copies of resources the resource manager dropped are freed on the next
+    // scene update, connected to ResourceManager::onCollected
+    void requestEviction() { m_resourcesReleased = true; }
     
 private:
+    // Per-draw data read by the standard shaders (std430, binding 1)
+    struct DrawData
+    {
+        glm::mat4 modelMatrix;
+        glm::mat4 normalMatrix; // World space, upper 3x3 used
+        glm::vec4 ambientShininess; // XYZ = ambient, W = shininess
+        glm::vec4 specularOpacity; // XYZ = specular strength, W = opacity
+    };
+
+    // Matches DrawElementsIndirectCommand of glMultiDrawElementsIndirect
+    struct DrawCommand
+    {
+        uint32_t count;
+        uint32_t instanceCount;
+        uint32_t firstIndex;
+        int32_t baseVertex;
+        uint32_t baseInstance;
+    };
+
+    // Draw commands sharing a texture set, submitted as one multi-draw
+    struct DrawBatch
+    {
+        uint32_t firstCommand;
+        uint32_t commandCount;
+        GLuint albedo, normal, specular;
+    };
+
+    // Matches CullObject of the occlusion compute shader (std430)
+    struct CullObject
+    {
+        glm::vec4 sphere; // World space center and radius
+        uint32_t slot;
+        uint32_t command;
+        uint32_t padding[2];
+    };
+
+    // Commands and instance slots drawn by one occlusion phase, or by the whole frame
+    // without occlusion culling
+    struct DrawPhase
+    {
+        RingAllocation commands;
+        RingAllocation instances;
+    };
+
+    // Matches CullData of the GPU culling shader (std430, binding 2)
+    struct CullData
+    {
+        glm::vec4 sphere; // Mesh space center and radius
+        uint32_t group;   // NO_DRAW_GROUP when the slot isn't drawn by the GPU path
+        uint32_t padding[3];
+    };
+
+    // Matches DrawGroup of the GPU culling shader (std430, binding 3). Draw slots sharing
+    // a mesh and texture set, their visible instances become one command.
+    struct DrawGroup
+    {
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t baseVertex;
+        uint32_t firstInstance;
+        uint32_t batch;
+        uint32_t firstCommand; // The batch's
+        uint32_t padding[2];
+    };
+
+    // GPU only buffer grown by reallocating, contents are lost when it grows
+    struct StorageBuffer
+    {
+        GLuint id = 0;
+        size_t capacity = 0;
+    };
+
+    // Resolved GL state for one mesh renderer, refreshed when the component changes
+    struct DrawRecord
+    {
+        MeshBuffer mesh;
+        GLuint albedo = 0, normal = 0, specular = 0;
+        std::shared_ptr<Material> material;
+        BoundingSphere bounds; // Mesh space
+        uint16_t materialKey = 0, meshKey = 0;
+        bool castShadows = false;
+        bool active = false; // Not parked (Inactive)
+        bool placed = false; // Has a transform, its draw data is valid
+    };
+
+    // Matches the Light struct of LightsUBO (std140, binding 0)
+    struct LightData
+    {
+        glm::vec4 position;
+        glm::vec4 direction;
+        glm::vec4 color;
+        glm::vec4 power_type; // X = power, Y = type
+    };
+
     Texture createTexture(const Image& image);
     void deleteTexture(Texture& texture);
 
-    MeshBuffer createMeshBuffer(const MeshData& meshData);
-    void deleteMeshBuffer(MeshBuffer& meshBuffer);
-
     FrameBuffer createFrameBuffer(int width, int height, FrameBufferType type);
     void deleteFrameBuffer(FrameBuffer& frameBuffer);
 
-    GLuint compileShader(std::string source, GLenum type);
-    GLuint linkProgram(GLuint vertexShader, GLuint fragmentShader);
+    // Reads and compiles a shader file, 0 (and the log on cerr) on failure
+    GLuint compileShader(const std::string& path, GLenum type);
+    GLuint linkProgram(std::initializer_list<GLuint> shaders);
     void deleteShader(GLuint& shader);
 
     GLuint createUniformBuffer(const void* data, size_t size);
@@ -170,19 +394,186 @@ private:
         const void* userParam
     );
 #endif
-    void allocateResources(entt::registry& registry);
-    void updateLightsUB(entt::registry& registry);
-    
-    bool m_debugEnabled = false;
+    // Signal handlers may run on worker threads (patches), they only queue entities
+    void onMeshRendererChanged(entt::registry& registry, entt::entity entity);
+    void onMeshRendererDestroyed(entt::registry& registry, entt::entity entity);
+    void onPrefabInstanceDestroyed(entt::registry& registry, entt::entity entity);
+    void releaseDrawRecord(entt::entity entity);
+    void onTransformChanged(entt::registry& registry, entt::entity entity);
+    void onLightConstructed(entt::registry& registry, entt::entity entity);
+    void onLightChanged(entt::registry& registry, entt::entity entity);
+    void onActivationChanged(entt::registry& registry, entt::entity entity);
+    void onLightDestroyed(entt::registry& registry, entt::entity entity);
+    void onStaticChanged(entt::registry& registry, entt::entity entity);
+
+    void processSceneChanges(entt::registry& registry);
+    void updateDrawRecord(entt::registry& registry, entt::entity entity);
+    size_t getPendingUploadSize(const MeshRendererComponent& mesh) const;
+    void updateDrawData(entt::registry& registry, entt::entity entity);
+    void updateLightData(entt::registry& registry, uint32_t slot);
+    void uploadDrawData();
+    void uploadDrawPhases();
+    void buildDrawCommands();
+    void buildHiZ(const glm::mat4& viewProjection);
+    void cullOcclusion(uint32_t phase);
+    void drawDepthPhase(const DrawPhase& phase);
+    void drawShadedPhase(const DrawPhase& phase, size_t firstBatch, size_t lastBatch);
+    void buildDrawGroups();
+    void cullOnGpu(uint32_t phase, const glm::mat4& viewProjection);
+    void drawGpuPhase(uint32_t phase, bool shaded);
+    void readOcclusionCounters();
+    void renderShadows(Scene& scene, const glm::mat4& view, float fov, float aspect, float nearClip, float farClip);
+    void renderPointShadows(Scene& scene, const glm::vec3& cameraPosition, float fov, const glm::mat4& viewProjection);
+    uint32_t drawDepthOnly(std::vector<uint32_t>& slots);
+    void uploadLightData();
+    void evictUnusedResources();
 
-    GLuint m_lightsUBO;
-    uint32_t m_activeLights;
+    bool m_debugEnabled = false;
+    bool m_depthPrepass = true;
+    bool m_occlusionCulling = true;
+    bool m_gpuCulling = false;
+    bool m_gpuCullingSupported = false; // GL 4.6 or ARB_indirect_parameters
+    RenderStats m_stats;
+    glm::mat4 m_viewProjection = glm::mat4(1.0f);
+
+    // Per-frame culling scratch, kept to avoid reallocations
+    FrustumCuller m_culler;
+    std::vector<entt::entity> m_cullEntities;
+    std::vector<entt::entity> m_visibleEntities;
+    std::vector<uint32_t> m_visibleIndices;
+
+    Scene* m_scene = nullptr;
+
+    // Entities changed since the last frame
+    std::mutex m_changeMutex;
+    std::vector<entt::entity> m_changedMeshRenderers;
+    std::vector<entt::entity> m_changedTransforms;
+    std::vector<entt::entity> m_changedLights;
+    std::vector<entt::entity> m_changedActivations;
+
+    // Main thread: mesh renderer changes waiting for the upload budget, oldest first
+    std::deque<entt::entity> m_pendingMeshRenderers;
+
+    // Persistent draw data, one slot per mesh renderer
+    std::unordered_map<entt::entity, uint32_t> m_drawSlots;
+    std::vector<DrawRecord> m_drawRecords;
+    std::vector<DrawData> m_drawData; // CPU copy of m_drawBuffer
+    std::vector<uint32_t> m_freeDrawSlots;
+    std::vector<uint32_t> m_dirtyDrawSlots;
+    GLuint m_drawBuffer = 0;
+    uint32_t m_drawCapacity = 0;
+
+    // Lights, instance draw slots, indirect commands and debug vertices are rewritten
+    // every frame straight into mapped memory
+    RingBuffer m_frameData;
+    GLint m_uniformAlignment = 256;
+    GLint m_storageAlignment = 256;
+
+    // Indirect commands for the current frame, grouped into batches by texture set
+    std::vector<DrawCommand> m_drawCommands;
+    std::vector<DrawBatch> m_drawBatches;
+    uint32_t m_opaqueCommands = 0, m_opaqueBatches = 0; // Opaque draws come first
+    std::array<DrawPhase, 2> m_drawPhases;
+    uint32_t m_phaseCount = 1;
+
+    // Occlusion culling, bounds of the queued draws are tested on the GPU against the
+    // Hi-Z pyramid before each phase is drawn
+    HiZPyramid m_hiZ;
+    ShaderProgram m_hiZProgram;
+    Uniform<int> m_hiZSource, m_hiZSourceLevel;
+    ShaderProgram m_occlusionProgram;
+    struct OcclusionUniforms
+    {
+        Uniform<int> objectCount, phase, pyramidValid, counterSlot, hiZ;
+        Uniform<glm::mat4> viewProjection;
+        Uniform<glm::vec2> depthSize;
+    } m_occlusionUniforms;
+    std::vector<BoundingSphere> m_drawSpheres; // By draw slot, for this frame's queued draws
+    RingAllocation m_cullObjects, m_earlyVisibility;
+    uint32_t m_cullObjectCount = 0;
+
+    // Visible counts written by the occlusion shader, one slot per frame in flight
+    GLuint m_occlusionCounters = 0;
+    const glm::uvec4* m_occlusionCounterData = nullptr;
+    uint32_t m_occlusionFrame = 0;
+
+    // GPU driven culling. Opaque draw slots are grouped by texture set and mesh only
+    // when the set of drawn objects changes; every frame the culling shader tests all
+    // of them and writes the indirect commands, so the CPU cost of a frame doesn't
+    // depend on the number of objects. Transparent draws still go through the queue.
+    ShaderProgram m_gpuCullProgram;
+    struct GpuCullUniforms
+    {
+        Uniform<int> stage, phase, objectCount, groupCount, batchCount, instanceCount;
+        Uniform<int> testOcclusion, counterSlot, hiZ;
+        Uniform<glm::mat4> viewProjection, hiZViewProjection;
+        Uniform<glm::vec2> depthSize;
+    } m_gpuCullUniforms;
+    bool m_drawGroupsDirty = true;
+    std::vector<CullData> m_cullData; // By draw slot
+    std::vector<DrawGroup> m_drawGroups;
+    std::vector<DrawBatch> m_groupBatches; // Commands are indices into a phase's run of groups
+    std::vector<uint32_t> m_groupSlots;
+    std::vector<entt::entity> m_transparentEntities;
+    uint32_t m_groupInstanceCount = 0; // Opaque draw slots with a group
+    StorageBuffer m_cullBuffer, m_drawGroupBuffer, m_groupCommands, m_groupInstances, m_groupCounts, m_groupVisibility;
+
+    // Vertices and indices of every cached mesh
+    GeometryArena m_geometry;
+
+    // Lights packed at the front of the UBO, those past MAX_LIGHTS wait for a free slot
+    std::vector<entt::entity> m_lightEntities;
+    std::vector<LightData> m_lightData;
+    std::vector<uint32_t> m_dirtyLightSlots;
+
+    uint32_t m_activeLights = 0;
 
     ShaderProgram m_standardProgram;
+    static constexpr uint8_t STANDARD_PROGRAM_KEY = 0;
+
+    // Positions only, for shadow maps and the depth pre-pass
+    ShaderProgram m_depthProgram;
+    Uniform<glm::mat4> m_depthViewProjection;
+
+    // Directional light shadows, casters are culled per cascade into these lists
+    CascadedShadowMap m_shadowMap;
+    std::vector<uint32_t> m_staticCasters;
+    std::vector<uint32_t> m_dynamicCasters;
+    std::vector<DrawCommand> m_depthCommands;
+
+    // Point light shadows, refreshed a budget of cube faces at a time
+    PointShadowAtlas m_pointShadows;
+    std::vector<PointShadowLight> m_pointShadowLights;
+    std::vector<uint32_t> m_pointCasters;
+
+    RenderQueue m_renderQueue;
+    StateTracker m_stateTracker;
+
+    // Resolved after linking, no name lookups while drawing
+    struct StandardUniforms
+    {
+        Uniform<glm::mat4> viewMatrix, viewProjection;
+        Uniform<int> activeLights;
+        Uniform<int> textureAlbedo, textureNormal, textureSpecular, textureShadow, texturePointShadow;
+    } m_standardUniforms;
     Texture m_defaultAlbedo,  m_defaultNormalMap, m_defaultSpecularMap;
     
-    std::map<UUID, MeshBuffer> m_meshCache;
-    std::map<UUID, Texture> m_textureCache;
+    // GPU resources by CPU resource id, evicted once the source resource is gone
+    struct CachedMesh
+    {
+        MeshBuffer buffer;
+        std::weak_ptr<const MeshData> source;
+    };
+
+    struct CachedTexture
+    {
+        Texture texture;
+        std::weak_ptr<const Image> source;
+    };
+
+    std::map<UUID, CachedMesh> m_meshCache;
+    std::map<UUID, CachedTexture> m_textureCache;
+    bool m_resourcesReleased = false; // A draw record or collectUnused dropped resources since the last eviction
 
     FrameBuffer m_frameBuffer;
     DebugRenderer m_debugRenderer;
@@ -1,13 +1,24 @@
 #include "opengl.h"
+
+#include <cmath>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
 #include "core/assert.h"
 
-namespace OpenGL 
+namespace OpenGL
 {
 
-bool DebugRenderer::initialize() 
+const uint32_t SPHERE_SEGMENTS = 16; // Around each circle
+const uint32_t SPHERE_RINGS = 8;     // Pole to pole
+const uint32_t CONE_SEGMENTS = 16;
+
+const size_t MODE_COUNT = static_cast<size_t>(DebugMode::Count);
+const size_t SHAPE_COUNT = static_cast<size_t>(DebugShape::Count);
+
+static GLuint buildProgram(const std::string& vertexSource, const std::string& fragmentSource)
 {
     GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-    const char* vsCStr = DEBUG_VERTEX_SHADER.c_str();
+    const char* vsCStr = vertexSource.c_str();
     glShaderSource(vs, 1, &vsCStr, nullptr);
     glCompileShader(vs);
 
@@ -16,164 +27,361 @@ bool DebugRenderer::initialize()
     ASSERT(success, "Debug Vertex shader compilation failed");
 
     GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    const char* fsCStr = DEBUG_FRAGMENT_SHADER.c_str();
+    const char* fsCStr = fragmentSource.c_str();
     glShaderSource(fs, 1, &fsCStr, nullptr);
     glCompileShader(fs);
 
     glGetShaderiv(fs, GL_COMPILE_STATUS, &success);
     ASSERT(success, "Debug Fragment shader compilation failed");
 
-    m_debugShader.id = glCreateProgram();
-    glAttachShader(m_debugShader.id, vs);
-    glAttachShader(m_debugShader.id, fs);
-    glLinkProgram(m_debugShader.id);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
 
-    glDetachShader(m_debugShader.id, vs);
-    glDetachShader(m_debugShader.id, fs);
+    glDetachShader(program, vs);
+    glDetachShader(program, fs);
     glDeleteShader(vs);
     glDeleteShader(fs);
 
-    glGetProgramiv(m_debugShader.id, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
     ASSERT(success, "Debug Shader program linking failed");
 
-    return true;
+    return program;
 }
 
-void DebugRenderer::cleanup() 
+bool DebugRenderer::initialize()
 {
-    if (m_debugShader.id) 
+    m_lineShader.id = buildProgram(DEBUG_VERTEX_SHADER, DEBUG_FRAGMENT_SHADER);
+    m_lineShader.reflect();
+    m_lineViewProjection = m_lineShader.getUniform<glm::mat4>("uViewProjection");
+
+    m_shapeShader.id = buildProgram(DEBUG_SHAPE_VERTEX_SHADER, DEBUG_FRAGMENT_SHADER);
+    m_shapeShader.reflect();
+    m_shapeViewProjection = m_shapeShader.getUniform<glm::mat4>("uViewProjection");
+
+    // Lines: position and color per vertex
+    glCreateVertexArrays(1, &m_lineVao);
+
+    glVertexArrayAttribFormat(m_lineVao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(DebugVertex, position));
+    glVertexArrayAttribBinding(m_lineVao, 0, 0);
+    glEnableVertexArrayAttrib(m_lineVao, 0);
+
+    glVertexArrayAttribFormat(m_lineVao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(DebugVertex, color));
+    glVertexArrayAttribBinding(m_lineVao, 1, 0);
+    glEnableVertexArrayAttrib(m_lineVao, 1);
+
+    // Shapes: unit primitive positions on binding 0, color and transform per instance on binding 1
+    buildShapes();
+    glCreateVertexArrays(1, &m_shapeVao);
+    glVertexArrayVertexBuffer(m_shapeVao, 0, m_shapeBuffer, 0, sizeof(glm::vec3));
+
+    glVertexArrayAttribFormat(m_shapeVao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(m_shapeVao, 0, 0);
+    glEnableVertexArrayAttrib(m_shapeVao, 0);
+
+    glVertexArrayAttribFormat(m_shapeVao, 1, 4, GL_FLOAT, GL_FALSE, offsetof(DebugInstance, color));
+    glVertexArrayAttribBinding(m_shapeVao, 1, 1);
+    glEnableVertexArrayAttrib(m_shapeVao, 1);
+
+    for (GLuint column = 0; column < 4; column++)
     {
-        glDeleteProgram(m_debugShader.id);
-        m_debugShader.id = 0;
+        const GLuint offset = static_cast<GLuint>(offsetof(DebugInstance, transform) + sizeof(glm::vec4) * column);
+        glVertexArrayAttribFormat(m_shapeVao, 2 + column, 4, GL_FLOAT, GL_FALSE, offset);
+        glVertexArrayAttribBinding(m_shapeVao, 2 + column, 1);
+        glEnableVertexArrayAttrib(m_shapeVao, 2 + column);
     }
-    m_vertices.clear();
-}
+    glVertexArrayBindingDivisor(m_shapeVao, 1, 1);
 
-void DebugRenderer::startFrame() 
-{
-    m_vertices.clear();
+    return true;
 }
 
-void DebugRenderer::addLine(const glm::vec3& start, const glm::vec3& end, const glm::vec3& color) 
+void DebugRenderer::cleanup()
 {
-    m_vertices.push_back({start, color});
-    m_vertices.push_back({end, color});
+    for (ShaderProgram* shader : { &m_lineShader, &m_shapeShader })
+    {
+        if (shader->id)
+        {
+            glDeleteProgram(shader->id);
+            shader->id = 0;
+        }
+    }
+
+    glDeleteVertexArrays(1, &m_lineVao);
+    glDeleteVertexArrays(1, &m_shapeVao);
+    glDeleteBuffers(1, &m_shapeBuffer);
+    m_lineVao = m_shapeVao = m_shapeBuffer = 0;
+
+    m_batches = {};
 }
 
-void DebugRenderer::addCube(const glm::vec3& position, const glm::vec3& size, const glm::vec3& color) 
+void DebugRenderer::buildShapes()
 {
-    glm::vec3 halfSize = size * 0.5f;
-    glm::vec3 corners[8] = 
+    std::vector<glm::vec3> vertices;
+    auto beginShape = [&](DebugShape shape)
     {
-        position + glm::vec3(-halfSize.x, -halfSize.y, -halfSize.z),
-        position + glm::vec3( halfSize.x, -halfSize.y, -halfSize.z),
-        position + glm::vec3( halfSize.x,  halfSize.y, -halfSize.z),
-        position + glm::vec3(-halfSize.x,  halfSize.y, -halfSize.z),
-        position + glm::vec3(-halfSize.x, -halfSize.y,  halfSize.z),
-        position + glm::vec3( halfSize.x, -halfSize.y,  halfSize.z),
-        position + glm::vec3( halfSize.x,  halfSize.y,  halfSize.z),
-        position + glm::vec3(-halfSize.x,  halfSize.y,  halfSize.z)
+        m_shapeRanges[static_cast<size_t>(shape)].first = static_cast<uint32_t>(vertices.size());
     };
-
-    const int edges[12][2] = 
+    auto endShape = [&](DebugShape shape)
     {
-        {0,1}, {1,2}, {2,3}, {3,0}, // Front
-        {4,5}, {5,6}, {6,7}, {7,4}, // Back
-        {0,4}, {1,5}, {2,6}, {3,7}  // Connections
+        ShapeRange& range = m_shapeRanges[static_cast<size_t>(shape)];
+        range.count = static_cast<uint32_t>(vertices.size()) - range.first;
     };
 
-    for (const auto& edge : edges) 
+    const float pi = glm::pi<float>();
+
+    beginShape(DebugShape::Cube);
     {
-        addLine(corners[edge[0]], corners[edge[1]], color);
+        const glm::vec3 corners[8] =
+        {
+            {-1, -1, -1}, { 1, -1, -1}, { 1,  1, -1}, {-1,  1, -1},
+            {-1, -1,  1}, { 1, -1,  1}, { 1,  1,  1}, {-1,  1,  1}
+        };
+
+        const int edges[12][2] =
+        {
+            {0,1}, {1,2}, {2,3}, {3,0}, // Front
+            {4,5}, {5,6}, {6,7}, {7,4}, // Back
+            {0,4}, {1,5}, {2,6}, {3,7}  // Connections
+        };
+
+        for (const auto& edge : edges)
+        {
+            vertices.push_back(corners[edge[0]]);
+            vertices.push_back(corners[edge[1]]);
+        }
     }
-}
+    endShape(DebugShape::Cube);
 
-void DebugRenderer::addSphere(const glm::vec3& center, float radius, const glm::vec3& color, int segments) 
-{
-    const float pi = glm::pi<float>();
-    const float angleStep = 2.0f * pi / segments;
+    beginShape(DebugShape::Sphere);
+    {
+        auto point = [](float theta, float phi)
+        {
+            return glm::vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+        };
+        const float thetaStep = pi / SPHERE_RINGS;
+        const float phiStep = 2.0f * pi / SPHERE_SEGMENTS;
+
+        // Latitude circles, the poles are single points
+        for (uint32_t ring = 1; ring < SPHERE_RINGS; ring++)
+        {
+            for (uint32_t segment = 0; segment < SPHERE_SEGMENTS; segment++)
+            {
+                vertices.push_back(point(ring * thetaStep, segment * phiStep));
+                vertices.push_back(point(ring * thetaStep, (segment + 1) * phiStep));
+            }
+        }
 
-    // Proper spherical coordinates parameterization
-    for (int i = 0; i < segments; ++i) 
+        // Longitude arcs from pole to pole
+        for (uint32_t segment = 0; segment < SPHERE_SEGMENTS; segment++)
+        {
+            for (uint32_t ring = 0; ring < SPHERE_RINGS; ring++)
+            {
+                vertices.push_back(point(ring * thetaStep, segment * phiStep));
+                vertices.push_back(point((ring + 1) * thetaStep, segment * phiStep));
+            }
+        }
+    }
+    endShape(DebugShape::Sphere);
+
+    beginShape(DebugShape::Cone);
     {
-        float theta = i * angleStep;
-        float nextTheta = (i + 1) * angleStep;
-        
-        // Longitude lines (vertical circles)
-        for (int j = 0; j < segments; ++j) 
+        const float step = 2.0f * pi / CONE_SEGMENTS;
+        for (uint32_t segment = 0; segment < CONE_SEGMENTS; segment++)
         {
-            float phi = j * angleStep;
-            
-            glm::vec3 p1 = center + radius * glm::vec3(
-                sin(theta) * cos(phi),
-                cos(theta),
-                sin(theta) * sin(phi)
-            );
-            
-            glm::vec3 p2 = center + radius * glm::vec3(
-                sin(nextTheta) * cos(phi),
-                cos(nextTheta),
-                sin(nextTheta) * sin(phi)
-            );
-            
-            addLine(p1, p2, color);
+            vertices.push_back(glm::vec3(cos(segment * step), sin(segment * step), 1.0f));
+            vertices.push_back(glm::vec3(cos((segment + 1) * step), sin((segment + 1) * step), 1.0f));
         }
 
-        // Latitude lines (horizontal circles)
-        for (int j = 0; j < segments; ++j) 
+        // Four sides from the apex
+        for (uint32_t side = 0; side < 4; side++)
         {
-            float phi = j * angleStep;
-            
-            glm::vec3 p1 = center + radius * glm::vec3(
-                sin(phi) * cos(theta),
-                cos(phi),
-                sin(phi) * sin(theta)
-            );
-            
-            glm::vec3 p2 = center + radius * glm::vec3(
-                sin(phi) * cos(nextTheta),
-                cos(phi),
-                sin(phi) * sin(nextTheta)
-            );
-            
-            addLine(p1, p2, color);
+            const float angle = side * 0.5f * pi;
+            vertices.push_back(glm::vec3(0.0f));
+            vertices.push_back(glm::vec3(cos(angle), sin(angle), 1.0f));
         }
     }
+    endShape(DebugShape::Cone);
+
+    glCreateBuffers(1, &m_shapeBuffer);
+    glNamedBufferStorage(m_shapeBuffer, sizeof(glm::vec3) * vertices.size(), vertices.data(), 0);
 }
 
-void DebugRenderer::endFrame(const glm::mat4& viewProjection) 
+double DebugRenderer::getExpiry(float duration)
 {
-    if (m_vertices.empty()) return;
+    return duration > 0.0f ? glfwGetTime() + duration : 0.0;
+}
 
-    GLuint vao, vbo;
-    glCreateVertexArrays(1, &vao);
-    glCreateBuffers(1, &vbo);
+void DebugRenderer::addLine(const glm::vec3& start, const glm::vec3& end, const glm::vec3& color, DebugMode mode, float duration)
+{
+    ModeBatch& batch = m_batches[static_cast<size_t>(mode)];
+    batch.lines.push_back({start, color});
+    batch.lines.push_back({end, color});
+    batch.lineExpiry.push_back(getExpiry(duration));
+}
 
-    glNamedBufferStorage(vbo, m_vertices.size() * sizeof(DebugVertex), m_vertices.data(), GL_DYNAMIC_STORAGE_BIT);
+void DebugRenderer::addShape(DebugShape shape, const glm::mat4& transform, const glm::vec3& color, DebugMode mode, float duration)
+{
+    ModeBatch& batch = m_batches[static_cast<size_t>(mode)];
+    batch.instances[static_cast<size_t>(shape)].push_back({ glm::vec4(color, 1.0f), transform });
+    batch.instanceExpiry[static_cast<size_t>(shape)].push_back(getExpiry(duration));
+}
 
-    glVertexArrayVertexBuffer(vao, 0, vbo, 0, sizeof(DebugVertex));
+void DebugRenderer::addCube(const glm::vec3& position, const glm::vec3& size, const glm::vec3& color, DebugMode mode, float duration)
+{
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+    transform = glm::scale(transform, size * 0.5f);
+    addShape(DebugShape::Cube, transform, color, mode, duration);
+}
 
-    // Position attribute (location 0)
-    glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(DebugVertex, position));
-    glVertexArrayAttribBinding(vao, 0, 0);
-    glEnableVertexArrayAttrib(vao, 0);
+void DebugRenderer::addAABB(const AABB& aabb, const glm::vec3& color, DebugMode mode, float duration)
+{
+    addCube(aabb.center(), aabb.extents() * 2.0f, color, mode, duration);
+}
 
-    // Color attribute (location 1)
-    glVertexArrayAttribFormat(vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(DebugVertex, color));
-    glVertexArrayAttribBinding(vao, 1, 0);
-    glEnableVertexArrayAttrib(vao, 1);
+void DebugRenderer::addSphere(const glm::vec3& center, float radius, const glm::vec3& color, DebugMode mode, float duration)
+{
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), center);
+    transform = glm::scale(transform, glm::vec3(radius));
+    addShape(DebugShape::Sphere, transform, color, mode, duration);
+}
 
-    glUseProgram(m_debugShader.id);
-    m_debugShader.setMat4("uViewProjection", viewProjection);
+void DebugRenderer::addCone(const glm::vec3& apex, const glm::vec3& direction, float length, float radius, const glm::vec3& color, DebugMode mode, float duration)
+{
+    // Any basis around the axis will do, the cone is symmetric
+    const glm::vec3 axis = glm::normalize(direction);
+    const glm::vec3 reference = std::abs(axis.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    const glm::vec3 right = glm::normalize(glm::cross(reference, axis));
+    const glm::vec3 up = glm::cross(axis, right);
+
+    const glm::mat4 transform(
+        glm::vec4(right * radius, 0.0f),
+        glm::vec4(up * radius, 0.0f),
+        glm::vec4(axis * length, 0.0f),
+        glm::vec4(apex, 1.0f)
+    );
+    addShape(DebugShape::Cone, transform, color, mode, duration);
+}
 
-    glBindVertexArray(vao);
-    glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(m_vertices.size()));
+void DebugRenderer::addFrustum(const glm::mat4& viewProjection, const glm::vec3& color, DebugMode mode, float duration)
+{
+    // The unit cube is the clip space volume, the shader divides by w
+    addShape(DebugShape::Cube, glm::inverse(viewProjection), color, mode, duration);
+}
+
+void DebugRenderer::render(const glm::mat4& viewProjection, glm::vec2 screenSize, RingBuffer& frameData)
+{
+    size_t lineVertices = 0;
+    size_t instances = 0;
+    for (const ModeBatch& batch : m_batches)
+    {
+        lineVertices += batch.lines.size();
+        for (const auto& shapeInstances : batch.instances) instances += shapeInstances.size();
+    }
+    if (lineVertices == 0 && instances == 0) return;
+
+    // Everything is copied into the frame's ring buffer region, grouped by mode
+    RingAllocation lineAllocation, instanceAllocation, commandAllocation;
+    if (lineVertices > 0)
+    {
+        lineAllocation = frameData.allocate(sizeof(DebugVertex) * lineVertices, sizeof(float));
+        glVertexArrayVertexBuffer(m_lineVao, 0, lineAllocation.buffer, lineAllocation.offset, sizeof(DebugVertex));
+    }
+    if (instances > 0)
+    {
+        instanceAllocation = frameData.allocate(sizeof(DebugInstance) * instances, sizeof(float));
+        commandAllocation = frameData.allocate(sizeof(ShapeCommand) * MODE_COUNT * SHAPE_COUNT, sizeof(uint32_t));
+        glVertexArrayVertexBuffer(m_shapeVao, 1, instanceAllocation.buffer, instanceAllocation.offset, sizeof(DebugInstance));
+    }
+
+    auto* lineData = static_cast<DebugVertex*>(lineAllocation.data);
+    auto* instanceData = static_cast<DebugInstance*>(instanceAllocation.data);
+    auto* commandData = static_cast<ShapeCommand*>(commandAllocation.data);
+
+    const glm::mat4 screenProjection = glm::ortho(0.0f, screenSize.x, screenSize.y, 0.0f, -1.0f, 1.0f);
+    uint32_t lineCount = 0, instanceCount = 0, commandCount = 0;
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandAllocation.buffer);
+    for (size_t mode = 0; mode < MODE_COUNT; mode++)
+    {
+        const ModeBatch& batch = m_batches[mode];
+        const glm::mat4& projection = static_cast<DebugMode>(mode) == DebugMode::Screen ? screenProjection : viewProjection;
+
+        if (static_cast<DebugMode>(mode) == DebugMode::DepthTested) glEnable(GL_DEPTH_TEST);
+        else glDisable(GL_DEPTH_TEST);
+
+        // One indirect command per shape type, instances of a type are contiguous
+        const uint32_t firstCommand = commandCount;
+        for (size_t shape = 0; shape < SHAPE_COUNT; shape++)
+        {
+            const auto& shapeInstances = batch.instances[shape];
+            if (shapeInstances.empty()) continue;
+
+            std::copy(shapeInstances.begin(), shapeInstances.end(), instanceData + instanceCount);
+            commandData[commandCount++] = {
+                m_shapeRanges[shape].count,
+                static_cast<uint32_t>(shapeInstances.size()),
+                m_shapeRanges[shape].first,
+                instanceCount
+            };
+            instanceCount += static_cast<uint32_t>(shapeInstances.size());
+        }
+
+        if (commandCount > firstCommand)
+        {
+            glUseProgram(m_shapeShader.id);
+            m_shapeShader.set(m_shapeViewProjection, projection);
+            glBindVertexArray(m_shapeVao);
+
+            const GLintptr offset = commandAllocation.offset + static_cast<GLintptr>(sizeof(ShapeCommand) * firstCommand);
+            glMultiDrawArraysIndirect(GL_LINES, reinterpret_cast<const void*>(offset), static_cast<GLsizei>(commandCount - firstCommand), 0);
+        }
+
+        if (!batch.lines.empty())
+        {
+            std::copy(batch.lines.begin(), batch.lines.end(), lineData + lineCount);
+
+            glUseProgram(m_lineShader.id);
+            m_lineShader.set(m_lineViewProjection, projection);
+            glBindVertexArray(m_lineVao);
+            glDrawArrays(GL_LINES, static_cast<GLint>(lineCount), static_cast<GLsizei>(batch.lines.size()));
+            lineCount += static_cast<uint32_t>(batch.lines.size());
+        }
+    }
+
+    glEnable(GL_DEPTH_TEST);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
     glBindVertexArray(0);
+}
+
+void DebugRenderer::endFrame()
+{
+    const double now = glfwGetTime();
+
+    // Keeps the elements whose expiry lies ahead, stride elements per expiry entry
+    auto retain = [now](auto& elements, std::vector<double>& expiry, size_t stride)
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < expiry.size(); i++)
+        {
+            if (expiry[i] <= now) continue;
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
+            expiry[kept] = expiry[i];
+            for (size_t j = 0; j < stride; j++) elements[kept * stride + j] = elements[i * stride + j];
+            kept++;
+        }
+        expiry.resize(kept);
+        elements.resize(kept * stride);
+    };
 
-    m_vertices.clear();
+    for (ModeBatch& batch : m_batches)
+    {
+        retain(batch.lines, batch.lineExpiry, 2);
+        for (size_t shape = 0; shape < SHAPE_COUNT; shape++)
+        {
+            retain(batch.instances[shape], batch.instanceExpiry[shape], 1);
+        }
+    }
 }
 
-} // namespace OpenGL
\ No newline at end of file
+} // namespace OpenGL
@@ -0,0 +1,384 @@
+#include "point_shadow_atlas.h"
+
+#include <cmath>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace OpenGL
+{
+
+// Face tiles range from a quarter of the atlas down to 1/32 of it
+const uint32_t LARGEST_FACE_LEVEL = 2;
+const uint32_t SMALLEST_FACE_LEVEL = 5;
+
+// Importance needed for each size, from the largest down
+const float LEVEL_IMPORTANCE[SMALLEST_FACE_LEVEL - LARGEST_FACE_LEVEL] = {0.5f, 0.25f, 0.1f};
+
+// A light keeps its tile size until its importance is this far past a threshold,
+// so lights near one don't lose their faces every frame
+const float LEVEL_HYSTERESIS = 1.25f;
+
+// Faces of a light that moved are refreshed before ones that only aged
+const float STALE_WEIGHT = 8.0f;
+
+const float POINT_SHADOW_NEAR = 0.05f;
+const float POINT_SHADOW_SLOPE_BIAS = 2.0f;
+const float POINT_SHADOW_CONSTANT_BIAS = 4.0f;
+
+// +X, -X, +Y, -Y, +Z, -Z, the standard fragment shader picks faces in this order
+const glm::vec3 FACE_DIRECTIONS[CUBE_FACES] = {
+    { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+    { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+    { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+};
+const glm::vec3 FACE_UPS[CUBE_FACES] = {
+    { 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+    { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+    { 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }
+};
+
+bool PointShadowAtlas::initialize(uint32_t size)
+{
+    m_size = size;
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_texture);
+    glTextureStorage2D(m_texture, 1, GL_DEPTH_COMPONENT32F, static_cast<GLsizei>(size), static_cast<GLsizei>(size));
+    glTextureParameteri(m_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_texture, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTextureParameteri(m_texture, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    // Unused tiles read as lit
+    const float clearDepth = 1.0f;
+    glClearTexImage(m_texture, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &clearDepth);
+
+    glCreateFramebuffers(1, &m_framebuffer);
+    glNamedFramebufferTexture(m_framebuffer, GL_DEPTH_ATTACHMENT, m_texture, 0);
+    glNamedFramebufferDrawBuffer(m_framebuffer, GL_NONE);
+    glNamedFramebufferReadBuffer(m_framebuffer, GL_NONE);
+
+    m_freeTiles.assign(SMALLEST_FACE_LEVEL + 1, {});
+    m_freeTiles[0].push_back(glm::uvec2(0));
+    m_lights.clear();
+    m_shadowed.clear();
+    m_pendingFaces.clear();
+    m_stats = {};
+    return m_texture && m_framebuffer;
+}
+
+void PointShadowAtlas::cleanup()
+{
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteTextures(1, &m_texture);
+    m_framebuffer = m_texture = 0;
+    m_freeTiles.clear();
+    m_lights.clear();
+    m_shadowed.clear();
+}
+
+void PointShadowAtlas::update(std::vector<PointShadowLight>& lights, const glm::vec3& cameraPosition, float fov, const Frustum& viewFrustum, uint32_t faceBudget)
+{
+    m_frame++;
+    m_stats = {};
+    m_pendingFaces.clear();
+
+    for (const PointShadowLight& light : lights)
+    {
+        LightState& state = m_lights[light.id];
+        if (state.position != light.position || state.radius != light.radius)
+        {
+            for (Face& face : state.faces) face.stale = true;
+        }
+
+        const AABB range = { light.position - glm::vec3(light.radius), light.position + glm::vec3(light.radius) };
+        state.slot = light.slot;
+        state.position = light.position;
+        state.radius = light.radius;
+        state.visible = BoundsUtils::testFrustum(viewFrustum, range) != FrustumTest::Outside;
+        state.importance = state.visible ? computeImportance(light.position, light.radius, cameraPosition, fov) : 0.0f;
+        state.seenFrame = m_frame;
+    }
+
+    for (auto it = m_lights.begin(); it != m_lights.end();)
+    {
+        if (it->second.seenFrame == m_frame)
+        {
+            ++it;
+            continue;
+        }
+        freeTiles(it->second);
+        it = m_lights.erase(it);
+    }
+
+    // Most important first, they get tiles before the atlas fills up
+    std::sort(lights.begin(), lights.end(), [&](const PointShadowLight& a, const PointShadowLight& b)
+    {
+        const float importanceA = m_lights[a.id].importance;
+        const float importanceB = m_lights[b.id].importance;
+        return importanceA != importanceB ? importanceA > importanceB : a.id < b.id;
+    });
+
+    // Tiles are released before any are handed out, so resized lights can reuse them
+    const size_t shadowCount = std::min<size_t>(lights.size(), MAX_POINT_SHADOWS);
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        LightState& state = m_lights[lights[i].id];
+        if (!state.hasTiles) continue;
+        if (i >= shadowCount || chooseLevel(state.importance, state) != state.tiles[0].level) freeTiles(state);
+    }
+
+    m_shadowed.clear();
+    for (size_t i = 0; i < shadowCount; i++)
+    {
+        LightState& state = m_lights[lights[i].id];
+        for (uint32_t level = chooseLevel(state.importance, state); !state.hasTiles && level <= SMALLEST_FACE_LEVEL; level++)
+        {
+            allocateTiles(state, level);
+        }
+        if (state.hasTiles) m_shadowed.push_back(lights[i].id);
+    }
+    m_stats.shadowedLights = static_cast<uint32_t>(m_shadowed.size());
+
+    // Faces never rendered come first, then faces of lights that changed, then the
+    // ones that have gone longest without a refresh, weighted by importance
+    struct Candidate
+    {
+        uint32_t urgency;
+        float priority;
+        LightState* state;
+        uint32_t face;
+    };
+    std::vector<Candidate> candidates;
+    for (uint32_t id : m_shadowed)
+    {
+        LightState& state = m_lights[id];
+        if (!state.visible) continue;
+
+        for (uint32_t i = 0; i < CUBE_FACES; i++)
+        {
+            const Face& face = state.faces[i];
+            const uint64_t age = face.valid ? m_frame - face.renderedFrame : 0;
+            if (face.valid) m_stats.oldestFace = std::max(m_stats.oldestFace, static_cast<uint32_t>(age));
+
+            const uint32_t urgency = !face.valid ? 2 : face.stale ? 1 : 0;
+            const float priority = face.valid ? state.importance * static_cast<float>(age) * (face.stale ? STALE_WEIGHT : 1.0f) : state.importance;
+            candidates.push_back({ urgency, priority, &state, i });
+        }
+    }
+
+    const size_t pickCount = std::min<size_t>(candidates.size(), faceBudget);
+    std::partial_sort(candidates.begin(), candidates.begin() + pickCount, candidates.end(), [](const Candidate& a, const Candidate& b)
+    {
+        return a.urgency != b.urgency ? a.urgency > b.urgency : a.priority > b.priority;
+    });
+
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        const Candidate& candidate = candidates[i];
+        if (i >= pickCount)
+        {
+            if (candidate.urgency > 0) m_stats.staleFaces++;
+            continue;
+        }
+
+        const Tile& tile = candidate.state->tiles[candidate.face];
+        const glm::mat4 viewProjection = faceViewProjection(*candidate.state, candidate.face);
+        const uint32_t size = tileSize(tile.level);
+
+        Face& face = candidate.state->faces[candidate.face];
+        face.viewProjection = atlasMatrix(tile) * viewProjection;
+        face.renderedFrame = m_frame;
+        face.valid = true;
+        face.stale = false;
+
+        m_pendingFaces.push_back({
+            viewProjection,
+            BoundsUtils::extractFrustum(viewProjection),
+            glm::uvec4(tile.origin, size, size)
+        });
+    }
+    m_stats.facesRendered = static_cast<uint32_t>(m_pendingFaces.size());
+}
+
+void PointShadowAtlas::beginPass()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glEnable(GL_SCISSOR_TEST);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(POINT_SHADOW_SLOPE_BIAS, POINT_SHADOW_CONSTANT_BIAS);
+}
+
+void PointShadowAtlas::beginFace(const PointShadowFace& face)
+{
+    // The scissor limits the clear to the face's tile
+    const GLint x = static_cast<GLint>(face.viewport.x);
+    const GLint y = static_cast<GLint>(face.viewport.y);
+    const GLsizei width = static_cast<GLsizei>(face.viewport.z);
+    const GLsizei height = static_cast<GLsizei>(face.viewport.w);
+    glViewport(x, y, width, height);
+    glScissor(x, y, width, height);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void PointShadowAtlas::endPass(uint32_t casters)
+{
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_SCISSOR_TEST);
+    m_stats.casters = casters;
+}
+
+PointShadowData PointShadowAtlas::getShaderData() const
+{
+    PointShadowData data;
+    uint32_t count = 0;
+    for (uint32_t id : m_shadowed)
+    {
+        const LightState& state = m_lights.at(id);
+        if (!std::all_of(state.faces.begin(), state.faces.end(), [](const Face& face) { return face.valid; })) continue;
+
+        for (uint32_t i = 0; i < CUBE_FACES; i++)
+        {
+            // Inset by half a texel so filtering never reads a neighbouring tile
+            const Tile& tile = state.tiles[i];
+            const glm::vec2 tileMin = glm::vec2(tile.origin) + 0.5f;
+            const glm::vec2 tileMax = glm::vec2(tile.origin + glm::uvec2(tileSize(tile.level))) - 0.5f;
+            data.matrices[count * CUBE_FACES + i] = state.faces[i].viewProjection;
+            data.rects[count * CUBE_FACES + i] = glm::vec4(tileMin, tileMax) / static_cast<float>(m_size);
+        }
+        data.lights[count] = glm::ivec4(static_cast<int32_t>(state.slot), 0, 0, 0);
+        count++;
+    }
+    data.params = glm::ivec4(static_cast<int32_t>(count), 0, 0, 0);
+    return data;
+}
+
+float PointShadowAtlas::computeImportance(const glm::vec3& position, float radius, const glm::vec3& cameraPosition, float fov)
+{
+    const float distance = glm::length(position - cameraPosition);
+    if (distance <= radius) return 1.0f;
+
+    // Projected radius of the range relative to half the screen height
+    return std::min(1.0f, radius / (distance * std::tan(fov * 0.5f)));
+}
+
+uint32_t PointShadowAtlas::chooseLevel(float importance, const LightState& state) const
+{
+    auto levelFor = [](float value)
+    {
+        uint32_t level = LARGEST_FACE_LEVEL;
+        for (float threshold : LEVEL_IMPORTANCE)
+        {
+            if (value >= threshold) break;
+            level++;
+        }
+        return level;
+    };
+
+    const uint32_t level = levelFor(importance);
+    if (!state.hasTiles || level == state.tiles[0].level) return level;
+
+    // Growing needs the importance to clear the threshold by the margin, shrinking
+    // needs it to fall below it by the margin
+    const uint32_t current = state.tiles[0].level;
+    const float margin = level < current ? 1.0f / LEVEL_HYSTERESIS : LEVEL_HYSTERESIS;
+    return levelFor(importance * margin) == current ? current : level;
+}
+
+bool PointShadowAtlas::allocateTiles(LightState& state, uint32_t level)
+{
+    for (uint32_t i = 0; i < CUBE_FACES; i++)
+    {
+        Tile& tile = state.tiles[i];
+        tile.level = level;
+        if (allocateTile(level, tile.origin)) continue;
+
+        for (uint32_t j = 0; j < i; j++)
+        {
+            freeTile(state.tiles[j].origin, level);
+        }
+        return false;
+    }
+
+    state.faces = {};
+    state.hasTiles = true;
+    return true;
+}
+
+void PointShadowAtlas::freeTiles(LightState& state)
+{
+    if (!state.hasTiles) return;
+
+    for (const Tile& tile : state.tiles)
+    {
+        freeTile(tile.origin, tile.level);
+    }
+    state.hasTiles = false;
+}
+
+bool PointShadowAtlas::allocateTile(uint32_t level, glm::uvec2& origin)
+{
+    std::vector<glm::uvec2>& tiles = m_freeTiles[level];
+    if (!tiles.empty())
+    {
+        origin = tiles.back();
+        tiles.pop_back();
+        return true;
+    }
+    if (level == 0) return false;
+
+    // Split a tile of the level above, the other three quarters become free
+    glm::uvec2 parent;
+    if (!allocateTile(level - 1, parent)) return false;
+
+    const uint32_t size = tileSize(level);
+    tiles.push_back(parent + glm::uvec2(size, 0));
+    tiles.push_back(parent + glm::uvec2(0, size));
+    tiles.push_back(parent + glm::uvec2(size, size));
+    origin = parent;
+    return true;
+}
+
+void PointShadowAtlas::freeTile(glm::uvec2 origin, uint32_t level)
+{
+    std::vector<glm::uvec2>& tiles = m_freeTiles[level];
+    if (level > 0)
+    {
+        // Merge back into the parent once all four quarters are free
+        const uint32_t size = tileSize(level);
+        const glm::uvec2 parent = origin - origin % (size * 2);
+        const glm::uvec2 quarters[] = { parent, parent + glm::uvec2(size, 0), parent + glm::uvec2(0, size), parent + glm::uvec2(size, size) };
+
+        auto isFree = [&](const glm::uvec2& quarter)
+        {
+            return quarter == origin || std::find(tiles.begin(), tiles.end(), quarter) != tiles.end();
+        };
+        if (std::all_of(std::begin(quarters), std::end(quarters), isFree))
+        {
+            std::erase_if(tiles, [&](const glm::uvec2& tile) { return tile / (size * 2) == parent / (size * 2); });
+            freeTile(parent, level - 1);
+            return;
+        }
+    }
+    tiles.push_back(origin);
+}
+
+glm::mat4 PointShadowAtlas::faceViewProjection(const LightState& state, uint32_t face) const
+{
+    const glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, POINT_SHADOW_NEAR, state.radius);
+    const glm::mat4 view = glm::lookAt(state.position, state.position + FACE_DIRECTIONS[face], FACE_UPS[face]);
+    return projection * view;
+}
+
+glm::mat4 PointShadowAtlas::atlasMatrix(const Tile& tile) const
+{
+    // Clip space of the face to its tile's texture coordinates, depth to [0, 1]
+    const float scale = static_cast<float>(tileSize(tile.level)) / static_cast<float>(m_size);
+    const glm::vec2 offset = glm::vec2(tile.origin) / static_cast<float>(m_size);
+
+    glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(offset + 0.5f * scale, 0.5f));
+    return glm::scale(matrix, glm::vec3(0.5f * scale, 0.5f * scale, 0.5f));
+}
+
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "core/bounds.h"
+
+namespace OpenGL
+{
+
+using namespace Engine;
+
+// Point lights beyond this many (by importance) are unshadowed
+const uint32_t MAX_POINT_SHADOWS = 8;
+const uint32_t CUBE_FACES = 6;
+
+struct PointShadowStats
+{
+    uint32_t shadowedLights = 0;
+    uint32_t facesRendered = 0;
+    uint32_t staleFaces = 0;  // Out of date but over the face budget, left for later frames
+    uint32_t oldestFace = 0;  // Frames since the least recently rendered face was drawn
+    uint32_t casters = 0;
+};
+
+// Matches PointShadowUBO of the standard fragment shader (std140, binding 3)
+struct PointShadowData
+{
+    glm::mat4 matrices[MAX_POINT_SHADOWS * CUBE_FACES]; // World to atlas UV and depth
+    glm::vec4 rects[MAX_POINT_SHADOWS * CUBE_FACES];    // Face tile in atlas UV, XY = min, ZW = max
+    glm::ivec4 lights[MAX_POINT_SHADOWS];              // X = light slot
+    glm::ivec4 params;                                 // X = shadow count
+};
+
+// A point light that wants a shadow this frame
+struct PointShadowLight
+{
+    uint32_t id = 0;   // Stable across frames, light slots aren't
+    uint32_t slot = 0; // Index in LightsUBO
+    glm::vec3 position = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+// A cube face picked to be rendered this frame
+struct PointShadowFace
+{
+    glm::mat4 viewProjection;
+    Frustum frustum;
+    glm::uvec4 viewport; // X, Y, width, height in texels
+};
+
+// Cube map shadows of point lights packed into one depth texture. Each light gets
+// six square tiles whose size follows its importance (how much of the screen its
+// range covers), allocated from a quadtree so tiles of every size share the atlas.
+// Only a budget of faces is rendered per frame, picked by importance and age, so
+// more shadowed lights make shadows refresh less often instead of frames slower.
+// Faces are sampled with the matrix they were rendered with, a face that's behind
+// its light stays consistent with itself until it's refreshed.
+class PointShadowAtlas
+{
+public:
+    bool initialize(uint32_t size);
+    void cleanup();
+
+    // Assigns tiles and picks at most faceBudget faces to refresh. Lights are
+    // reordered by importance, the ones beyond MAX_POINT_SHADOWS get no shadow.
+    void update(std::vector<PointShadowLight>& lights, const glm::vec3& cameraPosition, float fov, const Frustum& viewFrustum, uint32_t faceBudget);
+
+    const std::vector<PointShadowFace>& getPendingFaces() const { return m_pendingFaces; }
+
+    void beginPass();
+    void beginFace(const PointShadowFace& face);
+    void endPass(uint32_t casters);
+
+    PointShadowData getShaderData() const;
+    GLuint getTexture() const { return m_texture; }
+    const PointShadowStats& getStats() const { return m_stats; }
+
+    // Screen coverage of the light's range, 1 when the camera is inside it
+    static float computeImportance(const glm::vec3& position, float radius, const glm::vec3& cameraPosition, float fov);
+
+private:
+    struct Tile
+    {
+        glm::uvec2 origin = glm::uvec2(0);
+        uint32_t level = 0;
+    };
+
+    struct Face
+    {
+        glm::mat4 viewProjection = glm::mat4(1.0f); // Used for the current contents
+        uint64_t renderedFrame = 0;
+        bool valid = false; // Has been rendered since the tile was assigned
+        bool stale = true;  // The light changed since it was rendered
+    };
+
+    struct LightState
+    {
+        uint32_t slot = 0;
+        glm::vec3 position = glm::vec3(0.0f);
+        float radius = 0.0f;
+        float importance = 0.0f;
+        bool visible = false;
+        bool hasTiles = false;
+        std::array<Tile, CUBE_FACES> tiles;
+        std::array<Face, CUBE_FACES> faces;
+        uint64_t seenFrame = 0;
+    };
+
+    uint32_t chooseLevel(float importance, const LightState& state) const;
+    bool allocateTiles(LightState& state, uint32_t level);
+    void freeTiles(LightState& state);
+    bool allocateTile(uint32_t level, glm::uvec2& origin);
+    void freeTile(glm::uvec2 origin, uint32_t level);
+    uint32_t tileSize(uint32_t level) const { return m_size >> level; }
+    glm::mat4 faceViewProjection(const LightState& state, uint32_t face) const;
+    glm::mat4 atlasMatrix(const Tile& tile) const;
+
+    uint32_t m_size = 0;
+    GLuint m_texture = 0;
+    GLuint m_framebuffer = 0;
+
+    // Free tiles per quadtree level, level 0 is the whole atlas
+    std::vector<std::vector<glm::uvec2>> m_freeTiles;
+
+    std::unordered_map<uint32_t, LightState> m_lights;
+    std::vector<uint32_t> m_shadowed; // Light ids in importance order
+    std::vector<PointShadowFace> m_pendingFaces;
+    uint64_t m_frame = 0;
+    PointShadowStats m_stats;
+};
+
+}
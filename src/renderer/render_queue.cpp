@@ -0,0 +1,105 @@
+#include "render_queue.h"
+
+#include <algorithm>
+#include "core/assert.h"
+
+namespace OpenGL
+{
+
+const uint32_t DEPTH_BITS = 24;
+const uint32_t DEPTH_MAX = (1u << DEPTH_BITS) - 1;
+
+uint64_t RenderQueue::makeKey(RenderPass pass, uint8_t program, uint16_t material, uint16_t mesh, float depth)
+{
+    // Depth is normalized to [0, 1] by the caller
+    const uint64_t quantized = static_cast<uint64_t>(std::clamp(depth, 0.0f, 1.0f) * static_cast<float>(DEPTH_MAX));
+
+    uint64_t key = static_cast<uint64_t>(pass) << 60 | static_cast<uint64_t>(program & 0xF) << 56;
+    if (pass == RenderPass::Transparent)
+    {
+        // Blending needs back to front, state grouping comes second
+        key |= (DEPTH_MAX - quantized) << 32 | static_cast<uint64_t>(material) << 16 | mesh;
+    }
+    else
+    {
+        key |= static_cast<uint64_t>(material) << 40 | static_cast<uint64_t>(mesh) << 24 | quantized;
+    }
+    return key;
+}
+
+void RenderQueue::sort()
+{
+    if (m_packets.size() < 2) return;
+
+    // Bytes that differ between any two keys, the others don't need a pass
+    uint64_t varying = 0;
+    const uint64_t first = m_packets[0].key;
+    for (const DrawPacket& packet : m_packets)
+    {
+        varying |= packet.key ^ first;
+    }
+
+    m_scratch.resize(m_packets.size());
+    for (uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        if (((varying >> shift) & 0xFF) == 0) continue;
+
+        std::array<uint32_t, 256> offsets = {};
+        for (const DrawPacket& packet : m_packets)
+        {
+            offsets[(packet.key >> shift) & 0xFF]++;
+        }
+
+        uint32_t sum = 0;
+        for (uint32_t& offset : offsets)
+        {
+            uint32_t count = offset;
+            offset = sum;
+            sum += count;
+        }
+
+        for (const DrawPacket& packet : m_packets)
+        {
+            m_scratch[offsets[(packet.key >> shift) & 0xFF]++] = packet;
+        }
+        m_packets.swap(m_scratch);
+    }
+}
+
+void StateTracker::reset()
+{
+    m_program = UNKNOWN;
+    m_vao = UNKNOWN;
+    m_textures.fill(UNKNOWN);
+    m_stats = {};
+}
+
+void StateTracker::useProgram(GLuint program)
+{
+    if (program == m_program) return;
+
+    glUseProgram(program);
+    m_program = program;
+    m_stats.programChanges++;
+}
+
+void StateTracker::bindVertexArray(GLuint vao)
+{
+    if (vao == m_vao) return;
+
+    glBindVertexArray(vao);
+    m_vao = vao;
+    m_stats.vaoChanges++;
+}
+
+void StateTracker::bindTexture(uint32_t unit, GLuint texture)
+{
+    ASSERT(unit < TEXTURE_UNITS, "Texture unit out of range");
+    if (texture == m_textures[unit]) return;
+
+    glBindTextureUnit(unit, texture);
+    m_textures[unit] = texture;
+    m_stats.textureChanges++;
+}
+
+}
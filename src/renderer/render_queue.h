@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <GL/glew.h>
+
+namespace OpenGL
+{
+
+enum class RenderPass : uint8_t
+{
+    Opaque,
+    Transparent
+};
+
+// One draw, sorted by key. The key orders by pass, then program, then material and
+// mesh for opaque draws (front to back within a batch), or back to front for
+// transparent ones.
+struct DrawPacket
+{
+    uint64_t key;
+    uint32_t slot; // Renderer draw slot
+};
+
+class RenderQueue
+{
+public:
+    static uint64_t makeKey(RenderPass pass, uint8_t program, uint16_t material, uint16_t mesh, float depth);
+    static RenderPass getPass(uint64_t key) { return static_cast<RenderPass>(key >> 60); }
+
+    void clear() { m_packets.clear(); }
+    void push(uint64_t key, uint32_t slot) { m_packets.push_back({ key, slot }); }
+
+    // LSD radix sort, 8 bits per pass; passes where every key shares the byte are skipped
+    void sort();
+
+    const std::vector<DrawPacket>& getPackets() const { return m_packets; }
+
+private:
+    std::vector<DrawPacket> m_packets;
+    std::vector<DrawPacket> m_scratch;
+};
+
+// Counts of GL state changes that reached the driver, per frame
+struct StateChangeStats
+{
+    uint32_t programChanges = 0;
+    uint32_t textureChanges = 0;
+    uint32_t vaoChanges = 0;
+};
+
+// Shadows the bound program, VAO and texture units and skips redundant binds. The
+// shadow is dropped by reset(), as code outside the tracker may have changed state.
+class StateTracker
+{
+public:
+    static constexpr uint32_t TEXTURE_UNITS = 8;
+
+    StateTracker() { reset(); }
+    void reset();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void bindTexture(uint32_t unit, GLuint texture);
+
+    const StateChangeStats& getStats() const { return m_stats; }
+
+private:
+    // ~0 never names a GL object, so the first bind after a reset always goes through
+    static constexpr GLuint UNKNOWN = ~GLuint(0);
+
+    GLuint m_program = UNKNOWN;
+    GLuint m_vao = UNKNOWN;
+    std::array<GLuint, TEXTURE_UNITS> m_textures;
+    StateChangeStats m_stats;
+};
+
+}
@@ -0,0 +1,145 @@
+#include "ring_buffer.h"
+
+#include <iostream>
+#include <algorithm>
+#include "core/assert.h"
+
+namespace OpenGL
+{
+
+// A fence wait is retried in steps of this long, and given up after
+// MAX_FENCE_TIMEOUTS steps (a lost or hung device never signals it)
+const GLuint64 FENCE_TIMEOUT_NS = 1000 * 1000 * 1000;
+const uint32_t MAX_FENCE_TIMEOUTS = 5;
+
+// Regions start at multiples of this, enough for any uniform buffer offset alignment
+const size_t REGION_ALIGNMENT = 256;
+
+const GLbitfield RING_MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+bool RingBuffer::initialize(size_t frameSize)
+{
+    m_frame = 0;
+    m_head = 0;
+    m_frameBytes = 0;
+    m_stats = {};
+    return createBuffer(frameSize);
+}
+
+void RingBuffer::cleanup()
+{
+    for (RetiredBuffer& retired : m_retired)
+    {
+        glDeleteBuffers(1, &retired.buffer);
+    }
+    m_retired.clear();
+
+    for (GLsync& fence : m_fences)
+    {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    // Deleting a mapped buffer unmaps it
+    glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+    m_mapped = nullptr;
+    m_frameSize = 0;
+}
+
+void RingBuffer::beginFrame()
+{
+    m_frame = (m_frame + 1) % FRAMES;
+    m_head = 0;
+    m_frameBytes = 0;
+
+    // Deleting a buffer unbinds it from the context, so retired buffers wait until
+    // every binding made from them has been replaced
+    for (auto it = m_retired.begin(); it != m_retired.end();)
+    {
+        if (--it->framesLeft > 0)
+        {
+            ++it;
+            continue;
+        }
+        glDeleteBuffers(1, &it->buffer);
+        it = m_retired.erase(it);
+    }
+
+    GLsync& fence = m_fences[m_frame];
+    if (!fence) return;
+
+    // A region still in use means the CPU is more than FRAMES - 1 frames ahead
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        m_stats.stalls++;
+        for (uint32_t attempt = 0; attempt < MAX_FENCE_TIMEOUTS && result == GL_TIMEOUT_EXPIRED; attempt++)
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+        }
+
+        // The region is reused anyway rather than stalling forever
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            std::cerr << "Ring buffer: gave up waiting on the GPU for frame region " << m_frame << std::endl;
+        }
+    }
+    ASSERT(result != GL_WAIT_FAILED, "Waiting on a ring buffer fence failed");
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void RingBuffer::endFrame()
+{
+    ASSERT(!m_fences[m_frame], "Ring buffer region fenced twice");
+    m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_stats.frameBytes = static_cast<uint32_t>(m_frameBytes);
+}
+
+RingAllocation RingBuffer::allocate(size_t size, size_t alignment)
+{
+    ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0, "Alignment must be a power of two");
+
+    size_t offset = (m_head + alignment - 1) & ~(alignment - 1);
+    if (offset + size > m_frameSize)
+    {
+        // The fences belong to the frames, not the buffer: they stay so the next
+        // beginFrame calls still pace the CPU, and readers relying on that wait
+        // (occlusion counters, shadow timers) don't see frames still in flight
+        m_retired.push_back({ m_buffer, FRAMES });
+
+        createBuffer(std::max(m_frameSize * 2, size + alignment));
+        m_stats.grows++;
+        offset = 0;
+    }
+
+    m_head = offset + size;
+    m_frameBytes += size;
+
+    const size_t regionStart = m_frameSize * m_frame;
+    return {
+        m_buffer,
+        static_cast<GLintptr>(regionStart + offset),
+        m_mapped + regionStart + offset
+    };
+}
+
+bool RingBuffer::createBuffer(size_t frameSize)
+{
+    m_frameSize = (frameSize + REGION_ALIGNMENT - 1) & ~(REGION_ALIGNMENT - 1);
+    m_head = 0;
+
+    glCreateBuffers(1, &m_buffer);
+    glNamedBufferStorage(m_buffer, m_frameSize * FRAMES, nullptr, RING_MAP_FLAGS);
+    m_mapped = static_cast<unsigned char*>(glMapNamedBufferRange(m_buffer, 0, m_frameSize * FRAMES, RING_MAP_FLAGS));
+    if (!m_mapped)
+    {
+        std::cerr << "Failed to map ring buffer" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
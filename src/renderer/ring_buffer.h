@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <GL/glew.h>
+
+namespace OpenGL
+{
+
+// Totals since initialization
+struct RingBufferStats
+{
+    uint32_t stalls = 0; // Frames that waited on the GPU for their region
+    uint32_t grows = 0;
+    uint32_t frameBytes = 0; // Allocated during the last completed frame
+};
+
+// Sub-allocation of the current frame, written through data and bound by offset
+struct RingAllocation
+{
+    GLuint buffer = 0;
+    GLintptr offset = 0;
+    void* data = nullptr;
+};
+
+// Persistently and coherently mapped buffer split into one region per frame in
+// flight. Each region is fenced at the end of its frame and waited on before it is
+// written again, so per-frame data is written straight into GPU-visible memory
+// without glBufferSubData copies or driver-side orphaning.
+class RingBuffer
+{
+public:
+    static constexpr uint32_t FRAMES = 3;
+
+    bool initialize(size_t frameSize);
+    void cleanup();
+
+    // Moves to the next region, waiting for the GPU to release it first
+    void beginFrame();
+    // Fences the region, call after the last command reading this frame's data
+    void endFrame();
+
+    // Allocations never fail: a full region is replaced by a larger buffer, earlier
+    // allocations of the frame stay valid as the old buffer is retired, not deleted
+    RingAllocation allocate(size_t size, size_t alignment);
+
+    const RingBufferStats& getStats() const { return m_stats; }
+
+private:
+    bool createBuffer(size_t frameSize);
+
+    GLuint m_buffer = 0;
+    unsigned char* m_mapped = nullptr;
+    size_t m_frameSize = 0;
+    size_t m_head = 0;
+    size_t m_frameBytes = 0;
+    uint32_t m_frame = 0;
+    std::array<GLsync, FRAMES> m_fences = {}; // Per frame, kept across buffer grows
+    RingBufferStats m_stats;
+
+    // Replaced buffers, deleted once no frame in flight can still bind them
+    struct RetiredBuffer
+    {
+        GLuint buffer;
+        uint32_t framesLeft;
+    };
+    std::vector<RetiredBuffer> m_retired;
+};
+
+}
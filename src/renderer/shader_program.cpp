@@ -0,0 +1,119 @@
+#include "shader_program.h"
+
+#include <string>
+
+namespace OpenGL
+{
+
+void ShaderProgram::reflect()
+{
+    m_slots.clear();
+    m_uniformSlots.clear();
+    m_blockBindings.clear();
+
+    std::string name;
+    auto readName = [&](GLenum programInterface, GLint index, GLint length)
+    {
+        name.resize(static_cast<size_t>(length));
+        glGetProgramResourceName(id, programInterface, static_cast<GLuint>(index), length, nullptr, name.data());
+        name.resize(static_cast<size_t>(length > 0 ? length - 1 : 0)); // Drop the terminator
+    };
+
+    GLint uniformCount = 0;
+    glGetProgramInterfaceiv(id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+
+    const GLenum uniformProperties[] = { GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_BLOCK_INDEX };
+    for (GLint i = 0; i < uniformCount; i++)
+    {
+        GLint values[4];
+        glGetProgramResourceiv(id, GL_UNIFORM, static_cast<GLuint>(i), 4, uniformProperties, 4, nullptr, values);
+
+        // Block members are set through their buffers
+        if (values[3] != -1) continue;
+
+        // Arrays are reported by their first element
+        readName(GL_UNIFORM, i, values[0]);
+        if (name.ends_with("[0]")) name.resize(name.size() - 3);
+
+        m_uniformSlots.emplace(StringId(name), static_cast<int32_t>(m_slots.size()));
+        m_slots.push_back({ values[2], static_cast<GLenum>(values[1]) });
+    }
+
+    for (GLenum blockInterface : { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK })
+    {
+        GLint blockCount = 0;
+        glGetProgramInterfaceiv(id, blockInterface, GL_ACTIVE_RESOURCES, &blockCount);
+
+        const GLenum blockProperties[] = { GL_NAME_LENGTH, GL_BUFFER_BINDING };
+        for (GLint i = 0; i < blockCount; i++)
+        {
+            GLint values[2];
+            glGetProgramResourceiv(id, blockInterface, static_cast<GLuint>(i), 2, blockProperties, 2, nullptr, values);
+
+            readName(blockInterface, i, values[0]);
+            m_blockBindings.emplace(StringId(name), values[1]);
+        }
+    }
+}
+
+GLint ShaderProgram::getBlockBinding(const char* name) const
+{
+    auto it = m_blockBindings.find(StringId(name));
+    return it != m_blockBindings.end() ? it->second : -1;
+}
+
+bool ShaderProgram::isSampler(GLenum type)
+{
+    switch (type)
+    {
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_CUBE_MAP_ARRAY:
+        case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void ShaderProgram::upload(GLint location, int value) const
+{
+    glProgramUniform1i(id, location, value);
+}
+
+void ShaderProgram::upload(GLint location, float value) const
+{
+    glProgramUniform1f(id, location, value);
+}
+
+void ShaderProgram::upload(GLint location, const glm::vec2& value) const
+{
+    glProgramUniform2fv(id, location, 1, &value[0]);
+}
+
+void ShaderProgram::upload(GLint location, const glm::vec3& value) const
+{
+    glProgramUniform3fv(id, location, 1, &value[0]);
+}
+
+void ShaderProgram::upload(GLint location, const glm::vec4& value) const
+{
+    glProgramUniform4fv(id, location, 1, &value[0]);
+}
+
+void ShaderProgram::upload(GLint location, const glm::mat3& value) const
+{
+    glProgramUniformMatrix3fv(id, location, 1, GL_FALSE, &value[0][0]);
+}
+
+void ShaderProgram::upload(GLint location, const glm::mat4& value) const
+{
+    glProgramUniformMatrix4fv(id, location, 1, GL_FALSE, &value[0][0]);
+}
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+#include "core/assert.h"
+#include "core/string_id.h"
+
+namespace OpenGL
+{
+
+using namespace Engine;
+
+// Typed handle to a default block uniform, resolved once after linking. Handles to
+// uniforms the linker removed stay invalid and setting them does nothing.
+template <typename T>
+struct Uniform
+{
+    int32_t slot = -1;
+};
+
+class ShaderProgram
+{
+public:
+    GLuint id = 0;
+
+    // Reads back active uniforms and uniform/storage blocks, call after linking
+    void reflect();
+
+    template <typename T>
+    Uniform<T> getUniform(const char* name) const
+    {
+        auto it = m_uniformSlots.find(StringId(name));
+        if (it == m_uniformSlots.end()) return {};
+
+        ASSERT(matchesType<T>(m_slots[it->second].type), "Uniform type doesn't match the shader");
+        return { it->second };
+    }
+
+    // Binding point of a uniform or storage block, -1 when it isn't active
+    GLint getBlockBinding(const char* name) const;
+
+    // Programs keep their uniform values, so values equal to the last one set are skipped
+    template <typename T>
+    void set(Uniform<T> uniform, const std::type_identity_t<T>& value)
+    {
+        static_assert(sizeof(T) <= sizeof(UniformSlot::value), "Uniform type too large");
+        if (uniform.slot < 0) return;
+
+        UniformSlot& slot = m_slots[uniform.slot];
+        if (slot.valid && std::memcmp(slot.value, &value, sizeof(T)) == 0) return;
+
+        std::memcpy(slot.value, &value, sizeof(T));
+        slot.valid = true;
+        upload(slot.location, value);
+    }
+
+private:
+    struct UniformSlot
+    {
+        GLint location = -1;
+        GLenum type = 0;
+        bool valid = false;
+        unsigned char value[sizeof(glm::mat4)];
+    };
+
+    // Ints also set bools and sampler units
+    template <typename T>
+    static bool matchesType(GLenum type)
+    {
+        if constexpr (std::is_same_v<T, int>) return type == GL_INT || type == GL_BOOL || isSampler(type);
+        else if constexpr (std::is_same_v<T, float>) return type == GL_FLOAT;
+        else if constexpr (std::is_same_v<T, glm::vec2>) return type == GL_FLOAT_VEC2;
+        else if constexpr (std::is_same_v<T, glm::vec3>) return type == GL_FLOAT_VEC3;
+        else if constexpr (std::is_same_v<T, glm::vec4>) return type == GL_FLOAT_VEC4;
+        else if constexpr (std::is_same_v<T, glm::mat3>) return type == GL_FLOAT_MAT3;
+        else if constexpr (std::is_same_v<T, glm::mat4>) return type == GL_FLOAT_MAT4;
+        else return false;
+    }
+    static bool isSampler(GLenum type);
+
+    // Direct state access, the program doesn't have to be bound
+    void upload(GLint location, int value) const;
+    void upload(GLint location, float value) const;
+    void upload(GLint location, const glm::vec2& value) const;
+    void upload(GLint location, const glm::vec3& value) const;
+    void upload(GLint location, const glm::vec4& value) const;
+    void upload(GLint location, const glm::mat3& value) const;
+    void upload(GLint location, const glm::mat4& value) const;
+
+    std::vector<UniformSlot> m_slots;
+    std::unordered_map<StringId, int32_t> m_uniformSlots;
+    std::unordered_map<StringId, GLint> m_blockBindings;
+};
+
+}
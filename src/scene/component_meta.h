@@ -0,0 +1,209 @@
+#pragma once
+
+#include <tuple>
+#include <optional>
+#include <type_traits>
+#include <entt/core/hashed_string.hpp>
+#include "components.h"
+
+namespace Engine {
+
+// Compile-time component reflection. Each reflected component specializes
+// ComponentMeta with its file/type name, editor label and field list; serializers,
+// load dispatch and the editor's details panel are generated from it.
+//
+// Adding a component: specialize ComponentMeta below and append the type to
+// SerializedComponents and/or EditorComponents.
+
+template <typename... Ts>
+struct TypeList {};
+
+// Editor presentation of a field, the value type picks the widget otherwise
+enum class FieldHint : uint8_t
+{
+    None,
+    Color,      // vec3 edited as a color
+    ReadOnly    // Shown but not editable
+};
+
+template <typename Class, typename T>
+struct FieldMeta
+{
+    using ValueType = T;
+
+    const char* key;    // JSON key
+    const char* label;  // Editor label
+    T Class::* member;
+    float speed;
+    float min;
+    float max;          // min == max means unbounded
+    FieldHint hint;
+};
+
+template <typename Class, typename T>
+constexpr FieldMeta<Class, T> field(const char* key, const char* label, T Class::* member,
+                                    float speed = 0.1f, float min = 0.0f, float max = 0.0f,
+                                    FieldHint hint = FieldHint::None)
+{
+    return { key, label, member, speed, min, max, hint };
+}
+
+template <typename T>
+struct ComponentMeta;
+
+// Display names of reflected enums, indexed by value
+template <typename E>
+struct EnumMeta;
+
+template <>
+struct ComponentMeta<NameComponent>
+{
+    static constexpr const char* name = "Name";
+    static constexpr const char* label = "Name";
+    static constexpr auto fields = std::make_tuple(
+        field("name", "Name", &NameComponent::name)
+    );
+};
+
+template <>
+struct ComponentMeta<TransformComponent>
+{
+    static constexpr const char* name = "Transform";
+    static constexpr const char* label = "Transform";
+    static constexpr auto fields = std::make_tuple(
+        field("position", "Position", &TransformComponent::position),
+        field("rotation", "Rotation", &TransformComponent::rotation),
+        field("scale", "Scale", &TransformComponent::scale)
+    );
+};
+
+template <>
+struct ComponentMeta<CameraComponent>
+{
+    static constexpr const char* name = "Camera";
+    static constexpr const char* label = "Camera";
+    static constexpr auto fields = std::make_tuple(
+        field("fov", "FOV", &CameraComponent::fov, 0.1f, 1.0f, 180.0f),
+        field("nearClip", "Near Plane", &CameraComponent::nearClip, 0.01f, 0.01f, 10.0f),
+        field("farClip", "Far Plane", &CameraComponent::farClip, 1.0f, 10.0f, 10000.0f)
+    );
+};
+
+template <>
+struct EnumMeta<LightType>
+{
+    static constexpr const char* names[] = { "Point Light", "Directional Light" };
+};
+
+template <>
+struct ComponentMeta<LightComponent>
+{
+    static constexpr const char* name = "Light";
+    static constexpr const char* label = "Light";
+    static constexpr auto fields = std::make_tuple(
+        field("position", "Position", &LightComponent::position),
+        field("direction", "Direction", &LightComponent::direction),
+        field("color", "Color", &LightComponent::color, 0.0f, 0.0f, 0.0f, FieldHint::Color),
+        field("power", "Intensity", &LightComponent::power, 0.1f, 0.0f, 100.0f),
+        field("type", "Light Type", &LightComponent::type)
+    );
+};
+
+template <>
+struct ComponentMeta<MeshRendererComponent>
+{
+    static constexpr const char* name = "MeshRenderer";
+    static constexpr const char* label = "Mesh Renderer";
+    static constexpr auto fields = std::make_tuple(
+        field("meshData", "Mesh", &MeshRendererComponent::meshData, 0.0f, 0.0f, 0.0f, FieldHint::ReadOnly),
+        field("material", "Material", &MeshRendererComponent::material, 0.0f, 0.0f, 0.0f, FieldHint::ReadOnly),
+        field("castShadows", "Cast Shadows", &MeshRendererComponent::castShadows)
+    );
+};
+
+template <>
+struct ComponentMeta<ActiveCamera>
+{
+    static constexpr const char* name = "ActiveCamera";
+    static constexpr const char* label = "Active Camera";
+    static constexpr auto fields = std::make_tuple();
+};
+
+template <>
+struct ComponentMeta<Static>
+{
+    static constexpr const char* name = "Static";
+    static constexpr const char* label = "Static";
+    static constexpr auto fields = std::make_tuple();
+};
+
+// Components read from and written to scene files, in the order they're applied
+using SerializedComponents = TypeList<
+    TransformComponent,
+    CameraComponent,
+    LightComponent,
+    MeshRendererComponent,
+    ActiveCamera,
+    Static
+>;
+
+// Components prefab instances read from their prefab until they override them.
+// The others are copied into every instance since systems write them in place.
+using PrefabSharedComponents = TypeList<
+    MeshRendererComponent
+>;
+
+// Components listed in the editor's details panel
+using EditorComponents = TypeList<
+    NameComponent,
+    TransformComponent,
+    CameraComponent,
+    MeshRendererComponent,
+    LightComponent,
+    ActiveCamera,
+    Static
+>;
+
+// Type ids are the hashed file names, so dispatch compares integers, not strings
+template <typename T>
+constexpr entt::id_type componentTypeId()
+{
+    return entt::hashed_string::value(ComponentMeta<T>::name);
+}
+
+// Calls fn(std::type_identity<T>{}) for every type of the list
+template <typename... Ts, typename Fn>
+constexpr void forEachType(TypeList<Ts...>, Fn&& fn)
+{
+    (fn(std::type_identity<Ts>{}), ...);
+}
+
+// Calls fn(fieldMeta) for every reflected field of T
+template <typename T, typename Fn>
+constexpr void forEachField(Fn&& fn)
+{
+    std::apply([&](const auto&... fields) { (fn(fields), ...); }, ComponentMeta<T>::fields);
+}
+
+template <typename T, typename List>
+struct ListContains;
+
+template <typename T, typename... Ts>
+struct ListContains<T, TypeList<Ts...>> : std::bool_constant<(std::is_same_v<T, Ts> || ...)> {};
+
+template <typename T>
+constexpr bool isPrefabShared = ListContains<T, PrefabSharedComponents>::value;
+
+template <typename List>
+struct OptionalTuple;
+
+template <typename... Ts>
+struct OptionalTuple<TypeList<Ts...>>
+{
+    using Type = std::tuple<std::optional<Ts>...>;
+};
+
+// One optional value per serialized component, what a staged entity or prefab holds
+using ComponentValues = OptionalTuple<SerializedComponents>::Type;
+
+}
@@ -0,0 +1,293 @@
+#include "component_serializer.h"
+
+#include <algorithm>
+#include "core/utils.h"
+
+namespace Engine {
+
+void BinaryWriter::write(const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+}
+
+void BinaryWriter::writeString(const std::string& value)
+{
+    write(static_cast<uint32_t>(value.size()));
+    write(value.data(), value.size());
+}
+
+bool BinaryReader::read(void* data, size_t size)
+{
+    if (m_failed || size > m_size - m_offset)
+    {
+        m_failed = true;
+        return false;
+    }
+
+    std::memcpy(data, m_data + m_offset, size);
+    m_offset += size;
+    return true;
+}
+
+bool BinaryReader::readString(std::string& value)
+{
+    uint32_t length = 0;
+    if (!read(length) || length > m_size - m_offset)
+    {
+        m_failed = true;
+        return false;
+    }
+
+    value.assign(reinterpret_cast<const char*>(m_data + m_offset), length);
+    m_offset += length;
+    return true;
+}
+
+bool BinaryReader::skip(size_t size)
+{
+    if (m_failed || size > m_size - m_offset)
+    {
+        m_failed = true;
+        return false;
+    }
+
+    m_offset += size;
+    return true;
+}
+
+BinaryReader BinaryReader::slice(size_t size)
+{
+    const uint8_t* start = m_data + m_offset;
+    if (!skip(size)) return BinaryReader(start, 0);
+    return BinaryReader(start, size);
+}
+
+const ComponentSerializer::TypeEntry* ComponentSerializer::findType(entt::id_type id)
+{
+    // Built once from the reflected type list, sorted for binary search
+    static const std::vector<TypeEntry> table = []()
+    {
+        std::vector<TypeEntry> entries;
+        forEachType(SerializedComponents{}, [&](auto type)
+        {
+            using T = typename decltype(type)::type;
+            entries.push_back({
+                componentTypeId<T>(),
+                [](const json& data, ResourceManager& resourceManager, ComponentValues& values, const ComponentValues* defaults)
+                {
+                    const std::optional<T>* fallback = defaults ? &std::get<std::optional<T>>(*defaults) : nullptr;
+                    auto& value = std::get<std::optional<T>>(values);
+                    if (fallback && *fallback) value = **fallback;
+                    else value.emplace();
+                    fromJson(data, *value, resourceManager);
+                },
+                [](BinaryReader& reader, ResourceManager& resourceManager, ComponentValues& values)
+                {
+                    fromBinary(reader, std::get<std::optional<T>>(values).emplace(), resourceManager);
+                }
+            });
+        });
+
+        std::sort(entries.begin(), entries.end(), [](const TypeEntry& a, const TypeEntry& b) { return a.id < b.id; });
+        return entries;
+    }();
+
+    auto it = std::lower_bound(table.begin(), table.end(), id, [](const TypeEntry& entry, entt::id_type value) { return entry.id < value; });
+    return it != table.end() && it->id == id ? &*it : nullptr;
+}
+
+bool ComponentSerializer::readJson(const std::string& type, const json& data, ResourceManager& resourceManager, ComponentValues& values,
+                                   const ComponentValues* defaults)
+{
+    const TypeEntry* entry = findType(entt::hashed_string::value(type.c_str(), type.size()));
+    if (!entry) return false;
+
+    entry->parseJson(data, resourceManager, values, defaults);
+    return true;
+}
+
+bool ComponentSerializer::readBinary(BinaryReader& reader, ResourceManager& resourceManager, ComponentValues& values)
+{
+    uint32_t count = 0;
+    reader.read(count);
+
+    for (uint32_t i = 0; i < count && reader.isValid(); i++)
+    {
+        entt::id_type id = 0;
+        uint32_t size = 0;
+        reader.read(id);
+        reader.read(size);
+
+        // Parsed within its recorded size, the reader moves past the record either way.
+        // Unknown components and trailing fields this build doesn't read are skipped.
+        BinaryReader record = reader.slice(size);
+        if (!reader.isValid()) break;
+
+        if (const TypeEntry* entry = findType(id))
+        {
+            entry->parseBinary(record, resourceManager, values);
+            if (!record.isValid()) return false;
+        }
+    }
+
+    return reader.isValid();
+}
+
+json ComponentSerializer::writeJson(const entt::registry& registry, entt::entity entity, const ComponentValues* base)
+{
+    json components = json::array();
+    forEachType(SerializedComponents{}, [&](auto type)
+    {
+        using T = typename decltype(type)::type;
+        if (!isWritten<T>(registry, entity, base)) return;
+
+        json data;
+        if constexpr (std::is_empty_v<T>) data = json::object();
+        else data = toJson(registry.get<T>(entity));
+
+        components.push_back({ { "type", ComponentMeta<T>::name }, { "data", std::move(data) } });
+    });
+    return components;
+}
+
+void ComponentSerializer::writeBinary(BinaryWriter& writer, const entt::registry& registry, entt::entity entity, const ComponentValues* base)
+{
+    size_t countOffset = writer.size();
+    uint32_t count = 0;
+    writer.write(count);
+
+    forEachType(SerializedComponents{}, [&](auto type)
+    {
+        using T = typename decltype(type)::type;
+        if (!isWritten<T>(registry, entity, base)) return;
+
+        writer.write(componentTypeId<T>());
+        size_t sizeOffset = writer.size();
+        writer.write(uint32_t(0));
+
+        if constexpr (!std::is_empty_v<T>) toBinary(writer, registry.get<T>(entity));
+
+        writer.overwrite(sizeOffset, static_cast<uint32_t>(writer.size() - sizeOffset - sizeof(uint32_t)));
+        count++;
+    });
+
+    writer.overwrite(countOffset, count);
+}
+
+void ComponentSerializer::apply(entt::registry& registry, entt::entity entity, const ComponentValues& values)
+{
+    forEachType(SerializedComponents{}, [&](auto type)
+    {
+        using T = typename decltype(type)::type;
+        if (const auto& value = std::get<std::optional<T>>(values))
+        {
+            if constexpr (std::is_empty_v<T>) registry.emplace_or_replace<T>(entity);
+            else registry.emplace_or_replace<T>(entity, *value);
+        }
+    });
+}
+
+void ComponentSerializer::readValue(const json& j, glm::vec3& value, ResourceManager& resourceManager)
+{
+    UNUSED(resourceManager);
+    value = JsonUtils::parseVec3(j);
+}
+
+void ComponentSerializer::readValue(const json& j, glm::quat& value, ResourceManager& resourceManager)
+{
+    UNUSED(resourceManager);
+    value = JsonUtils::parseQuat(j);
+}
+
+void ComponentSerializer::readValue(const json& j, std::shared_ptr<MeshData>& value, ResourceManager& resourceManager)
+{
+    value = j.is_string() ? resourceManager.loadMesh(j.get<std::string>()) : nullptr;
+}
+
+void ComponentSerializer::readValue(const json& j, std::shared_ptr<Material>& value, ResourceManager& resourceManager)
+{
+    value = j.is_string() ? resourceManager.loadMaterial(j.get<std::string>()) : nullptr;
+}
+
+void ComponentSerializer::readValue(const json& j, StringId& value, ResourceManager& resourceManager)
+{
+    UNUSED(resourceManager);
+    value = StringId(j.get<std::string>());
+}
+
+json ComponentSerializer::writeValue(const glm::vec3& value)
+{
+    return { { "x", value.x }, { "y", value.y }, { "z", value.z } };
+}
+
+json ComponentSerializer::writeValue(const glm::quat& value)
+{
+    // Inverse of JsonUtils::parseQuat, which reads the fields in (w, x, y, z) order
+    return { { "x", value.w }, { "y", value.x }, { "z", value.y }, { "w", value.z } };
+}
+
+json ComponentSerializer::writeValue(const std::shared_ptr<MeshData>& value)
+{
+    return value ? json(value->path.str()) : json(nullptr);
+}
+
+json ComponentSerializer::writeValue(const std::shared_ptr<Material>& value)
+{
+    return value ? json(value->path.str()) : json(nullptr);
+}
+
+json ComponentSerializer::writeValue(const StringId& value)
+{
+    return value.str();
+}
+
+void ComponentSerializer::readValue(BinaryReader& reader, std::string& value, ResourceManager& resourceManager)
+{
+    UNUSED(resourceManager);
+    reader.readString(value);
+}
+
+void ComponentSerializer::readValue(BinaryReader& reader, std::shared_ptr<MeshData>& value, ResourceManager& resourceManager)
+{
+    std::string path;
+    reader.readString(path);
+    value = path.empty() ? nullptr : resourceManager.loadMesh(path);
+}
+
+void ComponentSerializer::readValue(BinaryReader& reader, std::shared_ptr<Material>& value, ResourceManager& resourceManager)
+{
+    std::string path;
+    reader.readString(path);
+    value = path.empty() ? nullptr : resourceManager.loadMaterial(path);
+}
+
+void ComponentSerializer::readValue(BinaryReader& reader, StringId& value, ResourceManager& resourceManager)
+{
+    UNUSED(resourceManager);
+    std::string text;
+    reader.readString(text);
+    value = StringId(text);
+}
+
+void ComponentSerializer::writeValue(BinaryWriter& writer, const std::string& value)
+{
+    writer.writeString(value);
+}
+
+void ComponentSerializer::writeValue(BinaryWriter& writer, const StringId& value)
+{
+    writer.writeString(value.str());
+}
+
+void ComponentSerializer::writeValue(BinaryWriter& writer, const std::shared_ptr<MeshData>& value)
+{
+    writer.writeString(value ? value->path.str() : std::string());
+}
+
+void ComponentSerializer::writeValue(BinaryWriter& writer, const std::shared_ptr<Material>& value)
+{
+    writer.writeString(value ? value->path.str() : std::string());
+}
+
+}
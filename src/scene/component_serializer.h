@@ -0,0 +1,224 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <type_traits>
+#include <nlohmann/json.hpp>
+#include <entt/entity/registry.hpp>
+#include "core/assert.h"
+#include "core/resource_manager.h"
+#include "component_meta.h"
+
+namespace Engine {
+
+using json = nlohmann::json;
+
+// Appends raw values to a byte buffer, native endianness
+class BinaryWriter
+{
+public:
+    explicit BinaryWriter(std::vector<uint8_t>& buffer) : m_buffer(buffer) {}
+
+    void write(const void* data, size_t size);
+    void writeString(const std::string& value);
+
+    template <typename T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values are written raw");
+        write(&value, sizeof(T));
+    }
+
+    // Fills in a value reserved earlier, e.g. a size known only after the payload
+    template <typename T>
+    void overwrite(size_t offset, const T& value)
+    {
+        std::memcpy(m_buffer.data() + offset, &value, sizeof(T));
+    }
+
+    size_t size() const { return m_buffer.size(); }
+
+private:
+    std::vector<uint8_t>& m_buffer;
+};
+
+// Reads values written by BinaryWriter. Reading past the end fails and stays failed.
+class BinaryReader
+{
+public:
+    BinaryReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    bool read(void* data, size_t size);
+    bool readString(std::string& value);
+    bool skip(size_t size);
+
+    // Reader over the next size bytes, which this one skips
+    BinaryReader slice(size_t size);
+
+    template <typename T>
+    bool read(T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values are read raw");
+        return read(&value, sizeof(T));
+    }
+
+    bool isValid() const { return !m_failed; }
+    bool atEnd() const { return m_offset == m_size; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+    bool m_failed = false;
+};
+
+// Serialization generated from ComponentMeta. Per-component functions walk the
+// reflected fields; the rest dispatch on the hashed type name through one table
+// built from SerializedComponents.
+class ComponentSerializer
+{
+public:
+    // Reads a component by type name into values, false for unknown types. Keys missing
+    // from data keep the value in defaults (e.g. the prefab's) if it has the component.
+    static bool readJson(const std::string& type, const json& data, ResourceManager& resourceManager, ComponentValues& values,
+                         const ComponentValues* defaults = nullptr);
+
+    // Reads a block written by writeBinary, unknown component types are skipped
+    static bool readBinary(BinaryReader& reader, ResourceManager& resourceManager, ComponentValues& values);
+
+    // The entity's serialized components, as a scene file "components" array. Components
+    // equal to the one in base (the prefab's, for instances) are left out.
+    static json writeJson(const entt::registry& registry, entt::entity entity, const ComponentValues* base = nullptr);
+    static void writeBinary(BinaryWriter& writer, const entt::registry& registry, entt::entity entity, const ComponentValues* base = nullptr);
+
+    // Emplaces (or replaces) every component present in values
+    static void apply(entt::registry& registry, entt::entity entity, const ComponentValues& values);
+
+    template <typename It>
+    static void insert(entt::registry& registry, It first, It last, const ComponentValues& values)
+    {
+        forEachType(SerializedComponents{}, [&](auto type)
+        {
+            using T = typename decltype(type)::type;
+            if (const auto& value = std::get<std::optional<T>>(values))
+            {
+                if constexpr (std::is_empty_v<T>) registry.insert<T>(first, last);
+                else registry.insert<T>(first, last, *value);
+            }
+        });
+    }
+
+    // Single component, field by field. Missing keys keep their default values.
+    template <typename T>
+    static void fromJson(const json& data, T& component, ResourceManager& resourceManager)
+    {
+        forEachField<T>([&](const auto& field)
+        {
+            if (auto it = data.find(field.key); it != data.end())
+            {
+                readValue(*it, component.*field.member, resourceManager);
+            }
+        });
+    }
+
+    template <typename T>
+    static json toJson(const T& component)
+    {
+        json data = json::object();
+        forEachField<T>([&](const auto& field)
+        {
+            data[field.key] = writeValue(component.*field.member);
+        });
+        return data;
+    }
+
+    template <typename T>
+    static void fromBinary(BinaryReader& reader, T& component, ResourceManager& resourceManager)
+    {
+        forEachField<T>([&](const auto& field)
+        {
+            readValue(reader, component.*field.member, resourceManager);
+        });
+    }
+
+    template <typename T>
+    static void toBinary(BinaryWriter& writer, const T& component)
+    {
+        forEachField<T>([&](const auto& field)
+        {
+            writeValue(writer, component.*field.member);
+        });
+    }
+
+private:
+    struct TypeEntry
+    {
+        entt::id_type id;
+        void (*parseJson)(const json& data, ResourceManager& resourceManager, ComponentValues& values, const ComponentValues* defaults);
+        void (*parseBinary)(BinaryReader& reader, ResourceManager& resourceManager, ComponentValues& values);
+    };
+
+    static const TypeEntry* findType(entt::id_type id);
+
+    template <typename T>
+    static bool isWritten(const entt::registry& registry, entt::entity entity, const ComponentValues* base)
+    {
+        if (!registry.all_of<T>(entity)) return false;
+        if (!base || !std::get<std::optional<T>>(*base)) return true;
+
+        if constexpr (std::is_empty_v<T>) return false;
+        else return toJson(registry.get<T>(entity)) != toJson(*std::get<std::optional<T>>(*base));
+    }
+
+    // Field values. Arithmetic types and enums are generic, the rest is overloaded.
+    template <typename T>
+    static void readValue(const json& j, T& value, ResourceManager& resourceManager)
+    {
+        UNUSED(resourceManager);
+        if constexpr (std::is_enum_v<T>) value = static_cast<T>(j.get<int>());
+        else value = j.get<T>();
+    }
+
+    template <typename T>
+    static json writeValue(const T& value)
+    {
+        if constexpr (std::is_enum_v<T>) return static_cast<int>(value);
+        else return value;
+    }
+
+    template <typename T>
+    static void readValue(BinaryReader& reader, T& value, ResourceManager& resourceManager)
+    {
+        UNUSED(resourceManager);
+        reader.read(value);
+    }
+
+    template <typename T>
+    static void writeValue(BinaryWriter& writer, const T& value)
+    {
+        writer.write(value);
+    }
+
+    static void readValue(const json& j, glm::vec3& value, ResourceManager& resourceManager);
+    static void readValue(const json& j, glm::quat& value, ResourceManager& resourceManager);
+    static void readValue(const json& j, std::shared_ptr<MeshData>& value, ResourceManager& resourceManager);
+    static void readValue(const json& j, std::shared_ptr<Material>& value, ResourceManager& resourceManager);
+    static void readValue(const json& j, StringId& value, ResourceManager& resourceManager);
+    static json writeValue(const glm::vec3& value);
+    static json writeValue(const glm::quat& value);
+    static json writeValue(const std::shared_ptr<MeshData>& value);
+    static json writeValue(const std::shared_ptr<Material>& value);
+    static json writeValue(const StringId& value);
+
+    static void readValue(BinaryReader& reader, std::string& value, ResourceManager& resourceManager);
+    static void readValue(BinaryReader& reader, std::shared_ptr<MeshData>& value, ResourceManager& resourceManager);
+    static void readValue(BinaryReader& reader, std::shared_ptr<Material>& value, ResourceManager& resourceManager);
+    static void readValue(BinaryReader& reader, StringId& value, ResourceManager& resourceManager);
+    static void writeValue(BinaryWriter& writer, const std::string& value);
+    static void writeValue(BinaryWriter& writer, const std::shared_ptr<MeshData>& value);
+    static void writeValue(BinaryWriter& writer, const std::shared_ptr<Material>& value);
+    static void writeValue(BinaryWriter& writer, const StringId& value);
+};
+
+}
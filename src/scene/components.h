@@ -8,6 +8,7 @@
 #include <glm/gtx/euler_angles.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include "core/resources.h"
+#include "core/string_id.h"
 
 namespace Engine {
 
@@ -15,10 +16,38 @@ struct Renderable {};
 struct LightSource {};
 struct PerspectiveCamera {};
 struct ActiveCamera {};
+struct BoundsDirty {};
 
+// Parked in an EntityPool: kept alive for reuse but left out of the spatial index,
+// lighting, scheduled systems and saved scenes
+struct Inactive {};
+
+// Created by the WorldStreamer for a world cell, owned by the stream rather than
+// the scene, so left out of saved scenes
+struct Streamed {};
+
+// Not expected to move or change, shadow maps cache what it casts
+struct Static {};
+
+struct Prefab;
+
+// Persistent identity, stable across save/load. Zero is assigned a fresh id on emplace.
+struct UUIDComponent
+{
+    UUID uuid = 0;
+};
+
+// Scene file an entity was loaded from, see Scene::addScene. Entities created at
+// runtime have no source.
+struct SceneSourceComponent
+{
+    uint32_t source = 0;
+};
+
+// Interned, entities sharing a name share one copy of it
 struct NameComponent
 {
-    std::string name;
+    StringId name;
 };
 
 struct TransformComponent
@@ -35,6 +64,14 @@ struct MeshRendererComponent
     bool castShadows = true;
 };
 
+// World space bounds of a mesh renderer, maintained by the scene's spatial index
+struct WorldBoundsComponent
+{
+    AABB aabb;
+    BoundingSphere sphere;
+    int32_t proxy = -1;
+};
+
 enum class LightType : uint8_t
 {
     POINT,
@@ -57,4 +94,10 @@ struct CameraComponent
     float farClip = 1000.0f;
 };
 
+// The prefab is owned by the Scene; instances hold their overrides as components
+struct PrefabInstanceComponent
+{
+    const Prefab* prefab = nullptr;
+};
+
 }  
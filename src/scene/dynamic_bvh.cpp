@@ -0,0 +1,303 @@
+#include "dynamic_bvh.h"
+
+#include <algorithm>
+#include "core/assert.h"
+
+namespace Engine {
+
+// Leaf boxes are enlarged by this fraction of their size (plus a small absolute margin)
+const float FAT_AABB_SCALE = 0.1f;
+const float FAT_AABB_MARGIN = 0.05f;
+
+int32_t DynamicBVH::insert(const AABB& aabb, uint32_t userData)
+{
+    ASSERT(aabb.isValid(), "Empty or NaN boxes poison the surface area costs");
+
+    int32_t leaf = allocateNode();
+    m_nodes[leaf].aabb = fatten(aabb);
+    m_nodes[leaf].userData = userData;
+    m_nodes[leaf].height = 0;
+
+    insertLeaf(leaf);
+    m_proxyCount++;
+
+    return leaf;
+}
+
+void DynamicBVH::remove(int32_t proxy)
+{
+    ASSERT(proxy >= 0 && proxy < static_cast<int32_t>(m_nodes.size()), "Invalid BVH proxy");
+    ASSERT(m_nodes[proxy].isLeaf() && m_nodes[proxy].height == 0, "BVH proxy is not a leaf");
+
+    removeLeaf(proxy);
+    freeNode(proxy);
+    m_proxyCount--;
+}
+
+bool DynamicBVH::update(int32_t proxy, const AABB& aabb)
+{
+    ASSERT(proxy >= 0 && proxy < static_cast<int32_t>(m_nodes.size()), "Invalid BVH proxy");
+    ASSERT(aabb.isValid(), "Empty or NaN boxes poison the surface area costs");
+
+    // Still enclosed by the fat box and the fat box isn't grossly oversized: nothing to do
+    AABB fatAABB = fatten(aabb);
+    const AABB& current = m_nodes[proxy].aabb;
+    if (current.contains(aabb) && current.surfaceArea() <= 4.0f * fatAABB.surfaceArea())
+    {
+        return false;
+    }
+
+    removeLeaf(proxy);
+    m_nodes[proxy].aabb = fatAABB;
+    insertLeaf(proxy);
+
+    return true;
+}
+
+void DynamicBVH::clear()
+{
+    m_nodes.clear();
+    m_root = NULL_NODE;
+    m_freeList = NULL_NODE;
+    m_proxyCount = 0;
+}
+
+int32_t DynamicBVH::allocateNode()
+{
+    if (m_freeList == NULL_NODE)
+    {
+        m_nodes.emplace_back();
+        return static_cast<int32_t>(m_nodes.size() - 1);
+    }
+
+    int32_t node = m_freeList;
+    m_freeList = m_nodes[node].parent;
+    m_nodes[node] = Node{};
+
+    return node;
+}
+
+void DynamicBVH::freeNode(int32_t node)
+{
+    m_nodes[node].parent = m_freeList;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+void DynamicBVH::insertLeaf(int32_t leaf)
+{
+    if (m_root == NULL_NODE)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Descend following the cheapest surface area cost
+    const AABB leafAABB = m_nodes[leaf].aabb;
+    int32_t index = m_root;
+    while (!m_nodes[index].isLeaf())
+    {
+        const Node& node = m_nodes[index];
+
+        float area = node.aabb.surfaceArea();
+        float combinedArea = AABB::merge(node.aabb, leafAABB).surfaceArea();
+
+        // Cost of pairing the leaf with this node, and the cost pushed down to the children
+        float cost = 2.0f * combinedArea;
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto childCost = [&](int32_t child)
+        {
+            const Node& childNode = m_nodes[child];
+            float mergedArea = AABB::merge(leafAABB, childNode.aabb).surfaceArea();
+            if (childNode.isLeaf())
+            {
+                return mergedArea + inheritanceCost;
+            }
+            return (mergedArea - childNode.aabb.surfaceArea()) + inheritanceCost;
+        };
+
+        float cost1 = childCost(node.child1);
+        float cost2 = childCost(node.child2);
+
+        if (cost < cost1 && cost < cost2) break;
+
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    int32_t sibling = index;
+    int32_t oldParent = m_nodes[sibling].parent;
+
+    // allocateNode may grow the node array, so no references are held across it
+    int32_t newParent = allocateNode();
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].aabb = AABB::merge(leafAABB, m_nodes[sibling].aabb);
+    m_nodes[newParent].height = m_nodes[sibling].height + 1;
+    m_nodes[newParent].child1 = sibling;
+    m_nodes[newParent].child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent != NULL_NODE)
+    {
+        if (m_nodes[oldParent].child1 == sibling)
+        {
+            m_nodes[oldParent].child1 = newParent;
+        }
+        else
+        {
+            m_nodes[oldParent].child2 = newParent;
+        }
+    }
+    else
+    {
+        m_root = newParent;
+    }
+
+    refitAncestors(m_nodes[leaf].parent);
+}
+
+void DynamicBVH::removeLeaf(int32_t leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    int32_t parent = m_nodes[leaf].parent;
+    int32_t grandParent = m_nodes[parent].parent;
+    int32_t sibling = m_nodes[parent].child1 == leaf
+                    ? m_nodes[parent].child2
+                    : m_nodes[parent].child1;
+
+    if (grandParent != NULL_NODE)
+    {
+        if (m_nodes[grandParent].child1 == parent)
+        {
+            m_nodes[grandParent].child1 = sibling;
+        }
+        else
+        {
+            m_nodes[grandParent].child2 = sibling;
+        }
+        m_nodes[sibling].parent = grandParent;
+        freeNode(parent);
+
+        refitAncestors(grandParent);
+    }
+    else
+    {
+        m_root = sibling;
+        m_nodes[sibling].parent = NULL_NODE;
+        freeNode(parent);
+    }
+}
+
+void DynamicBVH::refitAncestors(int32_t index)
+{
+    while (index != NULL_NODE)
+    {
+        rotate(index);
+
+        Node& node = m_nodes[index];
+        const Node& child1 = m_nodes[node.child1];
+        const Node& child2 = m_nodes[node.child2];
+
+        node.aabb = AABB::merge(child1.aabb, child2.aabb);
+        node.height = 1 + std::max(child1.height, child2.height);
+
+        index = node.parent;
+    }
+}
+
+void DynamicBVH::rotate(int32_t indexA)
+{
+    // A has children B and C; B has children D and E, C has F and G.
+    // Swap a child of A with a grandchild on the other side when it
+    // reduces the surface area of the internal node that changes.
+    Node& A = m_nodes[indexA];
+    if (A.height < 2) return;
+
+    const int32_t indexB = A.child1;
+    const int32_t indexC = A.child2;
+    Node& B = m_nodes[indexB];
+    Node& C = m_nodes[indexC];
+
+    enum class Rotation { None, BF, BG, CD, CE };
+    Rotation best = Rotation::None;
+    float bestBenefit = 0.0f;
+
+    if (!C.isLeaf())
+    {
+        float areaC = C.aabb.surfaceArea();
+
+        float benefitBF = areaC - AABB::merge(B.aabb, m_nodes[C.child2].aabb).surfaceArea();
+        if (benefitBF > bestBenefit) { best = Rotation::BF; bestBenefit = benefitBF; }
+
+        float benefitBG = areaC - AABB::merge(B.aabb, m_nodes[C.child1].aabb).surfaceArea();
+        if (benefitBG > bestBenefit) { best = Rotation::BG; bestBenefit = benefitBG; }
+    }
+
+    if (!B.isLeaf())
+    {
+        float areaB = B.aabb.surfaceArea();
+
+        float benefitCD = areaB - AABB::merge(C.aabb, m_nodes[B.child2].aabb).surfaceArea();
+        if (benefitCD > bestBenefit) { best = Rotation::CD; bestBenefit = benefitCD; }
+
+        float benefitCE = areaB - AABB::merge(C.aabb, m_nodes[B.child1].aabb).surfaceArea();
+        if (benefitCE > bestBenefit) { best = Rotation::CE; bestBenefit = benefitCE; }
+    }
+
+    switch (best)
+    {
+        case Rotation::None:
+            break;
+
+        case Rotation::BF:
+        case Rotation::BG:
+        {
+            // B moves down into C, F or G moves up into A
+            int32_t indexMoved = best == Rotation::BF ? C.child1 : C.child2;
+            int32_t indexKept = best == Rotation::BF ? C.child2 : C.child1;
+
+            A.child1 = indexMoved;
+            m_nodes[indexMoved].parent = indexA;
+
+            if (best == Rotation::BF) C.child1 = indexB; else C.child2 = indexB;
+            B.parent = indexC;
+
+            C.aabb = AABB::merge(B.aabb, m_nodes[indexKept].aabb);
+            C.height = 1 + std::max(B.height, m_nodes[indexKept].height);
+            break;
+        }
+
+        case Rotation::CD:
+        case Rotation::CE:
+        {
+            // C moves down into B, D or E moves up into A
+            int32_t indexMoved = best == Rotation::CD ? B.child1 : B.child2;
+            int32_t indexKept = best == Rotation::CD ? B.child2 : B.child1;
+
+            A.child2 = indexMoved;
+            m_nodes[indexMoved].parent = indexA;
+
+            if (best == Rotation::CD) B.child1 = indexC; else B.child2 = indexC;
+            C.parent = indexB;
+
+            B.aabb = AABB::merge(C.aabb, m_nodes[indexKept].aabb);
+            B.height = 1 + std::max(C.height, m_nodes[indexKept].height);
+            break;
+        }
+    }
+}
+
+AABB DynamicBVH::fatten(const AABB& aabb)
+{
+    glm::vec3 margin = (aabb.max - aabb.min) * FAT_AABB_SCALE + glm::vec3(FAT_AABB_MARGIN);
+    return { aabb.min - margin, aabb.max + margin };
+}
+
+}
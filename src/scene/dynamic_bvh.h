@@ -0,0 +1,204 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "core/bounds.h"
+
+namespace Engine {
+
+// Incrementally updated AABB tree (insert/remove/update) in the spirit of
+// Box2D's b2DynamicTree. Leaves store enlarged ("fat") boxes so small motions
+// don't touch the tree, and ancestors are improved with surface-area
+// tree rotations on every refit.
+class DynamicBVH
+{
+public:
+    static constexpr int32_t NULL_NODE = -1;
+
+    int32_t insert(const AABB& aabb, uint32_t userData);
+    void remove(int32_t proxy);
+    bool update(int32_t proxy, const AABB& aabb); // Returns true if the leaf was reinserted
+    void clear();
+
+    uint32_t getUserData(int32_t proxy) const { return m_nodes[proxy].userData; }
+    const AABB& getFatAABB(int32_t proxy) const { return m_nodes[proxy].aabb; }
+
+    size_t getProxyCount() const { return m_proxyCount; }
+    int32_t getHeight() const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+
+    // Callback: bool(int32_t proxy), return false to stop the query
+    template <typename Callback>
+    void queryAABB(const AABB& aabb, Callback&& callback) const;
+
+    template <typename Callback>
+    void querySphere(const BoundingSphere& sphere, Callback&& callback) const;
+
+    // Callback: void(int32_t proxy, bool fullyInside)
+    template <typename Callback>
+    void queryFrustum(const Frustum& frustum, Callback&& callback) const;
+
+    // Callback: float(int32_t proxy, float maxDistance), returns the new max distance
+    // (e.g. the closest hit so far); returning 0 terminates the query.
+    template <typename Callback>
+    void queryRay(const Ray& ray, float maxDistance, Callback&& callback) const;
+
+private:
+    struct Node
+    {
+        AABB aabb;
+        uint32_t userData = 0;
+        int32_t parent = NULL_NODE; // Next free node while in the free list
+        int32_t child1 = NULL_NODE;
+        int32_t child2 = NULL_NODE;
+        int32_t height = 0;         // Leaf = 0, free = -1
+
+        bool isLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    int32_t allocateNode();
+    void freeNode(int32_t node);
+
+    void insertLeaf(int32_t leaf);
+    void removeLeaf(int32_t leaf);
+    void refitAncestors(int32_t node);
+    void rotate(int32_t node);
+
+    static AABB fatten(const AABB& aabb);
+
+    std::vector<Node> m_nodes;
+    int32_t m_root = NULL_NODE;
+    int32_t m_freeList = NULL_NODE;
+    size_t m_proxyCount = 0;
+};
+
+template <typename Callback>
+void DynamicBVH::queryAABB(const AABB& aabb, Callback&& callback) const
+{
+    if (m_root == NULL_NODE) return;
+
+    std::vector<int32_t> stack;
+    stack.reserve(64);
+    stack.push_back(m_root);
+
+    while (!stack.empty())
+    {
+        int32_t index = stack.back();
+        stack.pop_back();
+
+        const Node& node = m_nodes[index];
+        if (!node.aabb.overlaps(aabb)) continue;
+
+        if (node.isLeaf())
+        {
+            if (!callback(index)) return;
+        }
+        else
+        {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicBVH::querySphere(const BoundingSphere& sphere, Callback&& callback) const
+{
+    if (m_root == NULL_NODE) return;
+
+    std::vector<int32_t> stack;
+    stack.reserve(64);
+    stack.push_back(m_root);
+
+    while (!stack.empty())
+    {
+        int32_t index = stack.back();
+        stack.pop_back();
+
+        const Node& node = m_nodes[index];
+        if (!BoundsUtils::intersects(node.aabb, sphere)) continue;
+
+        if (node.isLeaf())
+        {
+            if (!callback(index)) return;
+        }
+        else
+        {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicBVH::queryFrustum(const Frustum& frustum, Callback&& callback) const
+{
+    if (m_root == NULL_NODE) return;
+
+    // Sign bit of the stack entry marks subtrees already known to be fully inside
+    std::vector<int32_t> stack;
+    stack.reserve(64);
+    stack.push_back(m_root);
+
+    while (!stack.empty())
+    {
+        int32_t entry = stack.back();
+        stack.pop_back();
+
+        bool inside = entry < 0;
+        int32_t index = inside ? ~entry : entry;
+        const Node& node = m_nodes[index];
+
+        if (!inside)
+        {
+            FrustumTest test = BoundsUtils::testFrustum(frustum, node.aabb);
+            if (test == FrustumTest::Outside) continue;
+            inside = test == FrustumTest::Inside;
+        }
+
+        if (node.isLeaf())
+        {
+            callback(index, inside);
+        }
+        else
+        {
+            stack.push_back(inside ? ~node.child1 : node.child1);
+            stack.push_back(inside ? ~node.child2 : node.child2);
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicBVH::queryRay(const Ray& ray, float maxDistance, Callback&& callback) const
+{
+    if (m_root == NULL_NODE) return;
+
+    const glm::vec3 invDirection = BoundsUtils::inverseDirection(ray.direction);
+
+    std::vector<int32_t> stack;
+    stack.reserve(64);
+    stack.push_back(m_root);
+
+    while (!stack.empty())
+    {
+        int32_t index = stack.back();
+        stack.pop_back();
+
+        const Node& node = m_nodes[index];
+        float distance;
+        if (!BoundsUtils::intersectRay(ray, invDirection, node.aabb, maxDistance, distance)) continue;
+
+        if (node.isLeaf())
+        {
+            maxDistance = callback(index, maxDistance);
+            if (maxDistance <= 0.0f) return;
+        }
+        else
+        {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+}
@@ -0,0 +1,78 @@
+#include "entity_pool.h"
+
+#include <algorithm>
+#include "core/assert.h"
+#include "scene.h"
+
+namespace Engine {
+
+EntityPool::EntityPool(Scene& scene, std::shared_ptr<const Prefab> prefab)
+    : m_scene(scene), m_prefab(std::move(prefab))
+{
+    ASSERT(m_prefab, "Prefab is null");
+}
+
+void EntityPool::reserve(size_t count)
+{
+    if (m_parked.size() >= count) return;
+
+    // Created parked: the renderer still prepares their draw records now, not on first spawn
+    entt::registry& registry = m_scene.getRegistry();
+    m_scene.instantiatePrefab(m_prefab, count - m_parked.size(), m_instantiated);
+    registry.insert<Inactive>(m_instantiated.begin(), m_instantiated.end());
+    m_parked.insert(m_parked.end(), m_instantiated.begin(), m_instantiated.end());
+}
+
+entt::entity EntityPool::spawn(const TransformComponent& transform)
+{
+    // Parked entities destroyed behind the pool's back (unloadSource, destroyDeferred)
+    // are dropped here instead of handed out
+    entt::registry& registry = m_scene.getRegistry();
+    while (!m_parked.empty() && !registry.valid(m_parked.back())) m_parked.pop_back();
+    if (m_parked.empty()) reserve(std::max(MIN_GROWTH, m_activeCount));
+
+    entt::entity entity = m_parked.back();
+    m_parked.pop_back();
+    m_activeCount++;
+
+    // The transform update puts it back into the spatial index
+    registry.remove<Inactive>(entity);
+    registry.emplace_or_replace<TransformComponent>(entity, transform);
+    return entity;
+}
+
+void EntityPool::release(entt::entity entity)
+{
+    std::lock_guard<std::mutex> lock(m_releaseMutex);
+    m_released.push_back(entity);
+}
+
+void EntityPool::flush()
+{
+    std::vector<entt::entity> released;
+    {
+        std::lock_guard<std::mutex> lock(m_releaseMutex);
+        released.swap(m_released);
+    }
+
+    // Releasing twice in a frame, or after the entity was destroyed, is ignored
+    entt::registry& registry = m_scene.getRegistry();
+    std::sort(released.begin(), released.end());
+    released.erase(std::unique(released.begin(), released.end()), released.end());
+    std::erase_if(released, [&](entt::entity entity)
+    {
+        return !registry.valid(entity) || registry.all_of<Inactive>(entity);
+    });
+
+    for (entt::entity entity : released)
+    {
+        UNUSED(entity);
+        ASSERT(registry.get<PrefabInstanceComponent>(entity).prefab == m_prefab.get(), "Entity released to a pool it wasn't spawned from");
+    }
+
+    registry.insert<Inactive>(released.begin(), released.end());
+    m_parked.insert(m_parked.end(), released.begin(), released.end());
+    m_activeCount -= std::min(m_activeCount, released.size());
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <entt/entity/registry.hpp>
+#include "components.h"
+#include "prefab.h"
+
+namespace Engine {
+
+class Scene;
+
+// Recycles instances of one prefab for spawn-heavy workloads (projectiles, effects).
+// Released entities are parked with the Inactive tag instead of destroyed, so spawning
+// one again skips entity creation, component construction and GPU record setup.
+// Components other than the transform keep the values they had when released.
+class EntityPool
+{
+public:
+    EntityPool(Scene& scene, std::shared_ptr<const Prefab> prefab);
+
+    EntityPool(const EntityPool&) = delete;
+    EntityPool& operator=(const EntityPool&) = delete;
+
+    // Main thread: instantiates entities up front so at least count are parked
+    void reserve(size_t count);
+
+    // Main thread: activates a parked entity at the transform, growing the pool when empty
+    entt::entity spawn(const TransformComponent& transform);
+
+    // Any thread: the entity is parked when the scene flushes at the end of the frame
+    void release(entt::entity entity);
+
+    // Main thread: parks everything released since the last flush, in one batch
+    void flush();
+
+    const std::shared_ptr<const Prefab>& getPrefab() const { return m_prefab; }
+    size_t getActiveCount() const { return m_activeCount; }
+    size_t getParkedCount() const { return m_parked.size(); }
+
+private:
+    static constexpr size_t MIN_GROWTH = 16;
+
+    Scene& m_scene;
+    std::shared_ptr<const Prefab> m_prefab;
+
+    std::vector<entt::entity> m_parked;
+    std::vector<entt::entity> m_instantiated;
+    size_t m_activeCount = 0;
+
+    std::vector<entt::entity> m_released;
+    std::mutex m_releaseMutex;
+};
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <entt/entity/registry.hpp>
+#include "core/uuid.h"
+#include "component_meta.h"
+
+namespace Engine {
+
+// Resolved entity template, owned by the Scene that loaded it. Instances get a
+// copy of instanceComponents and read the shared ones (PrefabSharedComponents)
+// from here until they override them.
+struct Prefab
+{
+    std::string name;
+    std::string path;
+    ComponentValues components;         // Everything the file declares
+    ComponentValues instanceComponents; // The part copied into each instance
+    UUID uuid = 0;
+};
+
+// The entity's own component, or the one its prefab shares with it
+template <typename T>
+const T* findComponent(const entt::registry& registry, entt::entity entity)
+{
+    static_assert(!std::is_empty_v<T>, "Tags are checked with all_of");
+
+    if (const T* component = registry.try_get<T>(entity)) return component;
+
+    if constexpr (isPrefabShared<T>)
+    {
+        if (const auto* instance = registry.try_get<PrefabInstanceComponent>(entity))
+        {
+            const auto& value = std::get<std::optional<T>>(instance->prefab->components);
+            return value ? &*value : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+}
@@ -1,23 +1,233 @@
 #include "scene.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include "core/assert.h"
 #include "core/utils.h"
+#include "core/file_system.h"
+#include "component_serializer.h"
 
 namespace Engine {
  
 using json = nlohmann::json;
 
+// Binary scene layout: magic, version, entity count, then per entity its uuid,
+// name, prefab path (version 2, empty for plain entities) and a
+// ComponentSerializer::writeBinary block holding the prefab overrides
+const uint32_t BINARY_SCENE_MAGIC = 0x4E435347; // "GSCN"
+const uint32_t BINARY_SCENE_VERSION = 2;
+
+Scene::Scene()
+{
+    // Name index
+    m_registry.on_construct<NameComponent>().connect<&Scene::onNameAssigned>(this);
+    m_registry.on_update<NameComponent>().connect<&Scene::onNameAssigned>(this);
+    m_registry.on_destroy<NameComponent>().connect<&Scene::onNameDestroyed>(this);
+
+    // Keep the spatial index in sync with transform and mesh changes
+    m_registry.on_construct<TransformComponent>().connect<&Scene::onBoundsSourceChanged>(this);
+    m_registry.on_update<TransformComponent>().connect<&Scene::onBoundsSourceChanged>(this);
+    m_registry.on_construct<MeshRendererComponent>().connect<&Scene::onBoundsSourceChanged>(this);
+    m_registry.on_update<MeshRendererComponent>().connect<&Scene::onBoundsSourceChanged>(this);
+    m_registry.on_construct<PrefabInstanceComponent>().connect<&Scene::onBoundsSourceChanged>(this);
+    m_registry.on_destroy<TransformComponent>().connect<&Scene::onBoundsSourceDestroyed>(this);
+    m_registry.on_destroy<MeshRendererComponent>().connect<&Scene::onMeshRendererDestroyed>(this);
+    m_registry.on_destroy<PrefabInstanceComponent>().connect<&Scene::onBoundsSourceDestroyed>(this);
+    m_registry.on_destroy<WorldBoundsComponent>().connect<&Scene::onWorldBoundsDestroyed>(this);
+    m_registry.on_construct<Inactive>().connect<&Scene::onBoundsSourceDestroyed>(this);
+
+    // Persistent id index
+    m_registry.on_construct<UUIDComponent>().connect<&Scene::onUUIDAssigned>(this);
+    m_registry.on_update<UUIDComponent>().connect<&Scene::onUUIDAssigned>(this);
+    m_registry.on_destroy<UUIDComponent>().connect<&Scene::onUUIDDestroyed>(this);
+}
+
 void Scene::newScene()
 {
+    m_clearedSignal.publish();
+
+    m_pools.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_destroyMutex);
+        m_pendingDestroy.clear();
+    }
     m_registry.clear();
+    m_spatialIndex.clear();
+    m_revertedOverrides.clear();
+    m_entitiesByUUID.clear();
+    m_entitiesByName.clear();
+    m_nameSlots.clear();
+    m_sources.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_prefabMutex);
+        m_prefabs.clear();
+    }
 }
 
 bool Scene::loadScene(const std::string& path, ResourceManager& resourceManager)
 {
-    m_registry.clear();
-    resourceManager.cleanup();
+    newScene();
+    bool loaded = loadEntities(path, resourceManager, addSource(path));
+
+    // Only drop what the new scene doesn't share with the old one
+    resourceManager.collectUnused();
+    return loaded;
+}
+
+bool Scene::saveScene(const std::string& path) const
+{
+    // Entities parked in pools are runtime state, streamed cells belong to their own files
+    std::vector<entt::entity> saved;
+    for (auto entity : m_registry.view<UUIDComponent>(entt::exclude<Inactive, Streamed>))
+    {
+        saved.push_back(entity);
+    }
+
+    // Prefab instances only store what they override
+    auto prefabOf = [&](entt::entity entity) -> const Prefab*
+    {
+        const auto* instance = m_registry.try_get<PrefabInstanceComponent>(entity);
+        return instance ? instance->prefab : nullptr;
+    };
+
+    if (isBinarySceneFile(path))
+    {
+        std::vector<uint8_t> data;
+        BinaryWriter writer(data);
+        writer.write(BINARY_SCENE_MAGIC);
+        writer.write(BINARY_SCENE_VERSION);
+        writer.write(static_cast<uint32_t>(saved.size()));
+
+        for (auto entity : saved)
+        {
+            const auto* name = m_registry.try_get<NameComponent>(entity);
+            const Prefab* prefab = prefabOf(entity);
+            writer.write(m_registry.get<UUIDComponent>(entity).uuid);
+            writer.writeString(name ? name->name.str() : std::string());
+            writer.writeString(prefab ? prefab->path : std::string());
+            ComponentSerializer::writeBinary(writer, m_registry, entity, prefab ? &prefab->components : nullptr);
+        }
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Failed to open scene file for writing: " << path << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        return true;
+    }
+
+    // Instances are grouped per prefab, in the order the prefabs are first seen
+    json entities = json::array();
+    std::vector<std::pair<const Prefab*, json>> instanceGroups;
+    for (auto entity : saved)
+    {
+        const auto* name = m_registry.try_get<NameComponent>(entity);
+        const Prefab* prefab = prefabOf(entity);
+
+        json entry = {
+            { "uuid", m_registry.get<UUIDComponent>(entity).uuid },
+            { "components", ComponentSerializer::writeJson(m_registry, entity, prefab ? &prefab->components : nullptr) }
+        };
+
+        // Like other optional components, unnamed entities don't get the key
+        if (name && !name->name.empty()) entry["name"] = name->name.str();
+
+        if (!prefab)
+        {
+            entities.push_back(std::move(entry));
+            continue;
+        }
+
+        auto group = std::find_if(instanceGroups.begin(), instanceGroups.end(), [prefab](const auto& g) { return g.first == prefab; });
+        if (group == instanceGroups.end())
+        {
+            instanceGroups.emplace_back(prefab, json::array());
+            group = std::prev(instanceGroups.end());
+        }
+        group->second.push_back(std::move(entry));
+    }
+
+    for (auto& [prefab, instances] : instanceGroups)
+    {
+        entities.push_back({ { "prefab", prefab->path }, { "instances", std::move(instances) } });
+    }
+
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open scene file for writing: " << path << std::endl;
+        return false;
+    }
+    file << json{ { "entities", entities } }.dump(4);
+    return true;
+}
+
+bool Scene::isBinarySceneFile(const std::string& path)
+{
+    const std::string extension = ".scene";
+    return path.size() >= extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+uint32_t Scene::addScene(const std::string& path, ResourceManager& resourceManager)
+{
+    uint32_t source = addSource(path);
+    if (!loadEntities(path, resourceManager, source))
+    {
+        unloadSource(source, resourceManager);
+        return 0;
+    }
+    return source;
+}
+
+void Scene::unloadSource(uint32_t source, ResourceManager& resourceManager)
+{
+    destroySourceEntities(source);
+    std::erase_if(m_sources, [source](const SceneSource& s) { return s.id == source; });
+    resourceManager.collectUnused();
+}
+
+bool Scene::reloadSource(uint32_t source, ResourceManager& resourceManager)
+{
+    auto it = std::find_if(m_sources.begin(), m_sources.end(), [source](const SceneSource& s) { return s.id == source; });
+    if (it == m_sources.end()) return false;
+
+    // The old entities' resources are still held by the resource manager, so
+    // whatever the new version shares with them isn't imported again
+    destroySourceEntities(source);
+    bool loaded = loadEntities(it->path, resourceManager, source);
+    resourceManager.collectUnused();
+    return loaded;
+}
+
+uint32_t Scene::addSource(const std::string& path)
+{
+    uint32_t id = m_nextSourceId++;
+    m_sources.push_back({ id, path });
+    return id;
+}
+
+bool Scene::loadEntities(const std::string& path, ResourceManager& resourceManager, uint32_t source)
+{
+    if (isBinarySceneFile(path))
+    {
+        std::vector<uint8_t> data;
+        std::vector<StagedEntity> staged;
+        if (!FileSystem::readBinary(path, data) || !stageBinary(data, resourceManager, staged))
+        {
+            std::cerr << "Failed to load binary scene file: " << path << std::endl;
+            return false;
+        }
+
+        for (const StagedEntity& entity : staged)
+        {
+            createEntity(entity, source);
+        }
+        return true;
+    }
 
     std::ifstream file(path);
     if (!file.is_open()) 
@@ -33,107 +243,592 @@ bool Scene::loadScene(const std::string& path, ResourceManager& resourceManager)
 
         for (auto& e : j["entities"]) 
         {
-            auto name = e["name"].get<std::string>();
-            auto components = e["components"];
+            if (e.contains("prefab"))
+            {
+                deserializePrefabInstances(e, resourceManager, source);
+                continue;
+            }
+
+            auto name = e.value("name", std::string());
 
             entt::entity entity = m_registry.create();
-            m_registry.emplace<NameComponent>(entity, name);
+            m_registry.emplace<UUIDComponent>(entity, e.value("uuid", UUID(0)));
+            m_registry.emplace<SceneSourceComponent>(entity, source);
+            if (!name.empty()) m_registry.emplace<NameComponent>(entity, StringId(name));
+            deserializeComponents(entity, e["components"], resourceManager);
+        }
+    }
+    catch (json::exception& e) 
+    {
+        std::cerr << "JSON error in scene file " << path << ":\n"
+                  << "  ID: " << e.id << "\n"
+                  << "  Message: " << e.what() << std::endl;
+        return false;
+    }
 
-            for (auto& component : components) 
-            {
-                auto type = component["type"].get<std::string>();
-                auto data = component["data"];
+    return true;
+}
 
-                if (type == "Transform") 
-                {
-                    m_registry.emplace<TransformComponent>(entity, deserializeTransform(data));
-                }
-                else if (type == "Camera") 
-                {
-                    m_registry.emplace<CameraComponent>(entity, deserializeCamera(data));
-                }
-                else if (type == "Light") 
-                {
-                    m_registry.emplace<LightComponent>(entity, deserializeLight(data));
-                }
-                else if (type == "MeshRenderer") 
-                {
-                    m_registry.emplace<MeshRendererComponent>(entity, deserializeMeshRenderer(data, resourceManager));
-                }
-                else if (type == "ActiveCamera") 
+void Scene::destroySourceEntities(uint32_t source)
+{
+    std::vector<entt::entity> entities;
+    for (auto [entity, tag] : m_registry.view<SceneSourceComponent>().each())
+    {
+        if (tag.source == source) entities.push_back(entity);
+    }
+    m_registry.destroy(entities.begin(), entities.end());
+}
+
+std::shared_ptr<const Prefab> Scene::loadPrefab(const std::string& path, ResourceManager& resourceManager)
+{
+    // Held while loading so concurrent cell loads don't parse the same prefab twice
+    std::lock_guard<std::mutex> lock(m_prefabMutex);
+
+    if (auto it = m_prefabs.find(path); it != m_prefabs.end())
+    {
+        return it->second;
+    }
+
+    std::ifstream file(path);
+    if (!file.is_open()) 
+    {
+        std::cerr << "Failed to open prefab file: " << path << std::endl;
+        return nullptr;
+    }
+
+    auto prefab = std::make_shared<Prefab>();
+    try 
+    {
+        json j;
+        file >> j;
+
+        StagedEntity staged;
+        stageComponents(j["components"], resourceManager, staged);
+
+        prefab->name = j.value("name", path);
+        prefab->path = path;
+        prefab->components = std::move(staged.components);
+
+        // Shared components stay with the prefab
+        prefab->instanceComponents = prefab->components;
+        forEachType(PrefabSharedComponents{}, [&](auto type)
+        {
+            std::get<std::optional<typename decltype(type)::type>>(prefab->instanceComponents).reset();
+        });
+    }
+    catch (json::exception& e) 
+    {
+        std::cerr << "Failed to parse prefab file: " << path << std::endl;
+        std::cerr << e.what() << std::endl;
+        return nullptr;
+    }
+
+    prefab->uuid = UUID_generate();
+    m_prefabs[path] = prefab;
+    return prefab;
+}
+
+void Scene::instantiatePrefab(const std::shared_ptr<const Prefab>& prefab, size_t count, std::vector<entt::entity>& entities)
+{
+    ASSERT(prefab, "Prefab is null");
+    const Prefab* owned = adoptPrefab(prefab).get();
+
+    entities.resize(count);
+    m_registry.create(entities.begin(), entities.end());
+
+    // Every instance points at the same resolved data, nothing is re-deserialized
+    // and shared components aren't copied at all
+    m_registry.insert<UUIDComponent>(entities.begin(), entities.end());
+    m_registry.insert<PrefabInstanceComponent>(entities.begin(), entities.end(), PrefabInstanceComponent{ owned });
+    ComponentSerializer::insert(m_registry, entities.begin(), entities.end(), owned->instanceComponents);
+}
+
+EntityPool& Scene::getPool(const std::shared_ptr<const Prefab>& prefab)
+{
+    std::shared_ptr<const Prefab> owned = adoptPrefab(prefab);
+    auto [it, inserted] = m_pools.try_emplace(owned.get());
+    if (inserted) it->second = std::make_unique<EntityPool>(*this, std::move(owned));
+    return *it->second;
+}
+
+std::shared_ptr<const Prefab> Scene::adoptPrefab(const std::shared_ptr<const Prefab>& prefab)
+{
+    // Staged entities can hold a prefab loaded before newScene dropped the cache,
+    // instances must point at the one this scene owns
+    std::lock_guard<std::mutex> lock(m_prefabMutex);
+    return m_prefabs.try_emplace(prefab->path, prefab).first->second;
+}
+
+void Scene::destroyDeferred(entt::entity entity)
+{
+    std::lock_guard<std::mutex> lock(m_destroyMutex);
+    m_pendingDestroy.push_back(entity);
+}
+
+void Scene::flushDestroyed()
+{
+    for (auto& [prefab, pool] : m_pools)
+    {
+        pool->flush();
+    }
+
+    std::vector<entt::entity> entities;
+    {
+        std::lock_guard<std::mutex> lock(m_destroyMutex);
+        entities.swap(m_pendingDestroy);
+    }
+
+    // Queued twice, or already destroyed some other way
+    std::sort(entities.begin(), entities.end());
+    entities.erase(std::unique(entities.begin(), entities.end()), entities.end());
+    std::erase_if(entities, [&](entt::entity entity) { return !m_registry.valid(entity); });
+    m_registry.destroy(entities.begin(), entities.end());
+}
+
+entt::entity Scene::findEntity(UUID uuid) const
+{
+    auto it = m_entitiesByUUID.find(uuid);
+    if (it == m_entitiesByUUID.end()) return entt::null;
+
+    // Entries can go stale when a UUIDComponent is replaced from outside the scene
+    auto* id = m_registry.valid(it->second) ? m_registry.try_get<UUIDComponent>(it->second) : nullptr;
+    return id && id->uuid == uuid ? it->second : entt::null;
+}
+
+entt::entity Scene::findEntityByName(StringId name) const
+{
+    auto it = m_entitiesByName.find(name);
+    return it != m_entitiesByName.end() ? it->second.front() : entt::null;
+}
+
+void Scene::findEntitiesByName(StringId name, std::vector<entt::entity>& entities) const
+{
+    auto it = m_entitiesByName.find(name);
+    if (it != m_entitiesByName.end())
+    {
+        entities.insert(entities.end(), it->second.begin(), it->second.end());
+    }
+}
+
+EntityRef Scene::makeRef(entt::entity entity) const
+{
+    EntityRef ref;
+    ref.entity = entity;
+    if (m_registry.valid(entity))
+    {
+        if (auto* id = m_registry.try_get<UUIDComponent>(entity)) ref.uuid = id->uuid;
+    }
+    return ref;
+}
+
+entt::entity Scene::resolve(EntityRef& ref) const
+{
+    if (m_registry.valid(ref.entity))
+    {
+        auto* id = m_registry.try_get<UUIDComponent>(ref.entity);
+        if (id ? id->uuid == ref.uuid : ref.uuid == 0) return ref.entity;
+    }
+
+    ref.entity = ref.uuid != 0 ? findEntity(ref.uuid) : entt::null;
+    return ref.entity;
+}
+
+bool Scene::stageEntities(const json& entities, ResourceManager& resourceManager, std::vector<StagedEntity>& staged)
+{
+    for (auto& e : entities)
+    {
+        if (!stageEntity(e, resourceManager, staged)) return false;
+    }
+    return true;
+}
+
+bool Scene::stageEntity(const json& e, ResourceManager& resourceManager, std::vector<StagedEntity>& staged)
+{
+    try 
+    {
+        if (e.contains("prefab"))
+        {
+            auto prefab = loadPrefab(e["prefab"].get<std::string>(), resourceManager);
+            if (!prefab) return true;
+
+            for (auto& instance : e["instances"])
+            {
+                StagedEntity& entity = staged.emplace_back();
+                entity.prefab = prefab;
+                entity.name = StringId(instance.value("name", ""));
+                entity.uuid = instance.value("uuid", UUID(0));
+                if (instance.contains("components"))
                 {
-                    m_registry.emplace<ActiveCamera>(entity);
+                    stageComponents(instance["components"], resourceManager, entity, &prefab->components);
                 }
             }
+            return true;
         }
+
+        StagedEntity& entity = staged.emplace_back();
+        entity.name = StringId(e.value("name", std::string()));
+        entity.uuid = e.value("uuid", UUID(0));
+        stageComponents(e["components"], resourceManager, entity);
     }
-    catch (json::exception& e) 
+    catch (json::exception& ex) 
     {
-        std::cerr << "JSON error in scene file " << path << ":\n"
-                  << "  ID: " << e.id << "\n"
-                  << "  Message: " << e.what() << std::endl;
+        std::cerr << "Failed to parse entities:\n"
+                  << "  ID: " << ex.id << "\n"
+                  << "  Message: " << ex.what() << std::endl;
         return false;
     }
 
     return true;
 }
 
-TransformComponent Scene::deserializeTransform(const json& obj)
+bool Scene::stageBinary(const std::vector<uint8_t>& data, ResourceManager& resourceManager, std::vector<StagedEntity>& staged)
+{
+    BinaryReader reader(data.data(), data.size());
+
+    uint32_t magic = 0, version = 0, count = 0;
+    reader.read(magic);
+    reader.read(version);
+    reader.read(count);
+    if (!reader.isValid() || magic != BINARY_SCENE_MAGIC || version == 0 || version > BINARY_SCENE_VERSION)
+    {
+        std::cerr << "Not a binary scene, or an unsupported version" << std::endl;
+        return false;
+    }
+
+    staged.reserve(staged.size() + count);
+    for (uint32_t i = 0; i < count && reader.isValid(); i++)
+    {
+        StagedEntity& entity = staged.emplace_back();
+        std::string name, prefab;
+        reader.read(entity.uuid);
+        reader.readString(name);
+        if (version >= 2) reader.readString(prefab);
+        entity.name = StringId(name);
+        if (!prefab.empty()) entity.prefab = loadPrefab(prefab, resourceManager);
+        ComponentSerializer::readBinary(reader, resourceManager, entity.components);
+    }
+
+    return reader.isValid();
+}
+
+entt::entity Scene::createEntity(const StagedEntity& staged, uint32_t source)
+{
+    entt::entity entity = m_registry.create();
+    m_registry.emplace<UUIDComponent>(entity, staged.uuid);
+    if (source != 0) m_registry.emplace<SceneSourceComponent>(entity, source);
+
+    if (staged.prefab)
+    {
+        const Prefab* prefab = adoptPrefab(staged.prefab).get();
+        m_registry.emplace<PrefabInstanceComponent>(entity, prefab);
+        ComponentSerializer::apply(m_registry, entity, prefab->instanceComponents);
+    }
+
+    if (!staged.name.empty())
+    {
+        m_registry.emplace<NameComponent>(entity, staged.name);
+    }
+    applyComponents(entity, staged);
+
+    return entity;
+}
+
+void Scene::updateSpatialIndex()
+{
+    prepareWorldBounds();
+    for (auto [entity, transform, bounds] : m_registry.view<BoundsDirty, TransformComponent, WorldBoundsComponent>().each())
+    {
+        computeWorldBounds(entity, transform, bounds);
+    }
+    refitSpatialIndex();
+}
+
+void Scene::prepareWorldBounds()
+{
+    // Instances whose mesh override was removed fall back to the prefab's mesh
+    std::vector<entt::entity> reverted;
+    {
+        std::lock_guard<std::mutex> lock(m_signalMutex);
+        reverted.swap(m_revertedOverrides);
+    }
+    for (auto entity : reverted)
+    {
+        if (m_registry.valid(entity)) m_registry.emplace_or_replace<BoundsDirty>(entity);
+    }
+
+    // Entities that can't be indexed leave the tree and aren't computed
+    std::vector<entt::entity> dropped;
+    for (auto entity : m_registry.view<BoundsDirty>())
+    {
+        auto* meshRenderer = findComponent<MeshRendererComponent>(m_registry, entity);
+        if (!m_registry.all_of<TransformComponent>(entity) || !meshRenderer || !meshRenderer->meshData ||
+            m_registry.all_of<Inactive>(entity))
+        {
+            removeFromSpatialIndex(m_registry, entity);
+            dropped.push_back(entity);
+            continue;
+        }
+
+        m_registry.get_or_emplace<WorldBoundsComponent>(entity);
+    }
+    m_registry.remove<BoundsDirty>(dropped.begin(), dropped.end());
+}
+
+void Scene::computeWorldBounds(entt::entity entity, const TransformComponent& transform, WorldBoundsComponent& bounds) const
+{
+    const MeshData& meshData = *findComponent<MeshRendererComponent>(m_registry, entity)->meshData;
+    glm::mat4 model = MathUtils::calculateModelMatrix(transform);
+    bounds.aabb = BoundsUtils::transformAABB(meshData.bounds, model);
+    bounds.sphere = BoundsUtils::transformSphere(meshData.boundingSphere, model);
+}
+
+void Scene::refitSpatialIndex()
+{
+    for (auto [entity, bounds] : m_registry.view<BoundsDirty, WorldBoundsComponent>().each())
+    {
+        // Empty meshes have an inverted box, they stay out of the index
+        if (!bounds.aabb.isValid())
+        {
+            if (bounds.proxy != DynamicBVH::NULL_NODE)
+            {
+                m_spatialIndex.remove(bounds.proxy);
+                bounds.proxy = DynamicBVH::NULL_NODE;
+            }
+            continue;
+        }
+
+        if (bounds.proxy == DynamicBVH::NULL_NODE)
+        {
+            bounds.proxy = m_spatialIndex.insert(bounds.aabb, entt::to_integral(entity));
+        }
+        else
+        {
+            m_spatialIndex.update(bounds.proxy, bounds.aabb);
+        }
+    }
+
+    m_registry.clear<BoundsDirty>();
+}
+
+bool Scene::raycast(const Ray& ray, RaycastHit& hit) const
+{
+    bool found = false;
+
+    m_spatialIndex.queryRay(ray, FLT_MAX, [&](int32_t proxy, float maxDistance)
+    {
+        auto entity = static_cast<entt::entity>(m_spatialIndex.getUserData(proxy));
+        const auto& transform = m_registry.get<TransformComponent>(entity);
+        const MeshData& meshData = *findComponent<MeshRendererComponent>(m_registry, entity)->meshData;
+
+        // Test in mesh space; the ray parameter is preserved by the affine transform
+        glm::mat4 invModel = glm::inverse(MathUtils::calculateModelMatrix(transform));
+        Ray localRay = {
+            glm::vec3(invModel * glm::vec4(ray.origin, 1.0f)),
+            glm::vec3(invModel * glm::vec4(ray.direction, 0.0f))
+        };
+
+        float distance;
+        uint32_t triangle;
+        if (!meshData.triangleBVH.intersect(localRay, meshData.vertices, meshData.indices, maxDistance, distance, triangle))
+        {
+            return maxDistance;
+        }
+
+        hit.entity = entity;
+        hit.distance = distance;
+        hit.point = ray.origin + ray.direction * distance;
+        found = true;
+
+        return distance;
+    });
+
+    return found;
+}
+
+void Scene::onBoundsSourceChanged(entt::registry& registry, entt::entity entity)
+{
+    std::lock_guard<std::mutex> lock(m_signalMutex);
+    registry.emplace_or_replace<BoundsDirty>(entity);
+}
+
+void Scene::onBoundsSourceDestroyed(entt::registry& registry, entt::entity entity)
+{
+    std::lock_guard<std::mutex> lock(m_signalMutex);
+    removeFromSpatialIndex(registry, entity);
+}
+
+void Scene::onMeshRendererDestroyed(entt::registry& registry, entt::entity entity)
 {
-    TransformComponent transform;
-    transform.position = JsonUtils::parseVec3(obj["position"]);
-    transform.rotation = JsonUtils::parseQuat(obj["rotation"]);
-    transform.scale = JsonUtils::parseVec3(obj["scale"]);
+    std::lock_guard<std::mutex> lock(m_signalMutex);
+    removeFromSpatialIndex(registry, entity);
+
+    // Can't tag the entity here, it may be in the middle of being destroyed
+    if (registry.all_of<PrefabInstanceComponent>(entity))
+    {
+        m_revertedOverrides.push_back(entity);
+    }
+}
 
-    return transform;
+void Scene::onWorldBoundsDestroyed(entt::registry& registry, entt::entity entity)
+{
+    std::lock_guard<std::mutex> lock(m_signalMutex);
+    removeFromSpatialIndex(registry, entity);
 }
 
-CameraComponent Scene::deserializeCamera(const json& obj)
+void Scene::removeFromSpatialIndex(entt::registry& registry, entt::entity entity)
 {
-    CameraComponent camera;
-    camera.fov = obj["fov"].get<float>();
-    camera.nearClip = obj["nearClip"].get<float>();
-    camera.farClip = obj["farClip"].get<float>();
+    if (auto* bounds = registry.try_get<WorldBoundsComponent>(entity))
+    {
+        if (bounds->proxy != DynamicBVH::NULL_NODE)
+        {
+            m_spatialIndex.remove(bounds->proxy);
+            bounds->proxy = DynamicBVH::NULL_NODE;
+        }
+    }
+}
 
-    return camera;
+void Scene::setUUID(entt::entity entity, UUID uuid)
+{
+    // Drop the old key, the update signal indexes the new one
+    {
+        std::lock_guard<std::mutex> lock(m_signalMutex);
+        auto& id = m_registry.get<UUIDComponent>(entity);
+        if (auto it = m_entitiesByUUID.find(id.uuid); it != m_entitiesByUUID.end() && it->second == entity)
+        {
+            m_entitiesByUUID.erase(it);
+        }
+    }
+    m_registry.replace<UUIDComponent>(entity, uuid);
 }
 
-MeshRendererComponent Scene::deserializeMeshRenderer(const json& obj, ResourceManager& resourceManager)
+void Scene::onUUIDAssigned(entt::registry& registry, entt::entity entity)
 {
-    MeshRendererComponent meshRenderer;
+    std::lock_guard<std::mutex> lock(m_signalMutex);
+    auto& id = registry.get<UUIDComponent>(entity);
+    if (id.uuid == 0) id.uuid = UUID_generate();
+
+    auto [it, inserted] = m_entitiesByUUID.try_emplace(id.uuid, entity);
+    if (inserted || it->second == entity) return;
+
+    if (findEntity(id.uuid) != entt::null)
+    {
+        // Another live entity owns this id (duplicated file entry), keep ids unique
+        std::cerr << "Duplicate entity UUID " << id.uuid << ", assigning a new one" << std::endl;
+        id.uuid = UUID_generate();
+        m_entitiesByUUID[id.uuid] = entity;
+        return;
+    }
 
-    auto meshDataPath = obj["meshData"].get<std::string>();
-    auto materialPath = obj["material"].get<std::string>();
+    it->second = entity;
+}
 
-    auto meshData = resourceManager.loadMesh(meshDataPath);
-    if (!meshData) 
+void Scene::onUUIDDestroyed(entt::registry& registry, entt::entity entity)
+{
+    std::lock_guard<std::mutex> lock(m_signalMutex);
+    auto it = m_entitiesByUUID.find(registry.get<UUIDComponent>(entity).uuid);
+    if (it != m_entitiesByUUID.end() && it->second == entity)
     {
-        return meshRenderer;
+        m_entitiesByUUID.erase(it);
     }
+}
+
+void Scene::onNameAssigned(entt::registry& registry, entt::entity entity)
+{
+    // Renames may be patched from worker systems
+    std::lock_guard<std::mutex> lock(m_signalMutex);
+    unindexName(entity);
+
+    StringId name = registry.get<NameComponent>(entity).name;
+    if (name.empty()) return;
+
+    const auto index = entt::to_entity(entity);
+    if (index >= m_nameSlots.size()) m_nameSlots.resize(index + 1);
+
+    auto& entities = m_entitiesByName[name];
+    m_nameSlots[index] = { name, static_cast<uint32_t>(entities.size()) };
+    entities.push_back(entity);
+}
+
+void Scene::onNameDestroyed(entt::registry& registry, entt::entity entity)
+{
+    UNUSED(registry);
+    std::lock_guard<std::mutex> lock(m_signalMutex);
+    unindexName(entity);
+}
+
+void Scene::unindexName(entt::entity entity)
+{
+    // The component already holds the new name on update, the old one is in the slot
+    const auto index = entt::to_entity(entity);
+    if (index >= m_nameSlots.size() || m_nameSlots[index].name.empty()) return;
 
-    auto material = resourceManager.loadMaterial(materialPath);
-    if (!material) 
+    NameSlot& slot = m_nameSlots[index];
+    auto it = m_entitiesByName.find(slot.name);
+    std::vector<entt::entity>& entities = it->second;
+
+    // Swap-remove, the entity moved into the gap takes over the position
+    entt::entity moved = entities.back();
+    entities[slot.position] = moved;
+    m_nameSlots[entt::to_entity(moved)].position = slot.position;
+    entities.pop_back();
+    if (entities.empty()) m_entitiesByName.erase(it);
+
+    slot = {};
+}
+
+void Scene::deserializeComponents(entt::entity entity, const json& components, ResourceManager& resourceManager,
+                                  const ComponentValues* defaults)
+{
+    StagedEntity staged;
+    stageComponents(components, resourceManager, staged, defaults);
+    applyComponents(entity, staged);
+}
+
+void Scene::stageComponents(const json& components, ResourceManager& resourceManager, StagedEntity& staged,
+                            const ComponentValues* defaults)
+{
+    for (auto& component : components) 
     {
-        return meshRenderer;
+        // Unknown types are ignored, files may carry components this build doesn't have
+        ComponentSerializer::readJson(component["type"].get<std::string>(), component.value("data", json::object()),
+            resourceManager, staged.components, defaults);
     }
-    
-    meshRenderer.meshData = meshData;
-    meshRenderer.material = material;
-    meshRenderer.castShadows = obj["castShadows"].get<bool>();
+}
 
-    return meshRenderer;
+void Scene::applyComponents(entt::entity entity, const StagedEntity& staged)
+{
+    // Replaces so prefab instances can override template components
+    ComponentSerializer::apply(m_registry, entity, staged.components);
 }
 
-LightComponent Scene::deserializeLight(const json& obj)
+void Scene::deserializePrefabInstances(const json& obj, ResourceManager& resourceManager, uint32_t source)
 {
-    LightComponent light;
-    light.position = JsonUtils::parseVec3(obj["position"]);
-    light.direction = JsonUtils::parseVec3(obj["direction"]);
-    light.color = JsonUtils::parseVec3(obj["color"]);
-    light.power = obj["power"].get<float>();
-    light.type = static_cast<LightType>(obj["type"].get<int>());
+    auto prefab = loadPrefab(obj["prefab"].get<std::string>(), resourceManager);
+    if (!prefab) return;
 
-    return light;
+    const json& instances = obj["instances"];
+
+    std::vector<entt::entity> entities;
+    instantiatePrefab(prefab, instances.size(), entities);
+    m_registry.insert<SceneSourceComponent>(entities.begin(), entities.end(), SceneSourceComponent{ source });
+
+    // Per-instance overrides
+    for (size_t i = 0; i < entities.size(); i++)
+    {
+        const json& instance = instances[i];
+        if (instance.contains("uuid"))
+        {
+            setUUID(entities[i], instance["uuid"].get<UUID>());
+        }
+        if (auto name = instance.value("name", std::string()); !name.empty())
+        {
+            m_registry.emplace<NameComponent>(entities[i], StringId(name));
+        }
+        if (instance.contains("components"))
+        {
+            deserializeComponents(entities[i], instance["components"], resourceManager, &prefab->components);
+        }
+    }
 }
 
 }   
\ No newline at end of file
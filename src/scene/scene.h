@@ -1,35 +1,212 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <optional>
 #include <entt/entity/registry.hpp>
+#include <entt/signal/sigh.hpp>
 #include <nlohmann/json.hpp>
 #include "core/resource_manager.h"
 #include "components.h"
+#include "component_meta.h"
+#include "dynamic_bvh.h"
+#include "prefab.h"
+#include "entity_pool.h"
 
 namespace Engine {
 
 using json = nlohmann::json;
 
+struct RaycastHit
+{
+    entt::entity entity = entt::null;
+    float distance = 0.0f;
+    glm::vec3 point = glm::vec3(0.0f);
+};
+
+// Reference to an entity by persistent id. The cached handle makes repeated resolves
+// skip the hash lookup, and is refreshed when the entity is reloaded.
+struct EntityRef
+{
+    UUID uuid = 0;
+    entt::entity entity = entt::null;
+};
+
+// Entity parsed without touching the registry, so it can be prepared off the
+// main thread and created later
+struct StagedEntity
+{
+    StringId name;
+    UUID uuid = 0;
+    std::shared_ptr<const Prefab> prefab;
+    ComponentValues components; // Overrides of the prefab's, missing fields inherit its values
+};
+
+// Scene file merged into a Scene, its entities carry the id in SceneSourceComponent
+struct SceneSource
+{
+    uint32_t id = 0;
+    std::string path;
+};
+
 class Scene 
 {
 public:
-    Scene() = default;
+    Scene();
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
     
     entt::registry& getRegistry()
     {
         return m_registry;
     }
 
+    const DynamicBVH& getSpatialIndex() const
+    {
+        return m_spatialIndex;
+    }
+
+    // Clears everything, notifying onCleared first
     void newScene();
     bool loadScene(const std::string& path, ResourceManager& resourceManager);
 
+    // JSON, or the binary format for ".scene" files. Prefab instances are written
+    // as their prefab path plus the components they override.
+    bool saveScene(const std::string& path) const;
+    static bool isBinarySceneFile(const std::string& path);
+
+    // Additive loading: merges a scene file into the registry under a new source id,
+    // returns 0 on failure. Unloading and reloading destroy only that source's entities;
+    // resources the remaining entities still use stay loaded (and resident on the GPU).
+    uint32_t addScene(const std::string& path, ResourceManager& resourceManager);
+    void unloadSource(uint32_t source, ResourceManager& resourceManager);
+    bool reloadSource(uint32_t source, ResourceManager& resourceManager);
+
+    // Fired by newScene before the registry is cleared, for whoever tracks entities
+    // it created in this scene (the world streamer)
+    entt::sink<entt::sigh<void()>> onCleared()
+    {
+        return entt::sink{ m_clearedSignal };
+    }
+
+    uint32_t addSource(const std::string& path);
+    const std::vector<SceneSource>& getSources() const
+    {
+        return m_sources;
+    }
+
+    std::shared_ptr<const Prefab> loadPrefab(const std::string& path, ResourceManager& resourceManager);
+
+    // Creates count entities sharing the prefab's component data in one bulk registry
+    // operation. Shared components aren't copied, read them through findComponent.
+    void instantiatePrefab(const std::shared_ptr<const Prefab>& prefab, size_t count, std::vector<entt::entity>& entities);
+
+    // Pool recycling instances of the prefab, created on first use. Pools (and the
+    // references returned here) are dropped by newScene.
+    EntityPool& getPool(const std::shared_ptr<const Prefab>& prefab);
+
+    // Any thread: queues the entity for destruction at the end of the frame
+    void destroyDeferred(entt::entity entity);
+
+    // Main thread, frame end: parks entities released to pools, then destroys
+    // everything queued in one batch
+    void flushDestroyed();
+
+    // Persistent id lookups through the UUID index
+    entt::entity findEntity(UUID uuid) const;
+    EntityRef makeRef(entt::entity entity) const;
+
+    // Name lookups through the name index, integer compares on interned names
+    entt::entity findEntityByName(StringId name) const;
+    void findEntitiesByName(StringId name, std::vector<entt::entity>& entities) const;
+    entt::entity resolve(EntityRef& ref) const;
+
+    // Parses a JSON entity array (plain entities and prefab instances), safe to call from
+    // any thread as long as the resource manager is
+    bool stageEntities(const json& entities, ResourceManager& resourceManager, std::vector<StagedEntity>& staged);
+    bool stageEntity(const json& entity, ResourceManager& resourceManager, std::vector<StagedEntity>& staged);
+    bool stageBinary(const std::vector<uint8_t>& data, ResourceManager& resourceManager, std::vector<StagedEntity>& staged);
+    entt::entity createEntity(const StagedEntity& staged, uint32_t source = 0);
+
+    // Refits the spatial index for entities whose transform or mesh changed, on the
+    // calling thread
+    void updateSpatialIndex();
+
+    // The same in three steps, so systems can compute the bounds on workers:
+    // prepareWorldBounds (main thread, adds WorldBoundsComponent), computeWorldBounds
+    // for every BoundsDirty entity with a WorldBoundsComponent (any thread), then
+    // refitSpatialIndex (main thread, clears BoundsDirty)
+    void prepareWorldBounds();
+    void computeWorldBounds(entt::entity entity, const TransformComponent& transform, WorldBoundsComponent& bounds) const;
+    void refitSpatialIndex();
+
+    // Closest mesh triangle hit, narrowed through the spatial index then per-mesh BVHs
+    bool raycast(const Ray& ray, RaycastHit& hit) const;
+
 private:
     entt::registry m_registry;
+    DynamicBVH m_spatialIndex;
+    entt::sigh<void()> m_clearedSignal;
+
+    // Systems may patch components from worker threads, every signal handler
+    // touching the indices below locks it
+    std::mutex m_signalMutex;
+
+    void onBoundsSourceChanged(entt::registry& registry, entt::entity entity);
+    void onBoundsSourceDestroyed(entt::registry& registry, entt::entity entity);
+    void onMeshRendererDestroyed(entt::registry& registry, entt::entity entity);
+    void onWorldBoundsDestroyed(entt::registry& registry, entt::entity entity);
+    void removeFromSpatialIndex(entt::registry& registry, entt::entity entity);
+
+    // Prefab instances to re-index with the prefab's mesh
+    std::vector<entt::entity> m_revertedOverrides;
+
+    std::unordered_map<UUID, entt::entity> m_entitiesByUUID;
+
+    void setUUID(entt::entity entity, UUID uuid);
+    void onUUIDAssigned(entt::registry& registry, entt::entity entity);
+    void onUUIDDestroyed(entt::registry& registry, entt::entity entity);
+
+    // Per entity index, its indexed name and position in that name's list, so renames
+    // and destroys swap-remove without scanning
+    struct NameSlot
+    {
+        StringId name;
+        uint32_t position = 0;
+    };
+
+    std::unordered_map<StringId, std::vector<entt::entity>> m_entitiesByName;
+    std::vector<NameSlot> m_nameSlots;
+
+    void onNameAssigned(entt::registry& registry, entt::entity entity);
+    void onNameDestroyed(entt::registry& registry, entt::entity entity);
+    void unindexName(entt::entity entity);
+
+    std::vector<SceneSource> m_sources;
+    uint32_t m_nextSourceId = 1;
+
+    bool loadEntities(const std::string& path, ResourceManager& resourceManager, uint32_t source);
+    void destroySourceEntities(uint32_t source);
+
+    std::unordered_map<const Prefab*, std::unique_ptr<EntityPool>> m_pools;
+    std::vector<entt::entity> m_pendingDestroy;
+    std::mutex m_destroyMutex;
+
+    // Owns every prefab the registry's instances point at, by path
+    std::unordered_map<std::string, std::shared_ptr<const Prefab>> m_prefabs;
+    std::mutex m_prefabMutex;
+
+    std::shared_ptr<const Prefab> adoptPrefab(const std::shared_ptr<const Prefab>& prefab);
+
+    void deserializeComponents(entt::entity entity, const json& components, ResourceManager& resourceManager,
+                               const ComponentValues* defaults = nullptr);
+    void stageComponents(const json& components, ResourceManager& resourceManager, StagedEntity& staged,
+                         const ComponentValues* defaults = nullptr);
+    void applyComponents(entt::entity entity, const StagedEntity& staged);
+    void deserializePrefabInstances(const json& obj, ResourceManager& resourceManager, uint32_t source);
 
-    TransformComponent deserializeTransform(const json& obj);
-    CameraComponent deserializeCamera(const json& obj);
-    MeshRendererComponent deserializeMeshRenderer(const json& obj, ResourceManager& resourceManager);
-    LightComponent deserializeLight(const json& obj);
 };
 
 }
@@ -0,0 +1,147 @@
+#include "scene_loader.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include "core/file_system.h"
+
+namespace Engine {
+
+using json = nlohmann::json;
+
+// Share of the progress bar spent staging (parsing + resource loading), the rest
+// is entity creation
+const float STAGING_PROGRESS = 0.9f;
+
+SceneLoader::~SceneLoader()
+{
+    cancel();
+    reapCancelled(true);
+}
+
+void SceneLoader::start(const std::string& path, ResourceManager& resourceManager, CompletionCallback onComplete)
+{
+    cancel();
+
+    m_path = path;
+    m_current = std::make_unique<Load>();
+    m_current->onComplete = std::move(onComplete);
+    m_current->thread = std::thread(&SceneLoader::load, std::ref(*m_current), path, &resourceManager);
+}
+
+void SceneLoader::cancel()
+{
+    if (!m_current) return;
+
+    // The thread checks the flag between entities; the Load outlives it in m_cancelled
+    m_current->cancelled.store(true, std::memory_order_relaxed);
+    if (m_current->onComplete) m_current->onComplete(false);
+    m_cancelled.push_back(std::move(m_current));
+}
+
+std::unique_ptr<Scene> SceneLoader::takeLoaded()
+{
+    reapCancelled(false);
+    if (!m_current || !m_current->finished.load(std::memory_order_acquire)) return nullptr;
+
+    // Finished is stored right before the thread returns, so this doesn't block
+    std::unique_ptr<Load> done = std::move(m_current);
+    done->thread.join();
+
+    if (done->onComplete) done->onComplete(done->result != nullptr);
+    return std::move(done->result);
+}
+
+void SceneLoader::reapCancelled(bool wait)
+{
+    std::erase_if(m_cancelled, [wait](std::unique_ptr<Load>& state)
+    {
+        if (!wait && !state->finished.load(std::memory_order_acquire)) return false;
+        state->thread.join();
+        return true;
+    });
+}
+
+void SceneLoader::load(Load& state, std::string path, ResourceManager* resourceManager)
+{
+    // The staging scene isn't reachable from the main thread until it's handed over,
+    // so its registry is filled here as well
+    auto scene = std::make_unique<Scene>();
+    uint32_t source = scene->addSource(path);
+    std::vector<StagedEntity> staged;
+
+    bool success = Scene::isBinarySceneFile(path)
+        ? stageBinary(state, path, *scene, *resourceManager, staged)
+        : stageJson(state, path, *scene, *resourceManager, staged);
+
+    const float stagedCount = static_cast<float>(std::max<size_t>(staged.size(), 1));
+    for (size_t i = 0; success && i < staged.size(); i++)
+    {
+        if (state.cancelled.load(std::memory_order_relaxed))
+        {
+            success = false;
+            break;
+        }
+        scene->createEntity(staged[i], source);
+        state.progress.store(STAGING_PROGRESS + (1.0f - STAGING_PROGRESS) * static_cast<float>(i + 1) / stagedCount,
+            std::memory_order_relaxed);
+    }
+
+    if (success) scene->updateSpatialIndex();
+
+    if (success) state.result = std::move(scene);
+    state.finished.store(true, std::memory_order_release);
+}
+
+bool SceneLoader::stageJson(Load& state, const std::string& path, Scene& scene, ResourceManager& resourceManager, std::vector<StagedEntity>& staged)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open scene file: " << path << std::endl;
+        return false;
+    }
+
+    json entities;
+    try
+    {
+        json j;
+        file >> j;
+        entities = std::move(j.at("entities"));
+    }
+    catch (json::exception& e)
+    {
+        std::cerr << "JSON error in scene file " << path << ":\n"
+                  << "  ID: " << e.id << "\n"
+                  << "  Message: " << e.what() << std::endl;
+        return false;
+    }
+
+    const float entityCount = static_cast<float>(std::max<size_t>(entities.size(), 1));
+    size_t index = 0;
+    for (auto& e : entities)
+    {
+        if (state.cancelled.load(std::memory_order_relaxed) || !scene.stageEntity(e, resourceManager, staged))
+        {
+            return false;
+        }
+        state.progress.store(STAGING_PROGRESS * static_cast<float>(++index) / entityCount, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+bool SceneLoader::stageBinary(Load& state, const std::string& path, Scene& scene, ResourceManager& resourceManager, std::vector<StagedEntity>& staged)
+{
+    // No per-entity progress, binary scenes are read in one pass
+    std::vector<uint8_t> data;
+    if (!FileSystem::readBinary(path, data) || !scene.stageBinary(data, resourceManager, staged))
+    {
+        std::cerr << "Failed to load binary scene file: " << path << std::endl;
+        return false;
+    }
+
+    state.progress.store(STAGING_PROGRESS, std::memory_order_relaxed);
+    return !state.cancelled.load(std::memory_order_relaxed);
+}
+
+}
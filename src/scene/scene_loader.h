@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include "core/resource_manager.h"
+#include "scene.h"
+
+namespace Engine {
+
+// Loads a scene file on a background thread into a staging Scene, so opening a
+// large scene never blocks a frame. The main thread polls takeLoaded() at a frame
+// boundary and swaps the result in; GPU uploads then happen as the renderer
+// picks up the new entities.
+class SceneLoader
+{
+public:
+    // Main thread, once per load: true with the scene handed out by takeLoaded,
+    // false on failure or cancellation
+    using CompletionCallback = std::function<void(bool loaded)>;
+
+    SceneLoader() = default;
+    ~SceneLoader();
+
+    SceneLoader(const SceneLoader&) = delete;
+    SceneLoader& operator=(const SceneLoader&) = delete;
+
+    // Starts loading, cancelling any load already in progress
+    void start(const std::string& path, ResourceManager& resourceManager, CompletionCallback onComplete = nullptr);
+
+    // Signals the current load to stop and discards its result without waiting for
+    // the thread, which is joined by a later takeLoaded once it has wound down
+    void cancel();
+
+    // Main thread: the finished scene, or null while loading (or after a failure)
+    std::unique_ptr<Scene> takeLoaded();
+
+    bool isLoading() const { return m_current != nullptr; }
+    float getProgress() const { return m_current ? m_current->progress.load(std::memory_order_relaxed) : 0.0f; }
+    const std::string& getPath() const { return m_path; }
+
+private:
+    struct Load
+    {
+        std::thread thread;
+        std::atomic<bool> cancelled = false;
+        std::atomic<bool> finished = false; // Set last, result is complete once it's seen
+        std::atomic<float> progress = 0.0f;
+        std::unique_ptr<Scene> result;
+        CompletionCallback onComplete;
+    };
+
+    static void load(Load& state, std::string path, ResourceManager* resourceManager);
+    static bool stageJson(Load& state, const std::string& path, Scene& scene, ResourceManager& resourceManager, std::vector<StagedEntity>& staged);
+    static bool stageBinary(Load& state, const std::string& path, Scene& scene, ResourceManager& resourceManager, std::vector<StagedEntity>& staged);
+    void reapCancelled(bool wait);
+
+    std::string m_path;
+    std::unique_ptr<Load> m_current;
+    std::vector<std::unique_ptr<Load>> m_cancelled; // Threads still winding down
+};
+
+}
@@ -0,0 +1,304 @@
+#include "world_streamer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include "core/assert.h"
+
+namespace Engine {
+
+using json = nlohmann::json;
+
+const uint32_t LOADER_THREADS = 2;
+
+WorldStreamer::WorldStreamer()
+{
+    for (uint32_t i = 0; i < LOADER_THREADS; i++)
+    {
+        m_loaders.emplace_back(&WorldStreamer::loaderLoop, this);
+    }
+}
+
+WorldStreamer::~WorldStreamer()
+{
+    close();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_requestCondition.notify_all();
+
+    for (auto& loader : m_loaders)
+    {
+        loader.join();
+    }
+}
+
+bool WorldStreamer::isWorldFile(const std::string& path)
+{
+    const std::string extension = ".world.json";
+    return path.size() >= extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+bool WorldStreamer::open(const std::string& path, Scene& scene, ResourceManager& resourceManager)
+{
+    close();
+
+    // Resident entities come from the manifest's own "entities" array
+    if (!scene.loadScene(path, resourceManager)) return false;
+
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open world file: " << path << std::endl;
+        return false;
+    }
+
+    try
+    {
+        json j;
+        file >> j;
+
+        m_cellSize = j.value("cellSize", 32.0f);
+        m_loadRadius = j.value("loadRadius", 2.0f * m_cellSize);
+        m_unloadRadius = std::max(j.value("unloadRadius", 3.0f * m_cellSize), m_loadRadius);
+
+        for (auto& c : j["cells"])
+        {
+            Cell& cell = m_cells.emplace_back();
+            cell.coord = glm::ivec2(c["x"].get<int>(), c["z"].get<int>());
+            cell.path = c["path"].get<std::string>();
+        }
+    }
+    catch (json::exception& e)
+    {
+        std::cerr << "JSON error in world file " << path << ":\n"
+                  << "  ID: " << e.id << "\n"
+                  << "  Message: " << e.what() << std::endl;
+        m_cells.clear();
+        return false;
+    }
+
+    // Its cells' entities go away with the registry if the scene is cleared
+    scene.onCleared().connect<&WorldStreamer::close>(*this);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_scene = &scene;
+    m_resourceManager = &resourceManager;
+    return true;
+}
+
+void WorldStreamer::close()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_requests.clear();
+        m_idleCondition.wait(lock, [this]() { return m_inFlight == 0; });
+        m_results.clear();
+
+        if (m_scene) m_scene->onCleared().disconnect<&WorldStreamer::close>(*this);
+        m_scene = nullptr;
+        m_resourceManager = nullptr;
+    }
+
+    m_cells.clear();
+    m_merging.clear();
+    m_loadedCells = 0;
+    m_pendingCells = 0;
+}
+
+void WorldStreamer::update(Scene& scene)
+{
+    if (!m_scene) return;
+    ASSERT(&scene == m_scene, "Streaming into a different scene than the one opened");
+
+    // Pick up finished loads
+    std::vector<LoadResult> results;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        results.swap(m_results);
+    }
+
+    for (auto& result : results)
+    {
+        Cell& cell = m_cells[result.cell];
+        if (cell.generation != result.generation || cell.state != CellState::Loading) continue;
+
+        if (!result.success)
+        {
+            // Don't retry a broken cell every frame
+            cell.state = CellState::Loaded;
+            continue;
+        }
+
+        cell.staged = std::move(result.staged);
+        cell.mergeCursor = 0;
+        cell.state = CellState::Merging;
+        m_merging.push_back(result.cell);
+    }
+
+    // Distances are measured on the XZ plane from the active camera
+    entt::registry& registry = scene.getRegistry();
+    glm::vec2 viewer(0.0f);
+    auto cameraView = registry.view<TransformComponent, ActiveCamera>();
+    if (auto camera = cameraView.front(); camera != entt::null)
+    {
+        const glm::vec3& position = registry.get<TransformComponent>(camera).position;
+        viewer = glm::vec2(position.x, position.z);
+    }
+
+    std::vector<std::pair<float, uint32_t>> toLoad;
+    bool unloaded = false;
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(m_cells.size()); i++)
+    {
+        Cell& cell = m_cells[i];
+        float distance = glm::distance(viewer, cellCenter(cell));
+
+        if (cell.state == CellState::Unloaded)
+        {
+            if (distance <= m_loadRadius) toLoad.push_back({ distance, i });
+        }
+        else if (distance > m_unloadRadius)
+        {
+            // Hysteresis between the two radii keeps border cells from thrashing
+            unloadCell(scene, cell);
+            std::erase(m_merging, i);
+            unloaded = true;
+        }
+    }
+
+    // Nearest cells first
+    if (!toLoad.empty())
+    {
+        std::sort(toLoad.begin(), toLoad.end());
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto& candidate : toLoad)
+            {
+                uint32_t index = candidate.second;
+                Cell& cell = m_cells[index];
+                cell.state = CellState::Loading;
+                m_requests.push_back({ index, cell.generation, cell.path });
+            }
+        }
+        m_requestCondition.notify_all();
+    }
+
+    // Bounded merge, so a burst of finished cells doesn't stall a frame
+    uint32_t budget = m_mergeBudget;
+    while (budget > 0 && !m_merging.empty())
+    {
+        Cell& cell = m_cells[m_merging.front()];
+        while (budget > 0 && cell.mergeCursor < cell.staged.size())
+        {
+            entt::entity entity = scene.createEntity(cell.staged[cell.mergeCursor++]);
+            scene.getRegistry().emplace<Streamed>(entity);
+            cell.entities.push_back(entity);
+            budget--;
+        }
+
+        if (cell.mergeCursor == cell.staged.size())
+        {
+            cell.staged.clear();
+            cell.staged.shrink_to_fit();
+            cell.state = CellState::Loaded;
+            m_merging.erase(m_merging.begin());
+        }
+    }
+
+    if (unloaded)
+    {
+        m_resourceManager->collectUnused();
+    }
+
+    m_loadedCells = 0;
+    m_pendingCells = 0;
+    for (const Cell& cell : m_cells)
+    {
+        if (cell.state == CellState::Loaded) m_loadedCells++;
+        else if (cell.state != CellState::Unloaded) m_pendingCells++;
+    }
+}
+
+void WorldStreamer::unloadCell(Scene& scene, Cell& cell)
+{
+    entt::registry& registry = scene.getRegistry();
+    for (auto entity : cell.entities)
+    {
+        // Entities may have been deleted in the editor meanwhile
+        if (registry.valid(entity)) registry.destroy(entity);
+    }
+
+    if (cell.state == CellState::Loading)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::erase_if(m_requests, [&](const LoadRequest& request) { return request.path == cell.path; });
+    }
+
+    cell.entities.clear();
+    cell.staged.clear();
+    cell.staged.shrink_to_fit();
+    cell.mergeCursor = 0;
+    cell.generation++;
+    cell.state = CellState::Unloaded;
+}
+
+glm::vec2 WorldStreamer::cellCenter(const Cell& cell) const
+{
+    return (glm::vec2(cell.coord) + 0.5f) * m_cellSize;
+}
+
+void WorldStreamer::loaderLoop()
+{
+    while (true)
+    {
+        LoadRequest request;
+        Scene* scene;
+        ResourceManager* resourceManager;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_requestCondition.wait(lock, [this]() { return m_stopping || !m_requests.empty(); });
+
+            if (m_stopping) return;
+
+            request = std::move(m_requests.front());
+            m_requests.pop_front();
+            scene = m_scene;
+            resourceManager = m_resourceManager;
+            m_inFlight++;
+        }
+
+        LoadResult result{ request.cell, request.generation, false, {} };
+
+        std::ifstream file(request.path);
+        if (file.is_open())
+        {
+            try
+            {
+                json j;
+                file >> j;
+                result.success = scene->stageEntities(j["entities"], *resourceManager, result.staged);
+            }
+            catch (json::exception& e)
+            {
+                std::cerr << "JSON error in cell file " << request.path << ": " << e.what() << std::endl;
+            }
+        }
+        else
+        {
+            std::cerr << "Failed to open cell file: " << request.path << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_results.push_back(std::move(result));
+            m_inFlight--;
+        }
+        m_idleCondition.notify_all();
+    }
+}
+
+}
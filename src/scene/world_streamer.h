@@ -0,0 +1,117 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <glm/glm.hpp>
+#include <entt/entity/registry.hpp>
+#include "core/resource_manager.h"
+#include "scene.h"
+
+namespace Engine {
+
+// Streams the cells of a partitioned world around the active camera.
+//
+// A world manifest ("*.world.json") holds the always-resident entities (camera,
+// lights) in the usual "entities" array plus a list of cells, each a separate
+// entity file covering one cellSize x cellSize square on the XZ plane:
+//   { "cellSize": 32, "loadRadius": 64, "unloadRadius": 96, "entities": [...],
+//     "cells": [ { "x": 0, "z": 0, "path": "..." } ] }
+//
+// Cells are parsed and their resources loaded on loader threads, then created in
+// the registry on the main thread at most mergeBudget entities per frame.
+class WorldStreamer
+{
+public:
+    WorldStreamer();
+    ~WorldStreamer();
+
+    WorldStreamer(const WorldStreamer&) = delete;
+    WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+    static bool isWorldFile(const std::string& path);
+
+    // Loads the manifest and its resident entities into the scene (replacing it).
+    // Streaming stops when the scene is cleared.
+    bool open(const std::string& path, Scene& scene, ResourceManager& resourceManager);
+
+    // Stops streaming, waits for in-flight loads, leaves the scene as is
+    void close();
+
+    // Main thread: schedules loads/unloads and merges finished cells
+    void update(Scene& scene);
+
+    bool isOpen() const { return m_scene != nullptr; }
+    uint32_t getCellCount() const { return static_cast<uint32_t>(m_cells.size()); }
+    uint32_t getLoadedCellCount() const { return m_loadedCells; }
+    uint32_t getPendingCellCount() const { return m_pendingCells; }
+
+    void setMergeBudget(uint32_t entitiesPerFrame) { m_mergeBudget = entitiesPerFrame; }
+
+private:
+    enum class CellState
+    {
+        Unloaded,
+        Loading,   // Queued or being parsed on a loader thread
+        Merging,   // Staged, being created in the registry over several frames
+        Loaded
+    };
+
+    struct Cell
+    {
+        glm::ivec2 coord;
+        std::string path;
+        CellState state = CellState::Unloaded;
+        uint32_t generation = 0; // Bumped on cancel so stale results are dropped
+
+        std::vector<StagedEntity> staged;
+        size_t mergeCursor = 0;
+        std::vector<entt::entity> entities;
+    };
+
+    struct LoadRequest
+    {
+        uint32_t cell;
+        uint32_t generation;
+        std::string path;
+    };
+
+    struct LoadResult
+    {
+        uint32_t cell;
+        uint32_t generation;
+        bool success;
+        std::vector<StagedEntity> staged;
+    };
+
+    void loaderLoop();
+    void unloadCell(Scene& scene, Cell& cell);
+    glm::vec2 cellCenter(const Cell& cell) const;
+
+    // Owned by the main thread
+    std::vector<Cell> m_cells;
+    std::vector<uint32_t> m_merging;
+    Scene* m_scene = nullptr;
+    ResourceManager* m_resourceManager = nullptr;
+    float m_cellSize = 32.0f;
+    float m_loadRadius = 64.0f;
+    float m_unloadRadius = 96.0f;
+    uint32_t m_mergeBudget = 256;
+    uint32_t m_loadedCells = 0;
+    uint32_t m_pendingCells = 0;
+
+    // Shared with loader threads
+    std::vector<std::thread> m_loaders;
+    std::deque<LoadRequest> m_requests;
+    std::vector<LoadResult> m_results;
+    uint32_t m_inFlight = 0;
+    bool m_stopping = false;
+    std::mutex m_mutex;
+    std::condition_variable m_requestCondition;
+    std::condition_variable m_idleCondition;
+};
+
+}
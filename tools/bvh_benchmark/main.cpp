@@ -0,0 +1,321 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "common/command_line.h"
+#include "core/bounds.h"
+#include "scene/dynamic_bvh.h"
+
+// Compares the scene's DynamicBVH against a linear scan over the same boxes
+// for building, refitting moved entities and AABB/frustum/ray queries.
+// Entity density is kept constant, so the populated volume grows with the count.
+
+using namespace Engine;
+using Clock = std::chrono::steady_clock;
+
+// Larger counts are certainly a typo, the benchmark would only run out of memory
+const uint32_t MAX_COUNT = 100000000;
+
+struct BenchmarkSettings
+{
+    std::vector<uint32_t> counts = { 10000, 100000, 1000000 };
+    uint32_t queries = 256;
+    float movedFraction = 0.1f; // Entities moved per refit pass
+    uint32_t seed = 1;
+};
+
+struct World
+{
+    std::vector<AABB> boxes;
+    float extent = 0.0f;
+};
+
+static double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static AABB makeBox(const glm::vec3& center, float halfSize)
+{
+    return { center - glm::vec3(halfSize), center + glm::vec3(halfSize) };
+}
+
+static World makeWorld(uint32_t count, std::mt19937& rng)
+{
+    // Roughly one entity per 8 cubic units
+    World world;
+    world.extent = 0.5f * std::cbrt(8.0f * static_cast<float>(count));
+
+    std::uniform_real_distribution<float> position(-world.extent, world.extent);
+    std::uniform_real_distribution<float> size(0.1f, 1.0f);
+
+    world.boxes.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        world.boxes.push_back(makeBox(glm::vec3(position(rng), position(rng), position(rng)), size(rng)));
+    }
+
+    return world;
+}
+
+static void printRow(const char* name, double bvhMs, double linearMs, uint64_t bvhHits, uint64_t linearHits)
+{
+    std::cout << "  " << std::left << std::setw(10) << name << std::right
+        << std::fixed << std::setprecision(3)
+        << std::setw(12) << bvhMs << " ms"
+        << std::setw(12) << linearMs << " ms"
+        << std::setw(10) << std::setprecision(1) << (bvhMs > 0.0 ? linearMs / bvhMs : 0.0) << "x";
+
+    if (bvhHits != linearHits)
+    {
+        std::cout << "  MISMATCH " << bvhHits << " vs " << linearHits;
+    }
+
+    std::cout << "\n";
+}
+
+static void runBenchmark(uint32_t count, const BenchmarkSettings& settings)
+{
+    std::mt19937 rng(settings.seed);
+    World world = makeWorld(count, rng);
+
+    std::cout << count << " entities (extent " << world.extent << ")\n"
+        << "  " << std::left << std::setw(10) << "" << std::right
+        << std::setw(15) << "bvh" << std::setw(15) << "linear" << std::setw(11) << "speedup" << "\n";
+
+    // Build
+    DynamicBVH bvh;
+    std::vector<int32_t> proxies(count);
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        proxies[i] = bvh.insert(world.boxes[i], i);
+    }
+    double bvhBuild = elapsedMs(start);
+
+    std::vector<AABB> linear;
+    start = Clock::now();
+    linear.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        linear.push_back(world.boxes[i]);
+    }
+    double linearBuild = elapsedMs(start);
+    printRow("build", bvhBuild, linearBuild, bvh.getProxyCount(), linear.size());
+
+    // Refit: most moves stay inside the fat box, a few jump far enough to reinsert
+    uint32_t movedCount = static_cast<uint32_t>(static_cast<float>(count) * settings.movedFraction);
+    std::uniform_int_distribution<uint32_t> pick(0, count - 1);
+    std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+    std::uniform_real_distribution<float> jump(-2.0f, 2.0f);
+    std::vector<std::pair<uint32_t, AABB>> moves;
+    moves.reserve(movedCount);
+    for (uint32_t i = 0; i < movedCount; ++i)
+    {
+        uint32_t index = pick(rng);
+        glm::vec3 offset = (i % 10 == 0) ? glm::vec3(jump(rng), jump(rng), jump(rng)) : glm::vec3(jitter(rng), jitter(rng), jitter(rng));
+        const AABB& box = world.boxes[index];
+        moves.emplace_back(index, AABB{ box.min + offset, box.max + offset });
+    }
+
+    uint64_t reinserted = 0;
+    start = Clock::now();
+    for (const auto& [index, box] : moves)
+    {
+        reinserted += bvh.update(proxies[index], box) ? 1 : 0;
+        world.boxes[index] = box;
+    }
+    double bvhRefit = elapsedMs(start);
+
+    start = Clock::now();
+    for (const auto& [index, box] : moves)
+    {
+        linear[index] = box;
+    }
+    double linearRefit = elapsedMs(start);
+    printRow("refit", bvhRefit, linearRefit, movedCount, moves.size());
+    std::cout << "  " << reinserted << " of " << movedCount << " moves reinserted, tree height " << bvh.getHeight() << "\n";
+
+    // Query inputs
+    std::uniform_real_distribution<float> position(-world.extent, world.extent);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<AABB> boxQueries;
+    std::vector<Frustum> frustumQueries;
+    std::vector<Ray> rayQueries;
+    for (uint32_t i = 0; i < settings.queries; ++i)
+    {
+        glm::vec3 center(position(rng), position(rng), position(rng));
+        boxQueries.push_back(makeBox(center, 4.0f));
+
+        glm::vec3 direction = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 0.001f));
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 50.0f);
+        glm::mat4 view = glm::lookAt(center, center + direction, glm::vec3(0.0f, 1.0f, 0.0f));
+        frustumQueries.push_back(BoundsUtils::extractFrustum(projection * view));
+
+        rayQueries.push_back({ center, direction });
+    }
+
+    // AABB queries, BVH candidates are tested against the tight box like Scene does
+    uint64_t bvhHits = 0;
+    start = Clock::now();
+    for (const AABB& query : boxQueries)
+    {
+        bvh.queryAABB(query, [&](int32_t proxy)
+        {
+            bvhHits += world.boxes[bvh.getUserData(proxy)].overlaps(query) ? 1 : 0;
+            return true;
+        });
+    }
+    double bvhBox = elapsedMs(start);
+
+    uint64_t linearHits = 0;
+    start = Clock::now();
+    for (const AABB& query : boxQueries)
+    {
+        for (const AABB& box : linear)
+        {
+            linearHits += box.overlaps(query) ? 1 : 0;
+        }
+    }
+    double linearBox = elapsedMs(start);
+    printRow("aabb", bvhBox, linearBox, bvhHits, linearHits);
+
+    // Frustum queries
+    bvhHits = 0;
+    start = Clock::now();
+    for (const Frustum& query : frustumQueries)
+    {
+        bvh.queryFrustum(query, [&](int32_t proxy, bool fullyInside)
+        {
+            const AABB& box = world.boxes[bvh.getUserData(proxy)];
+            bvhHits += (fullyInside || BoundsUtils::testFrustum(query, box) != FrustumTest::Outside) ? 1 : 0;
+        });
+    }
+    double bvhFrustum = elapsedMs(start);
+
+    linearHits = 0;
+    start = Clock::now();
+    for (const Frustum& query : frustumQueries)
+    {
+        for (const AABB& box : linear)
+        {
+            linearHits += BoundsUtils::testFrustum(query, box) != FrustumTest::Outside ? 1 : 0;
+        }
+    }
+    double linearFrustum = elapsedMs(start);
+    printRow("frustum", bvhFrustum, linearFrustum, bvhHits, linearHits);
+
+    // Closest hit ray queries, the hit count is the number of rays that hit anything
+    const float maxDistance = 100.0f;
+    bvhHits = 0;
+    start = Clock::now();
+    for (const Ray& query : rayQueries)
+    {
+        const glm::vec3 invDirection = BoundsUtils::inverseDirection(query.direction);
+        float closest = maxDistance;
+        bvh.queryRay(query, maxDistance, [&](int32_t proxy, float currentMax)
+        {
+            float distance;
+            if (BoundsUtils::intersectRay(query, invDirection, world.boxes[bvh.getUserData(proxy)], currentMax, distance))
+            {
+                closest = distance;
+                return distance;
+            }
+            return currentMax;
+        });
+        bvhHits += closest < maxDistance ? 1 : 0;
+    }
+    double bvhRay = elapsedMs(start);
+
+    linearHits = 0;
+    start = Clock::now();
+    for (const Ray& query : rayQueries)
+    {
+        const glm::vec3 invDirection = BoundsUtils::inverseDirection(query.direction);
+        float closest = maxDistance;
+        for (const AABB& box : linear)
+        {
+            float distance;
+            if (BoundsUtils::intersectRay(query, invDirection, box, closest, distance))
+            {
+                closest = distance;
+            }
+        }
+        linearHits += closest < maxDistance ? 1 : 0;
+    }
+    double linearRay = elapsedMs(start);
+    printRow("ray", bvhRay, linearRay, bvhHits, linearHits);
+
+    std::cout << std::endl;
+}
+
+static void printUsage()
+{
+    std::cout <<
+        "Usage: bvh_benchmark [options]\n"
+        "  --count <n>              Entity count, repeatable (default 10000, 100000, 1000000)\n"
+        "  --queries <n>            Queries per type (default 256)\n"
+        "  --moved <f>              Fraction of entities moved per refit (default 0.1)\n"
+        "  --seed <n>               Random seed (default 1)\n"
+        "Build with optimizations, the timings of a debug build are meaningless.\n";
+}
+
+int main(int argc, char* argv[])
+{
+    BenchmarkSettings settings;
+    bool customCounts = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--help")
+        {
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Error: " << arg << " requires a value." << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::string value = argv[++i];
+        bool valid = true;
+        if (arg == "--count")
+        {
+            if (!customCounts) settings.counts.clear();
+            customCounts = true;
+            valid = Tools::parseUInt(value, settings.counts.emplace_back(), MAX_COUNT);
+        }
+        else if (arg == "--queries") valid = Tools::parseUInt(value, settings.queries, MAX_COUNT);
+        else if (arg == "--moved") valid = Tools::parseFloat(value, settings.movedFraction, 0.0f, 1.0f);
+        else if (arg == "--seed") valid = Tools::parseUInt(value, settings.seed);
+        else
+        {
+            std::cerr << "Error: unknown option " << arg << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Error: invalid value for " << arg << ": " << value << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (uint32_t count : settings.counts)
+    {
+        if (count == 0) continue;
+        runBenchmark(count, settings);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace Tools {
+
+// Option values for the command line tools. The whole text has to be the number:
+// signs on unsigned values, trailing characters and out of range values are
+// rejected instead of wrapping or throwing.
+
+inline bool parseUInt(const std::string& text, uint32_t& value, uint32_t max = std::numeric_limits<uint32_t>::max())
+{
+    uint64_t parsed = 0;
+    const char* end = text.data() + text.size();
+    auto [last, error] = std::from_chars(text.data(), end, parsed);
+    if (error != std::errc() || last != end || parsed > max) return false;
+
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+inline bool parseFloat(const std::string& text, float& value, float min, float max)
+{
+    try
+    {
+        size_t length = 0;
+        float parsed = std::stof(text, &length);
+        if (length != text.size() || !std::isfinite(parsed) || parsed < min || parsed > max) return false;
+
+        value = parsed;
+        return true;
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
+}
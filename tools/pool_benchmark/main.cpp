@@ -0,0 +1,188 @@
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/command_line.h"
+#include "core/uuid.h"
+#include "scene/scene.h"
+
+// Compares spawning and despawning prefab instances through an EntityPool against
+// the plain registry path (instantiate, then destroy at the end of the frame).
+// Every frame spawns count entities and releases the ones spawned lifetime frames
+// earlier, the way projectiles or effects churn.
+
+using namespace Engine;
+using Clock = std::chrono::steady_clock;
+
+// Larger counts are certainly a typo, the benchmark would only run out of memory
+const uint32_t MAX_COUNT = 100000000;
+
+struct BenchmarkSettings
+{
+    std::vector<uint32_t> counts = { 100, 1000, 10000 };
+    uint32_t frames = 200;
+    uint32_t lifetime = 4; // Frames an entity stays active
+};
+
+static double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static std::shared_ptr<const Prefab> makePrefab()
+{
+    auto prefab = std::make_shared<Prefab>();
+    prefab->name = "Projectile";
+    prefab->path = "pool_benchmark/projectile.prefab.json";
+    std::get<std::optional<TransformComponent>>(prefab->components).emplace();
+    std::get<std::optional<LightComponent>>(prefab->components).emplace();
+    std::get<std::optional<MeshRendererComponent>>(prefab->components).emplace();
+
+    // Same split Scene::loadPrefab makes, shared components stay on the prefab
+    prefab->instanceComponents = prefab->components;
+    std::get<std::optional<MeshRendererComponent>>(prefab->instanceComponents).reset();
+    return prefab;
+}
+
+static TransformComponent makeTransform(uint32_t index)
+{
+    TransformComponent transform;
+    transform.position = glm::vec3(static_cast<float>(index % 100), 0.0f, static_cast<float>(index / 100));
+    return transform;
+}
+
+// Runs the frames, returns the total milliseconds
+template <typename SpawnFn, typename ReleaseFn>
+static double runFrames(Scene& scene, uint32_t count, const BenchmarkSettings& settings, SpawnFn spawn, ReleaseFn release)
+{
+    std::deque<std::vector<entt::entity>> alive;
+
+    auto start = Clock::now();
+    for (uint32_t frame = 0; frame < settings.frames; ++frame)
+    {
+        std::vector<entt::entity>& spawned = alive.emplace_back();
+        spawned.reserve(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            spawned.push_back(spawn(makeTransform(i)));
+        }
+
+        if (alive.size() > settings.lifetime)
+        {
+            for (entt::entity entity : alive.front())
+            {
+                release(entity);
+            }
+            alive.pop_front();
+        }
+
+        scene.flushDestroyed();
+    }
+    return elapsedMs(start);
+}
+
+static void runBenchmark(uint32_t count, const BenchmarkSettings& settings)
+{
+    const std::shared_ptr<const Prefab> prefab = makePrefab();
+
+    // Plain path: a new entity per spawn, destroyed in the end-of-frame batch
+    Scene plainScene;
+    std::vector<entt::entity> created;
+    double plainMs = runFrames(plainScene, count, settings,
+        [&](const TransformComponent& transform)
+        {
+            plainScene.instantiatePrefab(prefab, 1, created);
+            plainScene.getRegistry().replace<TransformComponent>(created.front(), transform);
+            return created.front();
+        },
+        [&](entt::entity entity) { plainScene.destroyDeferred(entity); });
+    size_t plainEntities = plainScene.getRegistry().view<UUIDComponent>().size();
+
+    // Pool path, warmed up with one lifetime's worth of entities like a game would at load
+    Scene poolScene;
+    EntityPool& pool = poolScene.getPool(prefab);
+    pool.reserve(static_cast<size_t>(count) * (settings.lifetime + 1));
+    double poolMs = runFrames(poolScene, count, settings,
+        [&](const TransformComponent& transform) { return pool.spawn(transform); },
+        [&](entt::entity entity) { pool.release(entity); });
+
+    const double spawns = static_cast<double>(count) * settings.frames;
+    std::cout << count << " spawns per frame, " << settings.frames << " frames\n"
+        << std::fixed << std::setprecision(3)
+        << "  " << std::left << std::setw(10) << "plain" << std::right << std::setw(12) << plainMs << " ms"
+        << std::setw(12) << (plainMs * 1.0e6 / spawns) << " ns/spawn"
+        << "  (" << plainEntities << " alive)\n"
+        << "  " << std::left << std::setw(10) << "pool" << std::right << std::setw(12) << poolMs << " ms"
+        << std::setw(12) << (poolMs * 1.0e6 / spawns) << " ns/spawn"
+        << "  (" << pool.getActiveCount() << " active, " << pool.getParkedCount() << " parked)\n"
+        << "  " << std::setprecision(1) << (poolMs > 0.0 ? plainMs / poolMs : 0.0) << "x speedup\n"
+        << std::endl;
+}
+
+static void printUsage()
+{
+    std::cout <<
+        "Usage: pool_benchmark [options]\n"
+        "  --count <n>              Spawns per frame, repeatable (default 100, 1000, 10000)\n"
+        "  --frames <n>             Frames simulated (default 200)\n"
+        "  --lifetime <n>           Frames an entity stays active (default 4)\n"
+        "Build with optimizations, the timings of a debug build are meaningless.\n";
+}
+
+int main(int argc, char* argv[])
+{
+    BenchmarkSettings settings;
+    bool customCounts = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--help")
+        {
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Error: " << arg << " requires a value." << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::string value = argv[++i];
+        bool valid = true;
+        if (arg == "--count")
+        {
+            if (!customCounts) settings.counts.clear();
+            customCounts = true;
+            valid = Tools::parseUInt(value, settings.counts.emplace_back(), MAX_COUNT);
+        }
+        else if (arg == "--frames") valid = Tools::parseUInt(value, settings.frames, MAX_COUNT);
+        else if (arg == "--lifetime") valid = Tools::parseUInt(value, settings.lifetime, MAX_COUNT);
+        else
+        {
+            std::cerr << "Error: unknown option " << arg << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Error: invalid value for " << arg << ": " << value << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    UUID_init();
+    for (uint32_t count : settings.counts)
+    {
+        if (count == 0) continue;
+        runBenchmark(count, settings);
+    }
+
+    return EXIT_SUCCESS;
+}
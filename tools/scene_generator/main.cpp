@@ -0,0 +1,102 @@
+#include "scene_generator.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "common/command_line.h"
+
+// Larger counts are certainly a typo, not a scene anyone can open
+const uint32_t MAX_COUNT = 100000000;
+
+static void printUsage()
+{
+    std::cout <<
+        "Usage: scene_generator --out <path> [options]\n"
+        "  --out <path>             Output path without extension\n"
+        "  --seed <n>               Random seed (default 1)\n"
+        "  --entities <n>           Mesh entities (default 1000)\n"
+        "  --materials <n>          Generated materials, 0 = default material (default 4)\n"
+        "  --lights <n>             Point lights (default 4)\n"
+        "  --mesh <path>            Mesh to pick from, repeatable (default teapot + shadow_test)\n"
+        "  --distribution <name>    uniform | grid | clustered (default uniform)\n"
+        "  --depth <n>              Cluster nesting levels (default 2)\n"
+        "  --branching <n>          Child clusters per cluster (default 6)\n"
+        "  --extent <f>             Half size of the populated area (default 100)\n"
+        "  --format <name>          scene | world (default scene)\n"
+        "  --cell-size <f>          World partition cell size (default 32)\n"
+        "  --compact                Write JSON without indentation\n"
+        "Run from the repository root, generated files reference resources/ relative paths.\n";
+}
+
+int main(int argc, char* argv[])
+{
+    Tools::GeneratorSettings settings;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--compact")
+        {
+            settings.compact = true;
+            continue;
+        }
+        if (arg == "--help")
+        {
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Error: " << arg << " requires a value." << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::string value = argv[++i];
+        bool valid = true;
+        if (arg == "--out") settings.output = value;
+        else if (arg == "--seed") valid = Tools::parseUInt(value, settings.seed);
+        else if (arg == "--entities") valid = Tools::parseUInt(value, settings.entityCount, MAX_COUNT);
+        else if (arg == "--materials") valid = Tools::parseUInt(value, settings.materialCount, MAX_COUNT);
+        else if (arg == "--lights") valid = Tools::parseUInt(value, settings.lightCount, MAX_COUNT);
+        else if (arg == "--mesh") settings.meshes.push_back(value);
+        else if (arg == "--depth") valid = Tools::parseUInt(value, settings.hierarchyDepth, 16);
+        else if (arg == "--branching") valid = Tools::parseUInt(value, settings.branching, 1024);
+        else if (arg == "--extent") valid = Tools::parseFloat(value, settings.extent, 0.0f, 1.0e6f);
+        else if (arg == "--cell-size") valid = Tools::parseFloat(value, settings.cellSize, 0.0f, 1.0e6f);
+        else if (arg == "--distribution")
+        {
+            if (value == "uniform") settings.distribution = Tools::Distribution::Uniform;
+            else if (value == "grid") settings.distribution = Tools::Distribution::Grid;
+            else if (value == "clustered") settings.distribution = Tools::Distribution::Clustered;
+            else valid = false;
+        }
+        else if (arg == "--format")
+        {
+            if (value == "scene") settings.format = Tools::OutputFormat::Scene;
+            else if (value == "world") settings.format = Tools::OutputFormat::World;
+            else valid = false;
+        }
+        else
+        {
+            std::cerr << "Error: unknown option " << arg << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Error: invalid value for " << arg << ": " << value << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (settings.output.empty() || settings.branching == 0 || settings.cellSize <= 0.0f)
+    {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    Tools::SceneGenerator generator(settings);
+    return generator.generate() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,347 @@
+#include "scene_generator.h"
+
+#include <cmath>
+#include <map>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+namespace Tools {
+
+namespace fs = std::filesystem;
+
+const char* DEFAULT_MATERIAL = "resources/materials/default.json";
+const char* DEFAULT_TEXTURE = "resources/textures/default.png";
+
+static json vec3(float x, float y, float z)
+{
+    return { { "x", x }, { "y", y }, { "z", z } };
+}
+
+// JsonUtils::parseQuat passes the fields to glm::quat(w, x, y, z) in declaration
+// order, so the JSON "x" field ends up as the scalar part
+static json yawRotation(float radians)
+{
+    return {
+        { "x", std::cos(radians * 0.5f) },
+        { "y", 0.0f },
+        { "z", std::sin(radians * 0.5f) },
+        { "w", 0.0f }
+    };
+}
+
+static std::string toGenericPath(const fs::path& path)
+{
+    return path.generic_string();
+}
+
+SceneGenerator::SceneGenerator(const GeneratorSettings& settings)
+    : m_settings(settings), m_random(settings.seed)
+{
+    if (m_settings.meshes.empty())
+    {
+        m_settings.meshes = { "resources/assets/teapot.fbx", "resources/assets/shadow_test.fbx" };
+    }
+}
+
+bool SceneGenerator::generate()
+{
+    if (m_settings.output.empty())
+    {
+        std::cerr << "No output path given" << std::endl;
+        return false;
+    }
+
+    // Everything derives from one random stream, keep the generation order fixed
+    generateMaterials();
+    generatePlacements();
+
+    json resident = json::array();
+    resident.push_back(createCamera());
+    for (auto& light : createLights())
+    {
+        resident.push_back(light);
+    }
+
+    json entities = json::array();
+    for (uint32_t i = 0; i < m_settings.entityCount; i++)
+    {
+        entities.push_back(createEntity(i, m_placements[i]));
+    }
+
+    return m_settings.format == OutputFormat::World
+        ? writeWorld(resident, entities)
+        : writeScene(resident, entities);
+}
+
+void SceneGenerator::generateMaterials()
+{
+    m_materials.clear();
+    if (m_settings.materialCount == 0)
+    {
+        m_materials.push_back(DEFAULT_MATERIAL);
+        return;
+    }
+
+    fs::path directory = m_settings.output + "_materials";
+    fs::create_directories(directory);
+
+    for (uint32_t i = 0; i < m_settings.materialCount; i++)
+    {
+        float ambient = m_random.range(0.05f, 0.2f);
+        float specular = m_random.range(0.1f, 0.8f);
+        float shininesses[] = { 8.0f, 16.0f, 32.0f, 64.0f, 128.0f };
+
+        json material = {
+            { "albedo", DEFAULT_TEXTURE },
+            { "ambient", vec3(ambient, ambient, ambient) },
+            { "specularStrength", vec3(specular, specular, specular) },
+            { "shininess", shininesses[m_random.below(5)] },
+            { "opacity", 1.0f }
+        };
+
+        fs::path path = directory / ("material_" + std::to_string(i) + ".json");
+        writeJson(path.string(), material);
+        m_materials.push_back(toGenericPath(path));
+    }
+}
+
+void SceneGenerator::generatePlacements()
+{
+    const float extent = m_settings.extent;
+    m_placements.clear();
+    m_placements.reserve(m_settings.entityCount);
+
+    switch (m_settings.distribution)
+    {
+    case Distribution::Uniform:
+        for (uint32_t i = 0; i < m_settings.entityCount; i++)
+        {
+            m_placements.push_back({
+                m_random.range(-extent, extent),
+                m_random.range(0.0f, extent * 0.1f),
+                m_random.range(-extent, extent),
+                ""
+            });
+        }
+        break;
+
+    case Distribution::Grid:
+    {
+        uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(m_settings.entityCount))));
+        float spacing = side > 1 ? 2.0f * extent / static_cast<float>(side - 1) : 0.0f;
+        for (uint32_t i = 0; i < m_settings.entityCount; i++)
+        {
+            m_placements.push_back({
+                -extent + spacing * static_cast<float>(i % side),
+                0.0f,
+                -extent + spacing * static_cast<float>(i / side),
+                ""
+            });
+        }
+        break;
+    }
+
+    case Distribution::Clustered:
+    {
+        // Each level spawns `branching` children around every cluster of the level above,
+        // within a radius shrinking by the branching factor
+        struct Cluster { float x, z, radius; std::string name; };
+        std::vector<Cluster> clusters = { { 0.0f, 0.0f, extent, "" } };
+
+        for (uint32_t level = 0; level < m_settings.hierarchyDepth; level++)
+        {
+            std::vector<Cluster> children;
+            for (const Cluster& parent : clusters)
+            {
+                float radius = parent.radius / std::sqrt(static_cast<float>(m_settings.branching));
+                for (uint32_t child = 0; child < m_settings.branching; child++)
+                {
+                    float angle = m_random.range(0.0f, 6.2831853f);
+                    float distance = m_random.range(0.0f, parent.radius - radius);
+                    children.push_back({
+                        parent.x + std::cos(angle) * distance,
+                        parent.z + std::sin(angle) * distance,
+                        radius,
+                        parent.name + "C" + std::to_string(child) + "_"
+                    });
+                }
+            }
+            clusters.swap(children);
+        }
+
+        for (uint32_t i = 0; i < m_settings.entityCount; i++)
+        {
+            const Cluster& cluster = clusters[i % clusters.size()];
+
+            // Sum of uniforms, denser towards the cluster center
+            float dx = (m_random.nextFloat() + m_random.nextFloat() + m_random.nextFloat() - 1.5f) / 1.5f;
+            float dz = (m_random.nextFloat() + m_random.nextFloat() + m_random.nextFloat() - 1.5f) / 1.5f;
+            m_placements.push_back({
+                cluster.x + dx * cluster.radius,
+                m_random.range(0.0f, cluster.radius * 0.1f),
+                cluster.z + dz * cluster.radius,
+                cluster.name
+            });
+        }
+        break;
+    }
+    }
+}
+
+json SceneGenerator::createCamera()
+{
+    return {
+        { "name", "MainCamera" },
+        { "uuid", m_random.next64() },
+        { "components", {
+            { { "type", "Transform" }, { "data", {
+                { "position", vec3(0.0f, m_settings.extent * 0.05f + 1.0f, m_settings.extent * 0.5f) },
+                { "rotation", yawRotation(0.0f) },
+                { "scale", vec3(1.0f, 1.0f, 1.0f) }
+            } } },
+            { { "type", "Camera" }, { "data", {
+                { "fov", 45.0f },
+                { "nearClip", 0.1f },
+                { "farClip", m_settings.extent * 4.0f }
+            } } },
+            { { "type", "ActiveCamera" }, { "data", json::object() } }
+        } }
+    };
+}
+
+json SceneGenerator::createLights()
+{
+    auto light = [](const std::string& name, uint64_t uuid, const json& position, const json& direction,
+                    const json& color, float power, int type)
+    {
+        return json{
+            { "name", name },
+            { "uuid", uuid },
+            { "components", {
+                { { "type", "Light" }, { "data", {
+                    { "position", position },
+                    { "direction", direction },
+                    { "color", color },
+                    { "power", power },
+                    { "type", type }
+                } } }
+            } }
+        };
+    };
+
+    json lights = json::array();
+    lights.push_back(light("DirectionalLight", m_random.next64(),
+        vec3(0.0f, 10.0f, 0.0f), vec3(0.5f, -0.5f, -1.0f), vec3(1.0f, 1.0f, 1.0f), 1.0f, 1));
+
+    // One value per statement, argument evaluation order is unspecified
+    for (uint32_t i = 0; i < m_settings.lightCount; i++)
+    {
+        const float extent = m_settings.extent;
+        float x = m_random.range(-extent, extent);
+        float y = m_random.range(1.0f, 5.0f);
+        float z = m_random.range(-extent, extent);
+        float r = m_random.range(0.5f, 1.0f);
+        float g = m_random.range(0.5f, 1.0f);
+        float b = m_random.range(0.5f, 1.0f);
+        float power = m_random.range(0.5f, 3.0f);
+        uint64_t uuid = m_random.next64();
+
+        lights.push_back(light("PointLight_" + std::to_string(i), uuid,
+            vec3(x, y, z), vec3(0.0f, -1.0f, 0.0f), vec3(r, g, b), power, 0));
+    }
+
+    return lights;
+}
+
+json SceneGenerator::createEntity(uint32_t index, const Placement& placement)
+{
+    float scale = m_random.range(m_settings.minScale, m_settings.maxScale);
+    const std::string& mesh = m_settings.meshes[m_random.below(static_cast<uint32_t>(m_settings.meshes.size()))];
+    const std::string& material = m_materials[m_random.below(static_cast<uint32_t>(m_materials.size()))];
+
+    return {
+        { "name", placement.group + "Entity_" + std::to_string(index) },
+        { "uuid", m_random.next64() },
+        { "components", {
+            { { "type", "Transform" }, { "data", {
+                { "position", vec3(placement.x, placement.y, placement.z) },
+                { "rotation", yawRotation(m_random.range(0.0f, 6.2831853f)) },
+                { "scale", vec3(scale, scale, scale) }
+            } } },
+            { { "type", "MeshRenderer" }, { "data", {
+                { "meshData", mesh },
+                { "material", material },
+                { "castShadows", true }
+            } } }
+        } }
+    };
+}
+
+bool SceneGenerator::writeScene(const json& resident, const json& entities)
+{
+    json scene = { { "entities", resident } };
+    for (auto& entity : entities)
+    {
+        scene["entities"].push_back(entity);
+    }
+
+    return writeJson(m_settings.output + ".json", scene);
+}
+
+bool SceneGenerator::writeWorld(const json& resident, const json& entities)
+{
+    const float cellSize = m_settings.cellSize;
+    fs::path directory = m_settings.output + "_cells";
+    fs::create_directories(directory);
+
+    // Bucket entities by the cell containing their position, ordered for stable output
+    std::map<std::pair<int, int>, json> cells;
+    for (auto& entity : entities)
+    {
+        const json& position = entity["components"][0]["data"]["position"];
+        int x = static_cast<int>(std::floor(position["x"].get<float>() / cellSize));
+        int z = static_cast<int>(std::floor(position["z"].get<float>() / cellSize));
+
+        json& cell = cells[{ x, z }];
+        if (cell.is_null()) cell = json::array();
+        cell.push_back(entity);
+    }
+
+    json manifest = {
+        { "cellSize", cellSize },
+        { "loadRadius", cellSize * 2.0f },
+        { "unloadRadius", cellSize * 3.0f },
+        { "entities", resident },
+        { "cells", json::array() }
+    };
+
+    for (auto& [coord, cellEntities] : cells)
+    {
+        fs::path path = directory / ("cell_" + std::to_string(coord.first) + "_" + std::to_string(coord.second) + ".json");
+        if (!writeJson(path.string(), { { "entities", cellEntities } })) return false;
+
+        manifest["cells"].push_back({
+            { "x", coord.first },
+            { "z", coord.second },
+            { "path", toGenericPath(path) }
+        });
+    }
+
+    return writeJson(m_settings.output + ".world.json", manifest);
+}
+
+bool SceneGenerator::writeJson(const std::string& path, const json& j) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open output file: " << path << std::endl;
+        return false;
+    }
+
+    file << j.dump(m_settings.compact ? -1 : 4);
+    return true;
+}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+namespace Tools {
+
+using json = nlohmann::json;
+
+enum class Distribution
+{
+    Uniform,    // Random positions over the whole extent
+    Grid,       // Regular grid, one entity per cell
+    Clustered   // Nested clusters, one level per hierarchy depth
+};
+
+enum class OutputFormat
+{
+    Scene,      // Single file read by Scene::loadScene
+    World       // Partitioned manifest + cells streamed by WorldStreamer
+};
+
+struct GeneratorSettings
+{
+    uint32_t seed = 1;
+    uint32_t entityCount = 1000;
+    uint32_t materialCount = 4;     // 0 = every entity uses the default material
+    uint32_t lightCount = 4;        // Point lights, a directional light is always added
+    uint32_t hierarchyDepth = 2;    // Cluster nesting levels (Clustered only)
+    uint32_t branching = 6;         // Child clusters per cluster
+    Distribution distribution = Distribution::Uniform;
+    OutputFormat format = OutputFormat::Scene;
+    float extent = 100.0f;          // Half size of the populated XZ square
+    float minScale = 0.02f;
+    float maxScale = 0.08f;
+    float cellSize = 32.0f;
+    bool compact = false;
+    std::vector<std::string> meshes;
+    std::string output;             // Path without extension
+};
+
+// Deterministic for a given seed on every platform: the standard distributions
+// are implementation defined, so values are mapped from the raw engine output.
+class Random
+{
+public:
+    explicit Random(uint32_t seed) : m_engine(seed) {}
+
+    float nextFloat() { return static_cast<float>(next32() >> 8) * (1.0f / 16777216.0f); }
+    float range(float min, float max) { return min + (max - min) * nextFloat(); }
+    uint32_t below(uint32_t count) { return count ? next32() % count : 0; }
+    uint64_t next64()
+    {
+        uint64_t high = next32();
+        return (high << 32) | next32();
+    }
+
+private:
+    uint32_t next32() { return static_cast<uint32_t>(m_engine()); }
+
+    std::mt19937 m_engine;
+};
+
+class SceneGenerator
+{
+public:
+    explicit SceneGenerator(const GeneratorSettings& settings);
+
+    bool generate();
+
+private:
+    struct Placement
+    {
+        float x, y, z;
+        std::string group;
+    };
+
+    void generateMaterials();
+    void generatePlacements();
+    json createCamera();
+    json createLights();
+    json createEntity(uint32_t index, const Placement& placement);
+
+    bool writeScene(const json& resident, const json& entities);
+    bool writeWorld(const json& resident, const json& entities);
+    bool writeJson(const std::string& path, const json& j) const;
+
+    GeneratorSettings m_settings;
+    Random m_random;
+    std::vector<std::string> m_materials;
+    std::vector<Placement> m_placements;
+};
+
+}
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include "common/command_line.h"
+#include "renderer/shader_program.h"
+
+// Compares setting uniforms the way the renderer used to, a glGetUniformLocation
+// lookup and an upload per uniform per draw, against the reflected Uniform<T>
+// handles, whose redundancy filter skips values equal to the last one sent.
+// Runs on a hidden window's context; only the CPU side of the calls is measured.
+
+using namespace OpenGL;
+using Clock = std::chrono::steady_clock;
+
+// Larger counts are certainly a typo, the benchmark would only run out of memory
+const uint32_t MAX_COUNT = 100000000;
+
+struct BenchmarkSettings
+{
+    uint32_t draws = 10000; // Per frame
+    uint32_t frames = 100;
+    uint32_t materials = 16; // Distinct albedo bindings cycled through, draws are sorted by them
+};
+
+const char* VERTEX_SHADER = R"(
+#version 450 core
+layout(location = 0) in vec3 aPos;
+uniform mat4 viewProjection;
+uniform mat4 viewMatrix;
+uniform int drawIndex;
+out vec3 vColor;
+void main() {
+    gl_Position = viewProjection * viewMatrix * vec4(aPos + vec3(float(drawIndex)), 1.0);
+    vColor = aPos;
+}
+)";
+
+const char* FRAGMENT_SHADER = R"(
+#version 450 core
+in vec3 vColor;
+uniform sampler2D textureAlbedo;
+uniform int activeLights;
+uniform vec3 ambient;
+out vec4 FragColor;
+void main() {
+    FragColor = texture(textureAlbedo, vColor.xy) * float(activeLights) + vec4(ambient, 1.0);
+}
+)";
+
+static double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static GLuint compileProgram()
+{
+    auto compile = [](GLenum type, const char* source)
+    {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        return shader;
+    };
+
+    GLuint vertex = compile(GL_VERTEX_SHADER, VERTEX_SHADER);
+    GLuint fragment = compile(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        std::cerr << "Error: benchmark program failed to link:\n" << log << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// Frame constants change once per frame, the material every draws / materials draws
+// and the draw index every draw, like the standard pass
+struct FrameValues
+{
+    glm::mat4 viewProjection;
+    glm::mat4 viewMatrix;
+    glm::vec3 ambient;
+    int activeLights;
+};
+
+static FrameValues frameValues(uint32_t frame)
+{
+    const float t = static_cast<float>(frame) * 0.01f;
+    return { glm::mat4(1.0f + t), glm::mat4(1.0f - t), glm::vec3(0.1f + t), 4 };
+}
+
+static int materialOf(uint32_t draw, const BenchmarkSettings& settings)
+{
+    const uint32_t drawsPerMaterial = std::max(settings.draws / std::max(settings.materials, 1u), 1u);
+    return static_cast<int>(draw / drawsPerMaterial);
+}
+
+// Old path: locations looked up by name on every draw, every value uploaded
+static double runLookup(GLuint program, const BenchmarkSettings& settings)
+{
+    auto start = Clock::now();
+    for (uint32_t frame = 0; frame < settings.frames; ++frame)
+    {
+        const FrameValues values = frameValues(frame);
+        glUseProgram(program);
+        for (uint32_t draw = 0; draw < settings.draws; ++draw)
+        {
+            glUniformMatrix4fv(glGetUniformLocation(program, "viewProjection"), 1, GL_FALSE, &values.viewProjection[0][0]);
+            glUniformMatrix4fv(glGetUniformLocation(program, "viewMatrix"), 1, GL_FALSE, &values.viewMatrix[0][0]);
+            glUniform3fv(glGetUniformLocation(program, "ambient"), 1, &values.ambient[0]);
+            glUniform1i(glGetUniformLocation(program, "activeLights"), values.activeLights);
+            glUniform1i(glGetUniformLocation(program, "textureAlbedo"), materialOf(draw, settings) % 16);
+            glUniform1i(glGetUniformLocation(program, "drawIndex"), static_cast<int>(draw));
+        }
+    }
+    glUseProgram(0);
+    glFinish();
+    return elapsedMs(start);
+}
+
+// Locations resolved once, every value still sent: separates the lookup cost from
+// what the redundancy filter saves
+static double runCachedLocations(GLuint program, const BenchmarkSettings& settings)
+{
+    const GLint viewProjection = glGetUniformLocation(program, "viewProjection");
+    const GLint viewMatrix = glGetUniformLocation(program, "viewMatrix");
+    const GLint ambient = glGetUniformLocation(program, "ambient");
+    const GLint activeLights = glGetUniformLocation(program, "activeLights");
+    const GLint textureAlbedo = glGetUniformLocation(program, "textureAlbedo");
+    const GLint drawIndex = glGetUniformLocation(program, "drawIndex");
+
+    auto start = Clock::now();
+    for (uint32_t frame = 0; frame < settings.frames; ++frame)
+    {
+        const FrameValues values = frameValues(frame);
+        for (uint32_t draw = 0; draw < settings.draws; ++draw)
+        {
+            glProgramUniformMatrix4fv(program, viewProjection, 1, GL_FALSE, &values.viewProjection[0][0]);
+            glProgramUniformMatrix4fv(program, viewMatrix, 1, GL_FALSE, &values.viewMatrix[0][0]);
+            glProgramUniform3fv(program, ambient, 1, &values.ambient[0]);
+            glProgramUniform1i(program, activeLights, values.activeLights);
+            glProgramUniform1i(program, textureAlbedo, materialOf(draw, settings) % 16);
+            glProgramUniform1i(program, drawIndex, static_cast<int>(draw));
+        }
+    }
+    glFinish();
+    return elapsedMs(start);
+}
+
+// The renderer's path: ShaderProgram::set on every draw, unchanged values are skipped
+static double runReflected(GLuint program, const BenchmarkSettings& settings, uint64_t& uploads)
+{
+    ShaderProgram shader;
+    shader.id = program;
+    shader.reflect();
+
+    const auto viewProjection = shader.getUniform<glm::mat4>("viewProjection");
+    const auto viewMatrix = shader.getUniform<glm::mat4>("viewMatrix");
+    const auto ambient = shader.getUniform<glm::vec3>("ambient");
+    const auto activeLights = shader.getUniform<int>("activeLights");
+    const auto textureAlbedo = shader.getUniform<int>("textureAlbedo");
+    const auto drawIndex = shader.getUniform<int>("drawIndex");
+
+    // Counted outside the timed loop, with the same sequence of values
+    uploads = 0;
+    {
+        FrameValues last = {};
+        int lastMaterial = -1;
+        int lastDraw = -1;
+        for (uint32_t frame = 0; frame < settings.frames; ++frame)
+        {
+            const FrameValues values = frameValues(frame);
+            uploads += (frame == 0 || values.viewProjection != last.viewProjection) ? 1 : 0;
+            uploads += (frame == 0 || values.viewMatrix != last.viewMatrix) ? 1 : 0;
+            uploads += (frame == 0 || values.ambient != last.ambient) ? 1 : 0;
+            uploads += (frame == 0 || values.activeLights != last.activeLights) ? 1 : 0;
+            for (uint32_t draw = 0; draw < settings.draws; ++draw)
+            {
+                const int material = materialOf(draw, settings) % 16;
+                uploads += material != lastMaterial ? 1 : 0;
+                uploads += static_cast<int>(draw) != lastDraw ? 1 : 0;
+                lastMaterial = material;
+                lastDraw = static_cast<int>(draw);
+            }
+            last = values;
+        }
+    }
+
+    auto start = Clock::now();
+    for (uint32_t frame = 0; frame < settings.frames; ++frame)
+    {
+        const FrameValues values = frameValues(frame);
+        for (uint32_t draw = 0; draw < settings.draws; ++draw)
+        {
+            shader.set(viewProjection, values.viewProjection);
+            shader.set(viewMatrix, values.viewMatrix);
+            shader.set(ambient, values.ambient);
+            shader.set(activeLights, values.activeLights);
+            shader.set(textureAlbedo, materialOf(draw, settings) % 16);
+            shader.set(drawIndex, static_cast<int>(draw));
+        }
+    }
+    glFinish();
+    return elapsedMs(start);
+}
+
+static void printRow(const char* name, double ms, const BenchmarkSettings& settings, double baselineMs)
+{
+    const double draws = static_cast<double>(settings.draws) * settings.frames;
+    std::cout << "  " << std::left << std::setw(18) << name << std::right
+        << std::fixed << std::setprecision(3)
+        << std::setw(12) << ms << " ms"
+        << std::setw(10) << std::setprecision(1) << (ms * 1.0e6 / draws) << " ns/draw"
+        << std::setw(10) << (ms > 0.0 ? baselineMs / ms : 0.0) << "x\n";
+}
+
+static void printUsage()
+{
+    std::cout <<
+        "Usage: uniform_benchmark [options]\n"
+        "  --draws <n>              Draws per frame (default 10000)\n"
+        "  --frames <n>             Frames simulated (default 100)\n"
+        "  --materials <n>          Material changes per frame (default 16)\n"
+        "Build with optimizations, the timings of a debug build are meaningless.\n";
+}
+
+int main(int argc, char* argv[])
+{
+    BenchmarkSettings settings;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--help")
+        {
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Error: " << arg << " requires a value." << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::string value = argv[++i];
+        bool valid = true;
+        if (arg == "--draws") valid = Tools::parseUInt(value, settings.draws, MAX_COUNT);
+        else if (arg == "--frames") valid = Tools::parseUInt(value, settings.frames, MAX_COUNT);
+        else if (arg == "--materials") valid = Tools::parseUInt(value, settings.materials, MAX_COUNT);
+        else
+        {
+            std::cerr << "Error: unknown option " << arg << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Error: invalid value for " << arg << ": " << value << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!glfwInit())
+    {
+        std::cerr << "Error: failed to initialize GLFW" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "uniform_benchmark", nullptr, nullptr);
+    if (!window)
+    {
+        std::cerr << "Error: failed to create an OpenGL 4.5 context" << std::endl;
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+    glfwMakeContextCurrent(window);
+
+    GLuint program = 0;
+    if (glewInit() == GLEW_OK) program = compileProgram();
+    if (program == 0)
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+
+    std::cout << settings.draws << " draws per frame, " << settings.frames << " frames, "
+        << settings.materials << " materials\n";
+
+    uint64_t uploads = 0;
+    const double lookupMs = runLookup(program, settings);
+    const double cachedMs = runCachedLocations(program, settings);
+    const double reflectedMs = runReflected(program, settings, uploads);
+
+    printRow("lookup", lookupMs, settings, lookupMs);
+    printRow("cached locations", cachedMs, settings, lookupMs);
+    printRow("reflected", reflectedMs, settings, lookupMs);
+    std::cout << "  reflected path uploaded " << uploads << " of "
+        << static_cast<uint64_t>(settings.draws) * settings.frames * 6 << " values" << std::endl;
+
+    glDeleteProgram(program);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}